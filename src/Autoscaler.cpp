@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Autoscaler.h"
+#include <algorithm>
+
+namespace scinit {
+    Autoscaler::Autoscaler(unsigned int min_instances, unsigned int max_instances, unsigned int instances,
+                           double up_threshold, double down_threshold, unsigned int sustain,
+                           uint64_t cooldown_ms) noexcept
+      : min_instances(min_instances), max_instances(std::max(min_instances, max_instances)),
+        instances(std::min(std::max(instances, min_instances), std::max(min_instances, max_instances))),
+        up_threshold(up_threshold), down_threshold(std::min(down_threshold, up_threshold)),
+        sustain(std::max(sustain, 1u)), cooldown_ms(cooldown_ms) {}
+
+    unsigned int Autoscaler::update(uint64_t now_ms, double load) noexcept {
+        if (load > up_threshold) {
+            above++;
+            below = 0;
+        } else if (load < down_threshold) {
+            below++;
+            above = 0;
+        } else {
+            above = below = 0;
+        }
+        return decide(now_ms);
+    }
+
+    unsigned int Autoscaler::urgent(uint64_t now_ms) noexcept {
+        above = std::max(above, sustain);
+        below = 0;
+        return decide(now_ms);
+    }
+
+    unsigned int Autoscaler::decide(uint64_t now_ms) noexcept {
+        if (changed && now_ms < last_change_ms + cooldown_ms) {
+            return instances;
+        }
+        if (above >= sustain && instances < max_instances) {
+            instances++;
+        } else if (below >= sustain && instances > min_instances) {
+            instances--;
+        } else {
+            return instances;
+        }
+        above = below = 0;
+        changed = true;
+        last_change_ms = now_ms;
+        return instances;
+    }
+}  // namespace scinit
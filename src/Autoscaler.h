@@ -0,0 +1,55 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_AUTOSCALER_H
+#define CINIT_AUTOSCALER_H
+
+#include <cstdint>
+
+namespace scinit {
+    /*
+     * Scaling decision for one instance group. It is fed one load sample per evaluation and answers with the
+     * number of instances that should be running. Two thresholds form a hysteresis band (nothing happens while the
+     * load is between them), a threshold has to be crossed for 'sustain' consecutive samples before acting and
+     * after each change, the group is left alone for the cooldown period so that new instances can pick up load.
+     *
+     * Like the timer wheel, this knows nothing about clocks, the caller passes in the current time.
+     */
+    class Autoscaler {
+      public:
+        Autoscaler(unsigned int min_instances, unsigned int max_instances, unsigned int instances,
+                   double up_threshold, double down_threshold, unsigned int sustain, uint64_t cooldown_ms) noexcept;
+
+        // Feed a load sample, returns the desired number of instances
+        unsigned int update(uint64_t now_ms, double load) noexcept;
+
+        // A pressure trigger fired: scale up as soon as the cooldown allows, without waiting for more samples
+        unsigned int urgent(uint64_t now_ms) noexcept;
+
+        unsigned int get_instances() const noexcept { return instances; }
+
+      private:
+        unsigned int decide(uint64_t now_ms) noexcept;
+
+        unsigned int min_instances, max_instances, instances;
+        double up_threshold, down_threshold;
+        unsigned int sustain, above = 0, below = 0;
+        uint64_t cooldown_ms, last_change_ms = 0;
+        bool changed = false;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_AUTOSCALER_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Cgroup.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <set>
+#include <sstream>
+#include "ChildProcessException.h"
+#include "SystemResources.h"
+#include "log.h"
+
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
+#ifndef SYS_clone3
+#define SYS_clone3 435
+#endif
+// Period written to cpu.max, the quota is derived from the number of CPUs
+#define CPU_MAX_PERIOD_US 100000
+
+namespace scinit {
+    namespace {
+        // Group containing the program groups, empty until delegate() succeeded
+        std::string base_path;
+
+        // Layout of struct clone_args up to the cgroup field (CLONE_ARGS_SIZE_VER2), not all headers have it
+        struct clone3_args {
+            uint64_t flags, pidfd, child_tid, parent_tid, exit_signal, stack, stack_size, tls, set_tid, set_tid_size,
+              cgroup;
+        };
+
+        bool write_file(const std::string& file, const std::string& value) noexcept {
+            int fd = open(file.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd == -1) {
+                return false;
+            }
+            bool ok = write(fd, value.c_str(), value.size()) == static_cast<ssize_t>(value.size());
+            int write_errno = errno;
+            close(fd);
+            errno = write_errno;
+            return ok;
+        }
+
+        // Value of 'key' in a flat keyed file like memory.events or cpu.stat
+        uint64_t read_key(const std::string& file, const std::string& key) noexcept {
+            std::ifstream input(file);
+            std::string name;
+            uint64_t value = 0;
+            while (input >> name >> value) {
+                if (name == key) {
+                    return value;
+                }
+            }
+            return 0;
+        }
+
+        bool single_threaded() noexcept {
+            std::ifstream stat_file("/proc/self/stat");
+            std::string stat;
+            std::getline(stat_file, stat);
+            // The command name may contain spaces, the fields after it are: state ppid ... num_threads (field 20)
+            auto end = stat.rfind(')');
+            if (end == std::string::npos) {
+                return false;
+            }
+            std::istringstream fields(stat.substr(end + 1));
+            std::string field;
+            for (int i = 3; i <= 20 && fields >> field; i++) {
+                if (i == 20) {
+                    return field == "1";
+                }
+            }
+            return false;
+        }
+    }  // namespace
+
+    bool Cgroup::delegate() noexcept {
+        if (!base_path.empty()) {
+            return true;
+        }
+        auto own = resources::own_cgroup();
+        if (own.empty() || access((own + "/cgroup.subtree_control").c_str(), W_OK) != 0) {
+            LOG->warn("No writable cgroup v2 hierarchy, resource limits are not applied");
+            return false;
+        }
+        auto leaf = own + "/scinit";
+        if ((mkdir(leaf.c_str(), 0755) == -1 && errno != EEXIST) || !write_file(leaf + "/cgroup.procs", "0")) {
+            LOG->warn("Couldn't move scinit to {0}: {1}, resource limits are not applied", leaf, std::strerror(errno));
+            return false;
+        }
+
+        std::ifstream controllers_file(own + "/cgroup.controllers");
+        std::set<std::string> available;
+        std::string controller;
+        while (controllers_file >> controller) {
+            available.insert(controller);
+        }
+        for (const std::string wanted : {"memory", "cpu", "io", "pids"}) {
+            if (available.count(wanted) == 0) {
+                LOG->warn("cgroup controller {0} isn't available, its limits are not applied", wanted);
+            } else if (!write_file(own + "/cgroup.subtree_control", "+" + wanted)) {
+                LOG->warn("Couldn't enable cgroup controller {0}: {1}", wanted, std::strerror(errno));
+            }
+        }
+        base_path = own;
+        LOG->debug("Program cgroups are created in {0}", base_path);
+        return true;
+    }
+
+    bool Cgroup::is_delegated() noexcept { return !base_path.empty(); }
+
+    Cgroup::Cgroup(const std::string& name, const ProgramOptions& options) noexcept(false) {
+        if (base_path.empty()) {
+            throw ChildProcessException("cgroups haven't been set up!");
+        }
+        path = base_path + "/" + name;
+        if (mkdir(path.c_str(), 0755) == -1 && errno != EEXIST) {
+            throw ChildProcessException(("Couldn't create cgroup " + path + ": " + std::strerror(errno)).c_str());
+        }
+
+        std::list<std::pair<std::string, std::string>> limits;
+        if (!options.memory_high.empty()) {
+            limits.emplace_back("memory.high", options.memory_high);
+        }
+        if (!options.memory_max.empty()) {
+            limits.emplace_back("memory.max", options.memory_max);
+        }
+        if (options.cpu_weight > 0) {
+            limits.emplace_back("cpu.weight", std::to_string(options.cpu_weight));
+        }
+        if (options.cpu_max > 0) {
+            auto quota = static_cast<uint64_t>(options.cpu_max * CPU_MAX_PERIOD_US);
+            limits.emplace_back("cpu.max", std::to_string(quota) + " " + std::to_string(CPU_MAX_PERIOD_US));
+        }
+        if (options.io_weight > 0) {
+            limits.emplace_back("io.weight", "default " + std::to_string(options.io_weight));
+        }
+        if (options.pids_max > 0) {
+            limits.emplace_back("pids.max", std::to_string(options.pids_max));
+        }
+        for (const auto& limit : limits) {
+            if (!write_file(path + "/" + limit.first, limit.second)) {
+                auto reason = "Couldn't set " + limit.first + " of " + name + ": " + std::strerror(errno);
+                rmdir(path.c_str());
+                throw ChildProcessException(reason.c_str());
+            }
+        }
+
+        dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd == -1) {
+            rmdir(path.c_str());
+            throw ChildProcessException(("Couldn't open cgroup " + path).c_str());
+        }
+        events_fd = open((path + "/memory.events").c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    Cgroup::~Cgroup() {
+        for (int fd : {dir_fd, events_fd}) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+        rmdir(path.c_str());
+    }
+
+    pid_t Cgroup::spawn() noexcept {
+        if (single_threaded()) {
+            clone3_args args{};
+            args.flags = CLONE_INTO_CGROUP;
+            args.exit_signal = SIGCHLD;
+            args.cgroup = static_cast<uint64_t>(dir_fd);
+            auto pid = syscall(SYS_clone3, &args, sizeof(args));
+            if (pid >= 0) {
+                return static_cast<pid_t>(pid);
+            }
+            LOG->debug("clone3 into {0} failed ({1}), forking instead", path, std::strerror(errno));
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Still before exec, so the program itself never runs outside of its group
+            int procs = openat(dir_fd, "cgroup.procs", O_WRONLY | O_CLOEXEC);
+            if (procs == -1 || write(procs, "0", 1) != 1) {
+                _exit(-1);
+            }
+            close(procs);
+        }
+        return pid;
+    }
+
+    void Cgroup::attach(pid_t pid) noexcept(false) {
+        if (!write_file(path + "/cgroup.procs", std::to_string(pid))) {
+            throw ChildProcessException(("Couldn't move process into " + path + ": " + std::strerror(errno)).c_str());
+        }
+    }
+
+    bool Cgroup::set_frozen(bool frozen) noexcept { return write_file(path + "/cgroup.freeze", frozen ? "1" : "0"); }
+
+    Cgroup::Usage Cgroup::read_usage() const noexcept {
+        Usage usage;
+        usage.cpu_usec = read_key(path + "/cpu.stat", "usage_usec");
+        std::ifstream peak(path + "/memory.peak");
+        if (!(peak >> usage.memory_peak)) {
+            // memory.peak is new in Linux 5.19
+            std::ifstream current(path + "/memory.current");
+            current >> usage.memory_peak;
+        }
+        usage.oom_kills = read_key(path + "/memory.events", "oom_kill");
+        return usage;
+    }
+}  // namespace scinit
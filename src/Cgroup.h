@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_CGROUP_H
+#define CINIT_CGROUP_H
+
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+#include "ProgramOptions.h"
+
+namespace scinit {
+    /*
+     * A cgroup v2 child group for one program below scinit's own (delegated) cgroup. It carries the program's
+     * resource limits and its usage can be read back for accounting.
+     *
+     * Processes are placed into the group while they are created (clone3 with CLONE_INTO_CGROUP), so that a
+     * program never runs unlimited and the kernel doesn't have to migrate a running process between groups.
+     */
+    class Cgroup {
+      public:
+        // Usage counters of the group, fields that can't be read are 0
+        struct Usage {
+            uint64_t cpu_usec = 0, memory_peak = 0, oom_kills = 0;
+        };
+
+        // Creates the group and writes the limits from 'options'
+        Cgroup(const std::string& name, const ProgramOptions& options) noexcept(false);
+        Cgroup(const Cgroup&) = delete;
+        Cgroup& operator=(const Cgroup&) = delete;
+        // Removes the group, which only works once all of its processes are gone
+        ~Cgroup();
+
+        /*
+         * Prepare scinit's cgroup to hold child groups: scinit moves into a leaf group of its own (the 'no internal
+         * processes' rule) and the memory, cpu, io and pids controllers are enabled for the subtree. This has to
+         * happen before any child is started. Returns false if there is no writable cgroup v2 hierarchy.
+         */
+        static bool delegate() noexcept;
+        static bool is_delegated() noexcept;
+
+        /*
+         * Like fork(), but the child starts in this group. Falls back to fork() and the child moving itself before
+         * returning if clone3 isn't available (Linux < 5.7) or other threads are running, as the raw syscall
+         * skips glibc's fork handlers.
+         */
+        pid_t spawn() noexcept;
+
+        // Move an existing process into the group
+        void attach(pid_t pid) noexcept(false);
+
+        // Freeze or thaw all processes of the group (cgroup.freeze, Linux 5.2), false if that isn't supported
+        bool set_frozen(bool frozen) noexcept;
+
+        // Readable (EPOLLPRI) when memory.events changed, -1 without the memory controller
+        int get_events_fd() const noexcept { return events_fd; }
+
+        Usage read_usage() const noexcept;
+        std::string get_path() const noexcept { return path; }
+
+      private:
+        std::string path;
+        int dir_fd = -1, events_fd = -1;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_CGROUP_H
@@ -15,7 +15,9 @@
  */
 
 #include "ChildProcess.h"
+#include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <pty.h>
 #include <pwd.h>
 #include <sys/capability.h>
@@ -24,26 +26,38 @@
 #include <sys/prctl.h>
 #include <termios.h>
 #include <unistd.h>
+#include <algorithm>
+#include <array>
 #include <cerrno>
+#include <csignal>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <set>
+#include <sstream>
 #include "ChildProcessException.h"
 #include "inja.hpp"
 #include "log.h"
 
+// Upper bound of the delay between restarts of a crashing program
+#define RESTART_DELAY_MAX_S 60u
+
 namespace scinit {
     ChildProcess::ChildProcess(std::string name, std::string path, std::list<std::string> args, std::string type,
                                std::list<std::string> capabilities, unsigned int uid, unsigned int gid,
                                unsigned int graph_id, const std::shared_ptr<ProcessHandlerInterface>& handler,
                                std::list<std::string> before, std::list<std::string> after, bool want_tty,
                                bool want_default_env, std::list<std::string> env_extra_whitelist,
-                               std::list<std::pair<std::string, std::string>> env_extra_vars)
+                               std::list<std::pair<std::string, std::string>> env_extra_vars,
+                               ProgramOptions options)
       : name(std::move(name)), path(std::move(path)), args(std::move(args)), capabilities(std::move(capabilities)),
         uid(uid), gid(gid), graph_id(graph_id), handler(handler), before(std::move(before)), after(std::move(after)),
-        want_tty(want_tty), want_default_env(want_default_env), env_extra_vars(std::move(env_extra_vars)) {
+        want_tty(want_tty), want_default_env(want_default_env), options(std::move(options)),
+        env_extra_vars(std::move(env_extra_vars)) {
         this->state = BLOCKED;
+        this->parked = this->options.start_parked;
 
         std::transform(type.begin(), type.end(), type.begin(), ::tolower);
         if (type == "simple") {
@@ -66,8 +80,18 @@ namespace scinit {
         }
     }
 
+    ChildProcess::~ChildProcess() {
+        for (auto timer : {start_timer, stop_timer, idle_timer, backoff_timer}) {
+            if (timer != 0) {
+                handler->cancel_timer(timer);
+            }
+        }
+    }
+
     unsigned int ChildProcess::get_id() const noexcept { return graph_id; }
 
+    ChildProcessInterface::ProcessType ChildProcess::get_type() const noexcept { return type; }
+
     bool ChildProcess::handle_caps() {
         // Change owner of tty if necessary. Do this before touching capabilities!
         if (want_tty) {
@@ -200,6 +224,10 @@ namespace scinit {
         }
         // Force USER to correct value
         envObj["vars"]["USER"] = username;
+        envObj["instance"] = options.instance;
+        if (options.numa_node != -1) {
+            envObj["numa_node"] = options.numa_node;
+        }
         if (want_default_env) {
             envObj["vars"]["LANG"] = "C";
             envObj["vars"]["LANGUAGE"] = "en";
@@ -230,6 +258,15 @@ namespace scinit {
         if (state != READY) {
             throw ChildProcessException("Process not ready, cannot fork now!");
         }
+        if (!cgroup && options.has_resource_limits() && Cgroup::is_delegated()) {
+            try {
+                cgroup = std::make_unique<Cgroup>(name, options);
+            } catch (ChildProcessException& e) {
+                // Running without the limits could take down everything else
+                fail(e.what());
+                throw;
+            }
+        }
 
         if (!want_tty) {
             if (pipe(static_cast<int*>(stdout)) == -1) {
@@ -288,8 +325,36 @@ namespace scinit {
         }
 
         auto environment = handle_env();
+        if (!options.sockets.empty()) {
+            std::string names;
+            for (const auto& socket : options.sockets) {
+                names += (names.empty() ? "" : ":") + socket->get_name();
+            }
+            environment.push_back("LISTEN_FDS=" + std::to_string(options.sockets.size()));
+            environment.push_back("LISTEN_FDNAMES=" + names);
+            // LISTEN_PID is only known after fork, reserve the slot now
+            environment.emplace_back("LISTEN_PID=");
+            socket_fds.assign(options.sockets.size(), -1);
+        }
+        if (options.notify_ready) {
+            auto notify_socket = handler->get_notify_socket();
+            if (notify_socket.empty()) {
+                throw ChildProcessException("Program waits for readiness, but there is no notify socket!");
+            }
+            // Insert before LISTEN_PID, which has to stay the last element
+            environment.insert(options.sockets.empty() ? environment.end() : std::prev(environment.end()),
+                               "NOTIFY_SOCKET=" + notify_socket);
+        }
 
-        primaryPid = fork();
+        primaryPid = options.zygote ? spawn_from_zygote(environment) : -1;
+        if (primaryPid == -1) {
+            primaryPid = cgroup ? cgroup->spawn() : fork();
+        } else if (cgroup) {
+            // The zygote forks on its own, so the process can only be moved once it exists
+            try {
+                cgroup->attach(primaryPid);
+            } catch (ChildProcessException& e) { LOG->error("{0}: {1}", name, e.what()); }
+        }
         if (primaryPid == 0) {
             /* This is the child that's supposed to exec
              *
@@ -307,6 +372,13 @@ namespace scinit {
             }
             close(stdout[1]);
             close(stderr[1]);
+            if (!options.sockets.empty()) {
+                if (!pass_sockets()) {
+                    LOG->critical("Couldn't pass listening sockets, aborting now!");
+                    exit(-1);
+                }
+                environment.back() += std::to_string(getpid());
+            }
             // Transform args
             const char* program = this->path.c_str();
             // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
@@ -331,12 +403,22 @@ namespace scinit {
             }
             c_env[i] = nullptr;
 
+            // Some of these need privileges that are dropped below
+            if (!apply_scheduling()) {
+                exit(-1);
+            }
+
             // Handle capabilities and drop permissions
             if (!handle_caps()) {
                 LOG->critical("Couldn't drop privileges as intended, aborting now!");
                 exit(-1);
             }
 
+            // scinit blocks the signals it reads from its signalfd, the mask would survive the exec
+            sigset_t empty;
+            sigemptyset(&empty);
+            sigprocmask(SIG_SETMASK, &empty, nullptr);
+
             // Execute program
             int retval = execvpe(program, static_cast<char* const*>(c_args), static_cast<char* const*>(c_env));
 
@@ -347,8 +429,302 @@ namespace scinit {
         close(stdout[1]);
         close(stderr[1]);
         LOG->info("Child pid: {0}", primaryPid);
-        state = RUNNING;
+        if (start_timer != 0) {
+            handler->cancel_timer(start_timer);
+            start_timer = 0;
+        }
+        start_count++;
+        started_at = std::chrono::steady_clock::now();
+        oom_killed = false;
+        state = options.notify_ready ? STARTING : RUNNING;
         reg[primaryPid] = graph_id;
+        if (options.notify_ready && options.start_timeout > 0) {
+            start_timer = handler->schedule_timer(options.start_timeout * 1000ull, [this]() {
+                start_timer = 0;
+                if (state == STARTING) {
+                    LOG->error("{0} didn't report readiness within {1}s (start_timeout)", name, options.start_timeout);
+                    ready_timed_out = true;
+                    stop(false);
+                }
+            });
+        }
+        if (options.on_demand && options.idle_timeout > 0) {
+            idle_checks = 0;
+            schedule_idle_check();
+        }
+    }
+
+    void ChildProcess::wait_for_activation(int epoll_fd, std::map<int, unsigned int>& map,
+                                           std::map<int, ProcessHandlerInterface::FDType>& fd_type) noexcept(false) {
+        if (!options.on_demand || state != READY || parked || activated || activation_armed) {
+            return;
+        }
+        for (const auto& socket : options.sockets) {
+            int fd = socket->get_fd();
+            if (fd == -1) {
+                continue;
+            }
+            struct epoll_event setup {};
+            setup.data.fd = fd;
+            setup.events = EPOLLIN;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &setup) == -1) {
+                throw ChildProcessException("Couldn't bind listening socket to epoll socket!");
+            }
+            map[fd] = graph_id;
+            fd_type[fd] = ProcessHandlerInterface::FDType::LISTEN;
+        }
+        activation_armed = true;
+        LOG->info("Program {0} will be started on the first connection", name);
+    }
+
+    void ChildProcess::stop(bool restart) {
+        if ((state != RUNNING && state != STARTING) || primaryPid <= 0) {
+            return;
+        }
+        stop_requested = true;
+        restart_requested = restart;
+        // A paused process wouldn't handle SIGTERM before the stop timeout
+        set_paused(false);
+        LOG->info("Stopping {0} (PID {1}){2}", name, primaryPid, restart ? " for restart" : "");
+        kill(primaryPid, SIGTERM);
+        if (options.stop_timeout > 0 && stop_timer == 0) {
+            stop_timer = handler->schedule_timer(options.stop_timeout * 1000ull, [this, pid = primaryPid]() {
+                stop_timer = 0;
+                if ((state == RUNNING || state == STARTING) && primaryPid == pid) {
+                    LOG->warn("{0} (PID {1}) didn't stop within {2}s, killing it", name, pid, options.stop_timeout);
+                    kill(pid, SIGKILL);
+                }
+            });
+        }
+    }
+
+    void ChildProcess::set_parked(bool park) noexcept {
+        if (parked == park) {
+            return;
+        }
+        parked = park;
+        LOG->info("{0} {1}", park ? "Parking" : "Unparking", name);
+        if (park) {
+            stop(false);
+        }
+    }
+
+    bool ChildProcess::is_parked() const noexcept { return parked; }
+
+    void ChildProcess::set_paused(bool pause) noexcept {
+        if (paused == pause || primaryPid <= 0 || (pause && state != RUNNING && state != STARTING)) {
+            return;
+        }
+        // Freezing the cgroup also stops everything the program forked, a signal only reaches the main process
+        if (!cgroup || !cgroup->set_frozen(pause)) {
+            kill(primaryPid, pause ? SIGSTOP : SIGCONT);
+        }
+        paused = pause;
+        LOG->info("{0} {1}", pause ? "Pausing" : "Resuming", name);
+    }
+
+    bool ChildProcess::is_paused() const noexcept { return paused; }
+
+    bool ChildProcess::has_connections() const noexcept {
+        // Pending connections (or datagrams) on one of our sockets
+        for (const auto& socket : options.sockets) {
+            struct pollfd pfd {};
+            pfd.fd = socket->get_fd();
+            pfd.events = POLLIN;
+            if (pfd.fd != -1 && poll(&pfd, 1, 0) > 0) {
+                return true;
+            }
+        }
+        // Connections the program accepted on one of our sockets. Other sockets it holds (database pools, syslog,
+        // netlink, ...) don't count, an accepted socket is recognised by sharing the listener's local port or path.
+        auto proc_path = "/proc/" + std::to_string(primaryPid);
+        DIR* dir = opendir((proc_path + "/fd").c_str());
+        if (dir == nullptr) {
+            return false;
+        }
+        std::set<unsigned long> inodes;
+        std::array<char, 32> target{};
+        while (auto entry = readdir(dir)) {
+            auto link = proc_path + "/fd/" + static_cast<const char*>(entry->d_name);
+            auto len = readlink(link.c_str(), target.data(), target.size() - 1);
+            if (len > 8 && std::strncmp(target.data(), "socket:[", 8) == 0) {
+                target[len] = '\0';
+                inodes.insert(std::strtoul(target.data() + 8, nullptr, 10));
+            }
+        }
+        closedir(dir);
+        if (inodes.empty()) {
+            return false;
+        }
+
+        std::set<unsigned int> ports;
+        std::set<std::string> paths;
+        for (const auto& socket : options.sockets) {
+            if (socket->get_type() == ListenSocket::TCP) {
+                ports.insert(socket->get_port());
+            } else if (socket->get_type() == ListenSocket::UNIX) {
+                paths.insert(socket->get_address());
+            }
+        }
+        // The program's own view of the tables, it may live in another network namespace
+        for (const char* table : {"/net/tcp", "/net/tcp6"}) {
+            if (ports.empty()) {
+                break;
+            }
+            std::ifstream file(proc_path + table);
+            std::string line, slot, local, remote, state, queues, timer, retransmits, uid, timeout;
+            unsigned long inode;
+            std::getline(file, line);  // Header
+            while (std::getline(file, line)) {
+                std::istringstream fields(line);
+                if (!(fields >> slot >> local >> remote >> state >> queues >> timer >> retransmits >> uid >> timeout >>
+                      inode) ||
+                    inodes.count(inode) == 0 || state == "0A") {  // 0A: TCP_LISTEN
+                    continue;
+                }
+                auto colon = local.rfind(':');
+                if (colon != std::string::npos &&
+                    ports.count(std::strtoul(local.c_str() + colon + 1, nullptr, 16)) > 0) {
+                    return true;
+                }
+            }
+        }
+        if (!paths.empty()) {
+            std::ifstream file(proc_path + "/net/unix");
+            std::string line, slot, refcount, protocol, flags, type, state, path;
+            unsigned long inode;
+            std::getline(file, line);  // Header
+            while (std::getline(file, line)) {
+                std::istringstream fields(line);
+                // Accepted sockets report the path of the listener they came from, 03: SS_CONNECTED
+                if (fields >> slot >> refcount >> protocol >> flags >> type >> state >> inode &&
+                    std::getline(fields >> std::ws, path) && state == "03" && inodes.count(inode) > 0 &&
+                    paths.count(path) > 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ChildProcess::schedule_idle_check() noexcept {
+        // Check once per second (or more often for very short timeouts) whether the program still has work
+        const uint64_t interval = std::min(1000ull, options.idle_timeout * 1000ull);
+        idle_timer = handler->schedule_timer(interval, [this, interval]() {
+            idle_timer = 0;
+            if (state != RUNNING || stop_requested) {
+                return;
+            }
+            if (has_connections()) {
+                idle_checks = 0;
+            } else if (++idle_checks * interval >= options.idle_timeout * 1000ull) {
+                LOG->info("{0} had no connections for {1}s, stopping it", name, options.idle_timeout);
+                stop(false);
+                return;
+            }
+            schedule_idle_check();
+        });
+    }
+
+    bool ChildProcess::pass_sockets() noexcept {
+        // Sockets are passed starting at fd 3 (SD_LISTEN_FDS_START). Move them above that range first so that the
+        // dup2() calls below can't clobber a socket that hasn't been moved yet.
+        const int first_fd = 3;
+        const int count = static_cast<int>(options.sockets.size());
+        size_t i = 0;
+        for (const auto& socket : options.sockets) {
+            // NOLINTNEXTLINE(hicpp-vararg)
+            socket_fds[i] = fcntl(socket->get_fd(), F_DUPFD_CLOEXEC, first_fd + count);
+            if (socket_fds[i] == -1) {
+                return false;
+            }
+            i++;
+        }
+        for (i = 0; i < socket_fds.size(); i++) {
+            // dup2 clears FD_CLOEXEC on the target, so these survive the exec
+            if (dup2(socket_fds[i], first_fd + static_cast<int>(i)) == -1) {
+                return false;
+            }
+            close(socket_fds[i]);
+        }
+        return true;
+    }
+
+    pid_t ChildProcess::spawn_from_zygote(const std::list<std::string>& environment) noexcept {
+        try {
+            // The first instance to start provides the privilege drop, all instances share uid, gid and caps
+            options.zygote->start([this]() { return apply_scheduling() && handle_caps(); });
+            std::vector<int> fds = {stdout[1], stderr[1]};
+            for (const auto& socket : options.sockets) {
+                fds.push_back(socket->get_fd());
+            }
+            return options.zygote->spawn(path, args, environment, fds, !options.sockets.empty());
+        } catch (ChildProcessException& e) {
+            LOG->warn("Couldn't spawn {0} from zygote ({1}), forking directly", name, e.what());
+            return -1;
+        }
+    }
+
+    bool ChildProcess::should_restart(int rc) const noexcept {
+        switch (options.restart) {
+            case ProgramOptions::NEVER:
+                return false;
+            case ProgramOptions::ON_FAILURE:
+                return oom_killed || (rc != 0 && !stop_requested);
+            case ProgramOptions::ALWAYS:
+                return oom_killed || !stop_requested;
+        }
+        return false;
+    }
+
+    void ChildProcess::backoff() noexcept {
+        // A process that stayed up for a while had a fresh start, otherwise each restart waits twice as long
+        auto uptime = std::chrono::steady_clock::now() - started_at;
+        if (uptime >= std::chrono::seconds(RESTART_DELAY_MAX_S)) {
+            quick_restarts = 0;
+        }
+        unsigned int delay = std::min(RESTART_DELAY_MAX_S, 1u << std::min(quick_restarts, 16u));
+        quick_restarts++;
+        state = BACKOFF;
+        LOG->warn("Restarting {0} in {1}s", name, delay);
+        backoff_timer = handler->schedule_timer(delay * 1000ull, [this]() {
+            backoff_timer = 0;
+            if (state == BACKOFF) {
+                state = READY;
+            }
+        });
+    }
+
+    void ChildProcess::log_usage() const noexcept {
+        if (!cgroup) {
+            return;
+        }
+        auto usage = cgroup->read_usage();
+        LOG->info("{0} used {1:.2f}s CPU, {2} MiB memory at peak, {3} OOM kill(s) so far", name,
+                  static_cast<double>(usage.cpu_usec) / 1e6, usage.memory_peak / (1024 * 1024), usage.oom_kills);
+    }
+
+    bool ChildProcess::apply_scheduling() noexcept {
+        if (!options.scheduling) {
+            return true;
+        }
+        auto failed = options.scheduling->apply();
+        if (failed != nullptr) {
+            LOG->critical("Couldn't apply {0} ({1}), aborting now!", failed, std::strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void ChildProcess::bind_sockets() noexcept {
+        for (const auto& socket : options.sockets) {
+            try {
+                socket->bind();
+            } catch (ChildProcessException& e) {
+                fail("socket " + socket->describe() + ": " + e.what());
+                return;
+            }
+        }
     }
 
     void ChildProcess::register_with_epoll(int epoll_fd, std::map<int, unsigned int>& map,
@@ -365,13 +741,56 @@ namespace scinit {
         }
         map[stdout[0]] = graph_id;
         map[stderr[0]] = graph_id;
-        fd_type[stdout[0]] = ProcessHandlerInterface::FDType::STDOUT;
-        fd_type[stderr[0]] = ProcessHandlerInterface::FDType::STDERR;
+        bool passthrough = options.output != ProgramOptions::OUTPUT_LOG;
+        fd_type[stdout[0]] = passthrough ? ProcessHandlerInterface::FDType::PASSTHROUGH_STDOUT
+                                         : ProcessHandlerInterface::FDType::STDOUT;
+        fd_type[stderr[0]] = passthrough ? ProcessHandlerInterface::FDType::PASSTHROUGH_STDERR
+                                         : ProcessHandlerInterface::FDType::STDERR;
+
+        // The cgroup outlives the process, so its events file is only registered once
+        if (cgroup && cgroup->get_events_fd() != -1 && !memory_events_registered) {
+            int fd = cgroup->get_events_fd();
+            setup.data.fd = fd;
+            setup.events = EPOLLPRI;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &setup) == -1) {
+                throw ChildProcessException("Couldn't bind memory.events to epoll socket!");
+            }
+            map[fd] = graph_id;
+            fd_type[fd] = ProcessHandlerInterface::FDType::MEMORY_EVENTS;
+            memory_events_registered = true;
+        }
     }
 
     std::string ChildProcess::get_name() const noexcept { return name; }
 
-    bool ChildProcess::can_start_now() const noexcept { return state == READY; }
+    std::string ChildProcess::get_group_name() const noexcept { return options.group.empty() ? name : options.group; }
+
+    std::string ChildProcess::get_path() const noexcept { return path; }
+
+    const ProgramOptions& ChildProcess::get_options() const noexcept { return options; }
+
+    unsigned int ChildProcess::get_start_count() const noexcept { return start_count; }
+
+    bool ChildProcess::can_start_now() const noexcept {
+        return state == READY && !parked && (!options.on_demand || activated);
+    }
+
+    std::list<unsigned int> ChildProcess::get_dependencies() const noexcept {
+        std::list<unsigned int> ids;
+        for (const auto& condition : conditions) {
+            ids.push_back(condition.first);
+        }
+        return ids;
+    }
+
+    void ChildProcess::fail(const std::string& reason) noexcept {
+        LOG->error("Program {0} failed to start: {1}", name, reason);
+        state = FAILED;
+        if (start_timer != 0) {
+            handler->cancel_timer(start_timer);
+            start_timer = 0;
+        }
+    }
 
     void ChildProcess::should_wait_for(unsigned int other_process, ProcessState other_state) noexcept {
         bool contains =
@@ -391,16 +810,22 @@ namespace scinit {
 
     void ChildProcess::propagate_dependencies(
       std::list<std::weak_ptr<scinit::ChildProcessInterface>> other_processes) noexcept {
-        auto func = [&other_processes, classref = this](auto dependency, bool other_or_this) {
+        // A dependency names either a single process or all instances of a program that are started initially
+        auto matches = [](const std::shared_ptr<ChildProcessInterface>& ref, const std::string& dependency) {
+            return ref->get_name() == dependency ||
+                   (ref->get_group_name() == dependency && !ref->get_options().start_parked);
+        };
+        auto func = [&other_processes, &matches, classref = this](auto dependency, bool other_or_this) {
             for (const auto& weak_ref : other_processes) {
                 if (auto ref = weak_ref.lock()) {
-                    if (ref->get_name() == dependency) {
+                    if (matches(ref, dependency)) {
                         if (other_or_this) {
                             ref->should_wait_for(classref->graph_id, classref->type == ONESHOT ? ProcessState::DONE :
                                                                                                  ProcessState::RUNNING);
                         } else {
+                            // The state to wait for depends on the type of the process we're waiting for
                             classref->should_wait_for(
-                              ref->get_id(), classref->type == ONESHOT ? ProcessState::DONE : ProcessState::RUNNING);
+                              ref->get_id(), ref->get_type() == ONESHOT ? ProcessState::DONE : ProcessState::RUNNING);
                         }
                     }
                 }
@@ -408,11 +833,30 @@ namespace scinit {
         };
         std::for_each(before.begin(), before.end(), [&func](auto arg) { func(arg, true); });
         std::for_each(after.begin(), after.end(), [&func](auto arg) { func(arg, false); });
+        // Required programs are waited for like 'after' and additionally remembered for failure propagation
+        for (const auto& dependency : options.required) {
+            func(dependency, false);
+            for (const auto& weak_ref : other_processes) {
+                if (auto ref = weak_ref.lock()) {
+                    if (matches(ref, dependency)) {
+                        required_ids.insert(ref->get_id());
+                    }
+                }
+            }
+        }
         before.clear();
         after.clear();
         if (conditions.empty()) {
             state = READY;
         }
+        if (options.start_timeout > 0 && start_timer == 0) {
+            start_timer = handler->schedule_timer(options.start_timeout * 1000ull, [this]() {
+                start_timer = 0;
+                if (state == BLOCKED || state == READY) {
+                    fail("not started within " + std::to_string(options.start_timeout) + "s (start_timeout)");
+                }
+            });
+        }
     }
 
     ChildProcessInterface::ProcessState ChildProcess::get_state() const noexcept { return state; }
@@ -420,6 +864,22 @@ namespace scinit {
     void ChildProcess::notify_of_state(
       std::map<unsigned int, std::weak_ptr<ChildProcessInterface>> other_procs) noexcept {
         if (state == BLOCKED) {
+            // Fail fast if a required process ended up in a state it will never leave without reaching the state
+            // we're waiting for
+            for (const auto& condition : conditions) {
+                if (required_ids.count(condition.first) == 0 || other_procs.count(condition.first) == 0) {
+                    continue;
+                }
+                if (auto ptr = other_procs[condition.first].lock()) {
+                    auto other_state = ptr->get_state();
+                    bool terminal = other_state == DONE || other_state == CRASHED || other_state == FAILED;
+                    if (terminal && other_state != condition.second) {
+                        fail("required program " + ptr->get_name() + " failed");
+                        return;
+                    }
+                }
+            }
+
             bool still_blocked = std::accumulate(
               conditions.begin(), conditions.end(), false, [&other_procs](bool blocked, auto condition) {
                   if (blocked) {
@@ -455,14 +915,79 @@ namespace scinit {
             case ProcessHandlerInterface::ProcessEvent::SIGHUP:
                 break;
             case ProcessHandlerInterface::ProcessEvent::EXIT:
-                if (state != RUNNING) {
+                if (state != RUNNING && state != STARTING) {
                     LOG->warn("Child process object in state {0} notified of exit?", state);
                 }
-                if (data == 0) {
+                for (auto timer : {start_timer, stop_timer, idle_timer}) {
+                    if (timer != 0) {
+                        handler->cancel_timer(timer);
+                    }
+                }
+                start_timer = stop_timer = idle_timer = 0;
+                if (paused && cgroup) {
+                    // Killed while frozen, the next process must not start frozen
+                    cgroup->set_frozen(false);
+                }
+                paused = false;
+                log_usage();
+                if (ready_timed_out) {
+                    state = FAILED;
+                } else if (parked) {
+                    // Stays READY, but isn't started again before it's unparked
+                    state = READY;
+                } else if (stop_requested && restart_requested) {
+                    state = READY;
+                } else if (options.on_demand) {
+                    // Wait for the next connection
+                    state = READY;
+                    activated = false;
+                } else if (should_restart(data)) {
+                    backoff();
+                } else if (data == 0 || stop_requested) {
                     state = DONE;
                 } else {
                     state = CRASHED;
                 }
+                stop_requested = restart_requested = ready_timed_out = oom_killed = false;
+                break;
+            case ProcessHandlerInterface::ProcessEvent::UNSATISFIABLE:
+                if (state == BLOCKED || state == READY) {
+                    fail("dependency cycle");
+                }
+                break;
+            case ProcessHandlerInterface::ProcessEvent::NOTIFY_READY:
+                if (state == STARTING) {
+                    LOG->info("{0} is ready", name);
+                    if (start_timer != 0) {
+                        handler->cancel_timer(start_timer);
+                        start_timer = 0;
+                    }
+                    state = RUNNING;
+                }
+                break;
+            case ProcessHandlerInterface::ProcessEvent::MEMORY_EVENT: {
+                if (!cgroup) {
+                    break;
+                }
+                auto kills = cgroup->read_usage().oom_kills;
+                if (kills > oom_kills) {
+                    LOG->error("{0}: {1} process(es) killed by the OOM killer (memory_max: {2})", name,
+                               kills - oom_kills, options.memory_max.empty() ? "none" : options.memory_max);
+                    oom_kills = kills;
+                    if (state == RUNNING || state == STARTING) {
+                        oom_killed = true;
+                        // The program lost a process, restart all of it if there's a restart policy
+                        if (options.restart != ProgramOptions::NEVER) {
+                            stop(false);
+                        }
+                    }
+                }
+                break;
+            }
+            case ProcessHandlerInterface::ProcessEvent::ACTIVATE:
+                LOG->info("Connection for on-demand program {0}, starting it", name);
+                activation_armed = false;
+                activated = true;
                 break;
         }
     }
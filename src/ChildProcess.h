@@ -18,14 +18,18 @@
 #define CINIT_CHILDPROCESS_H
 
 #include "gtest/gtest_prod.h"
+#include <chrono>
 #include <list>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
+#include "Cgroup.h"
 #include "ChildProcessInterface.h"
 #include "ProcessHandlerInterface.h"
+#include "ProgramOptions.h"
 
 namespace scinit {
     class ProcessLifecycleTests;
@@ -36,21 +40,35 @@ namespace scinit {
         ChildProcess(std::string, std::string, std::list<std::string>, std::string, std::list<std::string>,
                      unsigned int, unsigned int, unsigned int, const std::shared_ptr<ProcessHandlerInterface> &,
                      std::list<std::string>, std::list<std::string>, bool, bool, std::list<std::string>,
-                     std::list<std::pair<std::string, std::string>>);
+                     std::list<std::pair<std::string, std::string>>, ProgramOptions);
 
         ChildProcess(const ChildProcess &) = delete;
         virtual ChildProcess &operator=(const ChildProcess &) = delete;
-        ~ChildProcess() override = default;
+        ~ChildProcess() override;
 
         void do_fork(std::map<int, unsigned int> &) noexcept(false) override;
         void register_with_epoll(int, std::map<int, unsigned int> &,
                                  std::map<int, ProcessHandlerInterface::FDType> &) noexcept(false) override;
+        void wait_for_activation(int, std::map<int, unsigned int> &,
+                                 std::map<int, ProcessHandlerInterface::FDType> &) noexcept(false) override;
+        void stop(bool restart) override;
+        void set_parked(bool parked) noexcept override;
+        bool is_parked() const noexcept override;
+        void set_paused(bool paused) noexcept override;
+        bool is_paused() const noexcept override;
         std::string get_name() const noexcept override;
+        std::string get_group_name() const noexcept override;
+        std::string get_path() const noexcept override;
         unsigned int get_id() const noexcept override;
+        ProcessType get_type() const noexcept override;
         bool can_start_now() const noexcept override;
+        const ProgramOptions &get_options() const noexcept override;
+        unsigned int get_start_count() const noexcept override;
+        std::list<unsigned int> get_dependencies() const noexcept override;
         void notify_of_state(std::map<unsigned int, std::weak_ptr<ChildProcessInterface>>) noexcept override;
         void propagate_dependencies(std::list<std::weak_ptr<ChildProcessInterface>>) noexcept override;
         void should_wait_for(unsigned int, ProcessState) noexcept override;
+        void bind_sockets() noexcept override;
         void handle_process_event(ProcessHandlerInterface::ProcessEvent event, int data) noexcept override;
         ProcessState get_state() const noexcept override;
 
@@ -67,26 +85,75 @@ namespace scinit {
         bool want_tty, want_default_env;
         ProcessType type;
         ProcessState state;
+        ProgramOptions options;
+        // Dependencies that cause this process to fail if they fail
+        std::unordered_set<unsigned int> required_ids;
+        ProcessHandlerInterface::TimerId start_timer = 0, stop_timer = 0, idle_timer = 0;
+        bool stop_requested = false, restart_requested = false;
+        // On-demand activation: sockets registered with epoll / connection arrived
+        bool activation_armed = false, activated = false;
+        unsigned int idle_checks = 0, start_count = 0;
+        // Killed because it didn't report readiness in time, this ends in FAILED
+        bool ready_timed_out = false;
+        bool parked = false;
+        // Paused by load shedding
+        bool paused = false;
+        // Resource limits and accounting, created on the first start of a program with limits
+        std::unique_ptr<Cgroup> cgroup;
+        bool memory_events_registered = false, oom_killed = false;
+        uint64_t oom_kills = 0;
+        // Restart policy: restarts in a row that didn't stay up for long and the start of the current process
+        unsigned int quick_restarts = 0;
+        std::chrono::steady_clock::time_point started_at;
+        ProcessHandlerInterface::TimerId backoff_timer = 0;
 
         std::unordered_set<std::string> allowed_env_vars = {"HOME", "LANG",  "LANGUAGE", "LOGNAME", "PATH",
                                                             "PWD",  "SHELL", "TERM",     "USER"};
         std::list<std::pair<std::string, std::string>> env_extra_vars;
         virtual bool handle_caps();
         virtual std::list<std::string> handle_env();
+        void fail(const std::string &reason) noexcept;
+        bool pass_sockets() noexcept;
+        pid_t spawn_from_zygote(const std::list<std::string> &environment) noexcept;
+        void schedule_idle_check() noexcept;
+        // Runs in the child before exec (or in the zygote), like handle_caps()
+        bool apply_scheduling() noexcept;
+        bool should_restart(int rc) const noexcept;
+        void backoff() noexcept;
+        void log_usage() const noexcept;
+        bool has_connections() const noexcept;
+        // Scratch space for pass_sockets(), allocated before fork()
+        std::vector<int> socket_fds;
 
         FRIEND_TEST(ConfigParserTests, SmokeTestConfig);
         FRIEND_TEST(ConfigParserTests, SimpleConfDTest);
         FRIEND_TEST(ConfigParserTests, ConfigWithDeps);
         FRIEND_TEST(ConfigParserTests, ConfigWithNamedUser);
         FRIEND_TEST(ConfigParserTests, ComplexEnvConfig);
+        FRIEND_TEST(ConfigParserTests, ConfigWithRequires);
+        FRIEND_TEST(ConfigParserTests, ConfigWithSockets);
+        FRIEND_TEST(ConfigParserTests, ConfigWithOnDemandActivation);
+        FRIEND_TEST(ConfigParserTests, ConfigWithInstances);
+        FRIEND_TEST(ConfigParserTests, ConfigWithResourceLimits);
+        FRIEND_TEST(ConfigParserTests, ConfigWithScheduling);
+        FRIEND_TEST(ConfigParserTests, ConfigWithNumaSpread);
+        FRIEND_TEST(ConfigParserTests, ConfigWithLogFiles);
+        FRIEND_TEST(ProcessLifecycleTests, CrashedProcessIsRestartedWithBackoff);
+        FRIEND_TEST(ProcessLifecycleTests, NotifyReadyGatesDependants);
+        FRIEND_TEST(ProcessLifecycleTests, RollingRestartInBatches);
+        FRIEND_TEST(ProcessLifecycleTests, AutoscalingParksAndUnparksInstances);
+        FRIEND_TEST(ProcessLifecycleTests, ParallelStartsPreferPriorityAndCriticalPath);
         FRIEND_TEST(ProcessLifecycleTests, SingleProcessLifecycle);
         FRIEND_TEST(ProcessLifecycleTests, TwoDependantOneshotProcessesLifecycle);
         FRIEND_TEST(ProcessLifecycleTests, TwoDependantSimpleProcessesLifecycle);
+        FRIEND_TEST(ProcessLifecycleTests, RequiredDependencyFailurePropagates);
+        FRIEND_TEST(ProcessLifecycleTests, DependencyCycleIsDetected);
         FRIEND_TEST(IntegrationTests, TestStdOutErr);
         FRIEND_TEST(IntegrationTests, TestPty);
         FRIEND_TEST(IntegrationTests, TestPrivDrop);
         FRIEND_TEST(IntegrationTests, TestEnvFilter);
         FRIEND_TEST(IntegrationTests, TestComplexEnv);
+        FRIEND_TEST(IntegrationTests, TestSignalMask);
         friend class ProcessLifecycleTests;
     };
 }  // namespace scinit
@@ -20,6 +20,7 @@
 #include <list>
 #include <string>
 #include "ProcessHandler.h"
+#include "ProgramOptions.h"
 
 namespace scinit {
     class ChildProcessInterface : public std::enable_shared_from_this<ChildProcessInterface> {
@@ -44,17 +45,33 @@ namespace scinit {
          * When a new ChildProcess is created, it starts in either BLOCKED or READY state, depending whether it has
          * any dependencies that need to be fulfilled. A process moves from READY to RUNNING via an event when the
          * actual fork() takes place, when it exits, it moves (event) to DONE (type oneshot) or CRASHED (type simple).
+         * Processes that report readiness (sd_notify READY=1) are STARTING between the fork() and that report and
+         * only count as RUNNING afterwards.
          * At some point, CRASHED processes should move (possibly via backoff) to READY so that they can be started
-         * again.
+         * again. A process that can never be started (start timeout, a required dependency failed or a dependency
+         * cycle) moves from BLOCKED or READY to FAILED and stays there.
          */
-        enum ProcessState { BLOCKED, READY, RUNNING, DONE, CRASHED, BACKOFF };
+        enum ProcessState { BLOCKED, READY, STARTING, RUNNING, DONE, CRASHED, BACKOFF, FAILED };
 
         // Fork, and register the pid to the current object
         virtual void do_fork(std::map<int, unsigned int>&) = 0;
 
         virtual std::string get_name() const = 0;
+        // Name of the program entry this process is an instance of, equal to get_name() for single instances
+        virtual std::string get_group_name() const = 0;
+        // Executable as given in the config, looked up in PATH on exec
+        virtual std::string get_path() const = 0;
         virtual unsigned int get_id() const = 0;
+        virtual ProcessType get_type() const = 0;
         virtual bool can_start_now() const = 0;
+        virtual const ProgramOptions& get_options() const = 0;
+        // Number of times this process has been forked
+        virtual unsigned int get_start_count() const = 0;
+
+        /*
+         * IDs of all processes this process is currently waiting for. Used to detect dependency cycles.
+         */
+        virtual std::list<unsigned int> get_dependencies() const = 0;
 
         /*
          * In order to handle stdout/stderr forwarding, the pipe needs to be registered with epoll,
@@ -63,6 +80,31 @@ namespace scinit {
         virtual void register_with_epoll(int epollfd, std::map<int, unsigned int>& fd_to_obj,
                                          std::map<int, ProcessHandlerInterface::FDType>& fd_type) = 0;
 
+        /*
+         * Called by the process handler on every pass. If this process is started on demand and waiting for its
+         * first connection, its listening sockets are registered with epoll (as FDType::LISTEN). The process
+         * handler unregisters them and sends an ACTIVATE event once a connection arrives.
+         */
+        virtual void wait_for_activation(int epollfd, std::map<int, unsigned int>& fd_to_obj,
+                                         std::map<int, ProcessHandlerInterface::FDType>& fd_type) = 0;
+
+        /*
+         * Parked processes are never started. Parking a running process stops it, unparking makes it startable
+         * again. Used to scale instance groups.
+         */
+        virtual void set_parked(bool parked) = 0;
+        virtual bool is_parked() const = 0;
+
+        // Pause a running process (cgroup freeze or SIGSTOP) to relieve memory pressure, or let it continue
+        virtual void set_paused(bool paused) = 0;
+        virtual bool is_paused() const = 0;
+
+        /*
+         * Ask a running process to terminate (SIGTERM, SIGKILL after the stop timeout). If 'restart' is set, the
+         * process moves back to READY once it exited so that it is started again.
+         */
+        virtual void stop(bool restart) = 0;
+
         /*
          * This function is called by the process handler with a list of all existing processes as an argument.
          * It is supposed to advance the internal state machine.
@@ -75,6 +117,12 @@ namespace scinit {
          */
         virtual void propagate_dependencies(std::list<std::weak_ptr<ChildProcessInterface>>) = 0;
 
+        /*
+         * This function is called once by the process handler before any process is started. It binds all listening
+         * sockets of this process, so that clients can connect before the process is actually running.
+         */
+        virtual void bind_sockets() = 0;
+
         /*
          * This function is called by another process if we need to wait for it to reach a certain state.
          * */
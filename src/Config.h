@@ -19,22 +19,39 @@
 
 #include <grp.h>
 #include <pwd.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <yaml-cpp/yaml.h>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <algorithm>
 #include <numeric>
+#include <tuple>
+#include <vector>
 #include "ChildProcess.h"
 #include "Config.h"
 #include "ConfigInterface.h"
 #include "ConfigParseException.h"
+#include "ListenSocket.h"
 #include "ProcessHandler.h"
+#include "ProgramOptions.h"
+#include "RingFile.h"
+#include "Scheduling.h"
+#include "SystemResources.h"
+#include "inja.hpp"
 #include "log.h"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
+// Used if only one of crash_log_lines and crash_log_bytes is given
+#define DEFAULT_CRASH_LOG_LINES 100
+#define DEFAULT_CRASH_LOG_BYTES 65536
+#define DEFAULT_RING_FILE_SIZE (4 * 1024 * 1024)
+#define DEFAULT_MULTILINE_TIMEOUT_MS 100
+#define DEFAULT_MULTILINE_MAX_BYTES 65536
+
 namespace scinit {
     class ProcessHandlerInterface;
 
@@ -48,6 +65,7 @@ namespace scinit {
                 throw ConfigParseException("This constructor is for single files only!");
             }
             load_file(path);
+            partition_cpus();
             LOG->info("Config loaded");
         }
 
@@ -56,6 +74,7 @@ namespace scinit {
             for (auto file : files) {
                 load_file(file);
             }
+            partition_cpus();
             LOG->info("Config loaded");
         }
 
@@ -95,6 +114,33 @@ namespace scinit {
             return std::move(list);
         }
 
+        std::list<std::shared_ptr<ListenSocket>> parse_sockets(const YAML::Node& node, const std::string& program) {
+            std::list<std::shared_ptr<ListenSocket>> sockets;
+            for (auto socket : node) {
+                auto type = ListenSocket::type_from_string(socket["type"] ? socket["type"].as<std::string>() : "tcp");
+                std::string address;
+                unsigned int port = 0;
+                if (type == ListenSocket::SocketType::UNIX) {
+                    if (!socket["path"]) {
+                        throw ConfigParseException("Unix socket without 'path'!");
+                    }
+                    address = socket["path"].as<std::string>();
+                } else {
+                    if (!socket["port"]) {
+                        throw ConfigParseException("TCP/UDP socket without 'port'!");
+                    }
+                    port = socket["port"].as<unsigned int>();
+                    address = socket["address"] ? socket["address"].as<std::string>() : "0.0.0.0";
+                }
+                // The name is what the program sees in LISTEN_FDNAMES
+                std::string name = socket["name"] ? socket["name"].as<std::string>() : program;
+                int backlog = socket["backlog"] ? socket["backlog"].as<int>() : SOMAXCONN;
+                bool reuseport = socket["reuseport"] ? socket["reuseport"].as<bool>() : false;
+                sockets.push_back(std::make_shared<ListenSocket>(name, type, address, port, backlog, reuseport));
+            }
+            return sockets;
+        }
+
         void parse_file(const YAML::Node& rootNode) {
             YAML::Node programs = rootNode["programs"];
             for (auto program = programs.begin(); program != programs.end(); program++) {
@@ -191,16 +237,667 @@ namespace scinit {
                     }
                 }
 
-                auto process =
-                  std::make_shared<CTYPE>((*program)["name"].as<std::string>(), (*program)["path"].as<std::string>(),
-                                          arg_list, type, capabilities, uid, gid, child_counter++, handler, before,
-                                          after, want_tty, want_default_env, env_extra_whitelist, env_extra_vars);
-                processes.push_back(process);
-                handler->register_obj_id(process->get_id(), process);
+                ProgramOptions options;
+                if ((*program)["start_timeout"]) {
+                    options.start_timeout = (*program)["start_timeout"].as<unsigned int>();
+                }
+                options.required = yaml_node_to_str_list(program, "requires");
+                if ((*program)["sockets"]) {
+                    options.sockets = parse_sockets((*program)["sockets"], (*program)["name"].as<std::string>());
+                }
+                if ((*program)["activation"]) {
+                    auto activation = (*program)["activation"].as<std::string>();
+                    if (activation == "on-demand") {
+                        options.on_demand = true;
+                    } else if (activation != "immediate") {
+                        throw ConfigParseException("Unknown activation mode, expected 'immediate' or 'on-demand'!");
+                    }
+                    if (options.on_demand && options.sockets.empty()) {
+                        LOG->warn("Program {0} is on-demand but has no sockets, starting it immediately",
+                                  (*program)["name"].as<std::string>());
+                        options.on_demand = false;
+                    }
+                }
+                if ((*program)["idle_timeout"]) {
+                    options.idle_timeout = (*program)["idle_timeout"].as<unsigned int>();
+                }
+                if ((*program)["stop_timeout"]) {
+                    options.stop_timeout = (*program)["stop_timeout"].as<unsigned int>();
+                }
+                if ((*program)["ready"]) {
+                    auto ready = (*program)["ready"].as<std::string>();
+                    if (ready == "notify") {
+                        options.notify_ready = true;
+                    } else if (ready != "started") {
+                        throw ConfigParseException("Unknown readiness mode, expected 'started' or 'notify'!");
+                    }
+                }
+                if ((*program)["output"]) {
+                    auto output = (*program)["output"].as<std::string>();
+                    if (output == "passthrough") {
+                        options.output = ProgramOptions::OUTPUT_PASSTHROUGH;
+                    } else if (output == "tee") {
+                        options.output = ProgramOptions::OUTPUT_TEE;
+                    } else if (output != "log") {
+                        throw ConfigParseException("Unknown output mode, expected 'log', 'passthrough' or 'tee'!");
+                    }
+                    if (options.output != ProgramOptions::OUTPUT_LOG && want_tty) {
+                        throw ConfigParseException("Output can only be passed through from pipes, not from a PTY!");
+                    }
+                }
+                if ((*program)["output_file"]) {
+                    options.output_file = (*program)["output_file"].as<std::string>();
+                }
+                if (options.output == ProgramOptions::OUTPUT_TEE && options.output_file.empty()) {
+                    throw ConfigParseException("'output: tee' needs an 'output_file'!");
+                }
+                if (options.output == ProgramOptions::OUTPUT_LOG && !options.output_file.empty()) {
+                    throw ConfigParseException("'output_file' needs 'output: passthrough' or 'output: tee'!");
+                }
+                if ((*program)["log_file"]) {
+                    parse_log_file((*program)["log_file"], options);
+                    if (options.output != ProgramOptions::OUTPUT_LOG) {
+                        throw ConfigParseException("'log_file' can't be combined with output passthrough!");
+                    }
+                }
+                if ((*program)["syslog"]) {
+                    parse_syslog((*program)["syslog"], options);
+                    if (options.output != ProgramOptions::OUTPUT_LOG) {
+                        throw ConfigParseException("'syslog' can't be combined with output passthrough!");
+                    }
+                }
+                if ((*program)["detect_level"]) {
+                    options.detect_level = (*program)["detect_level"].as<bool>();
+                }
+                if ((*program)["min_level"]) {
+                    options.min_level = parse_level((*program)["min_level"]);
+                }
+                if ((options.detect_level || (*program)["min_level"]) &&
+                    options.output != ProgramOptions::OUTPUT_LOG) {
+                    throw ConfigParseException(
+                      "'detect_level' and 'min_level' can't be combined with output passthrough!");
+                }
+                if ((*program)["multiline"]) {
+                    parse_multiline((*program)["multiline"], options);
+                    if (options.output != ProgramOptions::OUTPUT_LOG) {
+                        throw ConfigParseException("'multiline' can't be combined with output passthrough!");
+                    }
+                }
+                if ((*program)["filter"]) {
+                    parse_filter((*program)["filter"], options);
+                    if (options.output != ProgramOptions::OUTPUT_LOG) {
+                        throw ConfigParseException("'filter' can't be combined with output passthrough!");
+                    }
+                }
+                if ((*program)["crash_log_lines"] || (*program)["crash_log_bytes"]) {
+                    // Either limit alone gets a sensible default for the other one
+                    options.crash_log_lines = (*program)["crash_log_lines"]
+                                                ? (*program)["crash_log_lines"].as<unsigned int>()
+                                                : DEFAULT_CRASH_LOG_LINES;
+                    options.crash_log_bytes = (*program)["crash_log_bytes"] ? parse_size((*program)["crash_log_bytes"])
+                                                                            : DEFAULT_CRASH_LOG_BYTES;
+                    if (options.crash_log_lines == 0 || options.crash_log_bytes == 0) {
+                        throw ConfigParseException("crash_log_lines and crash_log_bytes have to be positive!");
+                    }
+                }
+                if ((*program)["ring_file"]) {
+                    const auto& ring = (*program)["ring_file"];
+                    options.ring_file = ring.IsScalar() ? ring.as<std::string>() : ring["path"].as<std::string>();
+                    options.ring_size = !ring.IsScalar() && ring["size"] ? parse_size(ring["size"])
+                                                                         : DEFAULT_RING_FILE_SIZE;
+                    if (options.ring_size < RING_FILE_MIN_CAPACITY) {
+                        throw ConfigParseException("The size of 'ring_file' has to be at least 64K!");
+                    }
+                }
+                if ((*program)["zygote"] && (*program)["zygote"].as<bool>()) {
+                    if (want_tty) {
+                        LOG->warn("Program {0} wants a PTY, which is set up per process, not using a zygote",
+                                  (*program)["name"].as<std::string>());
+                    } else {
+                        options.zygote = std::make_shared<Zygote>((*program)["name"].as<std::string>());
+                    }
+                }
+                if ((*program)["restart_batch"]) {
+                    options.restart_batch = (*program)["restart_batch"].as<unsigned int>();
+                }
+                if ((*program)["priority"]) {
+                    options.priority = (*program)["priority"].as<int>();
+                }
+                if ((*program)["memory_max"]) {
+                    options.memory_max = (*program)["memory_max"].as<std::string>();
+                }
+                if ((*program)["memory_high"]) {
+                    options.memory_high = (*program)["memory_high"].as<std::string>();
+                }
+                if ((*program)["cpu_weight"]) {
+                    options.cpu_weight = parse_weight((*program)["cpu_weight"]);
+                }
+                if ((*program)["io_weight"]) {
+                    options.io_weight = parse_weight((*program)["io_weight"]);
+                }
+                if ((*program)["cpu_max"]) {
+                    options.cpu_max = (*program)["cpu_max"].as<double>();
+                    if (options.cpu_max <= 0) {
+                        throw ConfigParseException("cpu_max has to be a positive number of CPUs!");
+                    }
+                }
+                if ((*program)["pids_max"]) {
+                    options.pids_max = (*program)["pids_max"].as<unsigned int>();
+                }
+                if ((*program)["max_rss"]) {
+                    options.max_rss_kib = parse_size_kib((*program)["max_rss"]);
+                }
+                if ((*program)["max_rss_growth_per_hour"]) {
+                    options.max_rss_growth_kib_per_hour = parse_size_kib((*program)["max_rss_growth_per_hour"]);
+                }
+                if ((*program)["sheddable"]) {
+                    auto shed = (*program)["sheddable"].as<std::string>();
+                    if (shed == "pause" || shed == "true") {
+                        options.sheddable = ProgramOptions::SHED_PAUSE;
+                    } else if (shed == "stop") {
+                        // The autoscaler would start the instance again right away
+                        if ((*program)["max_instances"]) {
+                            throw ConfigParseException("'sheddable: stop' can't be combined with autoscaling!");
+                        }
+                        options.sheddable = ProgramOptions::SHED_STOP;
+                    } else if (shed != "false") {
+                        throw ConfigParseException("Unknown shedding mode, expected 'pause' or 'stop'!");
+                    }
+                }
+                if ((*program)["restart"]) {
+                    auto restart = (*program)["restart"].as<std::string>();
+                    if (restart == "on-failure") {
+                        options.restart = ProgramOptions::ON_FAILURE;
+                    } else if (restart == "always") {
+                        options.restart = ProgramOptions::ALWAYS;
+                    } else if (restart != "never") {
+                        throw ConfigParseException(
+                          "Unknown restart policy, expected 'never', 'on-failure' or 'always'!");
+                    }
+                }
+                options.scheduling = parse_scheduling(*program);
+
+                auto name = (*program)["name"].as<std::string>();
+                // Also rejects NUMA placement of a single process
+                std::vector<resources::NumaNode> numa_nodes;
+                if ((*program)["numa"]) {
+                    numa_nodes = parse_numa(*program, options);
+                }
+                if (!(*program)["instances"] && !(*program)["max_instances"]) {
+                    auto process = std::make_shared<CTYPE>(name, (*program)["path"].as<std::string>(), arg_list, type,
+                                                           capabilities, uid, gid, child_counter++, handler, before,
+                                                           after, want_tty, want_default_env, env_extra_whitelist,
+                                                           env_extra_vars, options);
+                    processes.push_back(process);
+                    handler->register_obj_id(process->get_id(), process);
+                    continue;
+                }
+
+                // Everything above is shared, only the name, the instance number, templated args and the NUMA
+                // placement differ
+                auto group_scheduling = options.scheduling;
+                unsigned int instances = 1, created = 1;
+                if ((*program)["instances"]) {
+                    instances = created = parse_instances((*program)["instances"]);
+                }
+                if ((*program)["max_instances"]) {
+                    // Autoscaled: create all instances up front, the ones beyond the initial count start parked
+                    parse_autoscaling(*program, options);
+                    if ((*program)["instances"]) {
+                        instances = std::min(std::max(instances, options.min_instances), options.max_instances);
+                    } else {
+                        instances = options.min_instances;
+                    }
+                    created = options.max_instances;
+                }
+                options.group = name;
+                for (unsigned int instance = 0; instance < created; instance++) {
+                    options.instance = instance;
+                    options.start_parked = instance >= instances;
+                    nlohmann::json data;
+                    data["instance"] = instance;
+                    if (!numa_nodes.empty()) {
+                        place_on_node(numa_nodes, instance, group_scheduling, options);
+                        data["numa_node"] = options.numa_node;
+                    }
+                    std::list<std::string> instance_args;
+                    for (const auto& arg : arg_list) {
+                        instance_args.push_back(inja::render(arg, data));
+                    }
+                    auto process = std::make_shared<CTYPE>(
+                      name + "@" + std::to_string(instance), (*program)["path"].as<std::string>(), instance_args,
+                      type, capabilities, uid, gid, child_counter++, handler, before, after, want_tty,
+                      want_default_env, env_extra_whitelist, env_extra_vars, options);
+                    processes.push_back(process);
+                    handler->register_obj_id(process->get_id(), process);
+                }
+            }
+        }
+
+        // 'instances' is either a positive number or 'auto' (one per CPU available to us)
+        unsigned int parse_instances(const YAML::Node& node) noexcept(false) {
+            if (node.as<std::string>() == "auto") {
+                return resources::available_cpus();
+            }
+            auto instances = node.as<unsigned int>();
+            if (instances == 0) {
+                throw ConfigParseException("'instances' must be at least 1!");
+            }
+            return instances;
+        }
+
+        // cgroup v2 weights (cpu.weight, io.weight) are between 1 and 10000
+        unsigned int parse_weight(const YAML::Node& node) noexcept(false) {
+            auto weight = node.as<unsigned int>();
+            if (weight < 1 || weight > 10000) {
+                throw ConfigParseException("cgroup weights have to be between 1 and 10000!");
+            }
+            return weight;
+        }
+
+        // A memory size in bytes with an optional K, M or G suffix, returned in KiB
+        unsigned long parse_size_kib(const YAML::Node& node) noexcept(false) { return parse_size(node) / 1024; }
+
+        // The same, returned in bytes
+        unsigned long parse_size(const YAML::Node& node) noexcept(false) {
+            auto size = node.as<std::string>();
+            std::size_t end = 0;
+            unsigned long value = 0;
+            try {
+                value = std::stoul(size, &end);
+            } catch (std::exception&) {
+                throw ConfigParseException("Memory sizes have to be a number with an optional K, M or G suffix!");
+            }
+            auto suffix = size.substr(end);
+            if (suffix.empty()) {
+                return value;
+            }
+            if (suffix == "K" || suffix == "k") {
+                return value * 1024;
+            }
+            if (suffix == "M" || suffix == "m") {
+                return value * 1024 * 1024;
+            }
+            if (suffix == "G" || suffix == "g") {
+                return value * 1024 * 1024 * 1024;
+            }
+            throw ConfigParseException("Memory sizes have to be a number with an optional K, M or G suffix!");
+        }
+
+        // Either the path of a combined file or a map with 'path' and/or 'stdout' and 'stderr' and rotation settings
+        void parse_log_file(const YAML::Node& node, ProgramOptions& options) noexcept(false) {
+            auto& log_file = options.log_file;
+            if (node.IsScalar()) {
+                log_file.combined = node.as<std::string>();
+                return;
+            }
+            if (node["path"]) {
+                log_file.combined = node["path"].as<std::string>();
+            }
+            if (node["stdout"]) {
+                log_file.stdout_path = node["stdout"].as<std::string>();
+            }
+            if (node["stderr"]) {
+                log_file.stderr_path = node["stderr"].as<std::string>();
+            }
+            if (!log_file.enabled() ||
+                (!log_file.combined.empty() && (!log_file.stdout_path.empty() || !log_file.stderr_path.empty()))) {
+                throw ConfigParseException("'log_file' needs either a 'path' or 'stdout' and/or 'stderr'!");
+            }
+            if (node["rotate_size"]) {
+                log_file.rotate_bytes = parse_size(node["rotate_size"]);
+            }
+            if (node["rotate_interval"]) {
+                auto interval = node["rotate_interval"].as<std::string>();
+                if (interval == "hourly") {
+                    log_file.rotate_interval = 3600;
+                } else if (interval == "daily") {
+                    log_file.rotate_interval = 86400;
+                } else {
+                    log_file.rotate_interval = node["rotate_interval"].as<unsigned int>();
+                }
+            }
+            if (node["retain"]) {
+                log_file.retain = node["retain"].as<unsigned int>();
+            }
+            if (node["min_level"]) {
+                log_file.min_level = parse_level(node["min_level"]);
+            }
+        }
+
+        /*
+         * Either a list of rules or a map with 'rules', 'default' (keep or drop), 'sample_every' and
+         * 'max_lines_per_second'. A rule is a map with one of keep/drop, keep_prefix/drop_prefix or
+         * keep_regex/drop_regex.
+         */
+        void parse_filter(const YAML::Node& node, ProgramOptions& options) noexcept(false) {
+            static const std::map<std::string, std::pair<OutputFilter::Action, OutputFilter::Match>> kinds = {
+              {"keep", {OutputFilter::KEEP, OutputFilter::SUBSTRING}},
+              {"drop", {OutputFilter::DROP, OutputFilter::SUBSTRING}},
+              {"keep_prefix", {OutputFilter::KEEP, OutputFilter::PREFIX}},
+              {"drop_prefix", {OutputFilter::DROP, OutputFilter::PREFIX}},
+              {"keep_regex", {OutputFilter::KEEP, OutputFilter::REGEX}},
+              {"drop_regex", {OutputFilter::DROP, OutputFilter::REGEX}}};
+            auto rules = node.IsSequence() ? node : node["rules"];
+            if (rules) {
+                options.filter = std::make_shared<OutputFilter>();
+                for (const auto& rule : rules) {
+                    if (!rule.IsMap() || rule.size() != 1) {
+                        throw ConfigParseException("Each filter rule has to be a map with a single key!");
+                    }
+                    auto kind = kinds.find(rule.begin()->first.as<std::string>());
+                    if (kind == kinds.end()) {
+                        throw ConfigParseException(
+                          "Unknown filter rule, expected e.g. drop, drop_prefix or drop_regex!");
+                    }
+                    options.filter->add_rule(kind->second.first, kind->second.second,
+                                             rule.begin()->second.as<std::string>());
+                }
+            }
+            if (node.IsSequence()) {
+                return;
+            }
+            if (node["default"]) {
+                auto action = node["default"].as<std::string>();
+                if (action != "keep" && action != "drop") {
+                    throw ConfigParseException("The default filter action has to be keep or drop!");
+                }
+                if (!options.filter) {
+                    options.filter = std::make_shared<OutputFilter>();
+                }
+                options.filter->set_default(action == "keep" ? OutputFilter::KEEP : OutputFilter::DROP);
+            }
+            if (node["sample_every"]) {
+                options.sample_every = node["sample_every"].as<unsigned int>();
+            }
+            if (node["max_lines_per_second"]) {
+                options.max_lines_per_second = node["max_lines_per_second"].as<unsigned int>();
+            }
+        }
+
+        // Either 'true' (lines starting with whitespace are continuations) or a map with 'pattern', 'timeout_ms' and
+        // 'max_bytes'
+        void parse_multiline(const YAML::Node& node, ProgramOptions& options) noexcept(false) {
+            auto& multiline = options.multiline;
+            multiline.timeout_ms = DEFAULT_MULTILINE_TIMEOUT_MS;
+            multiline.max_bytes = DEFAULT_MULTILINE_MAX_BYTES;
+            if (node.IsScalar()) {
+                multiline.enabled = node.as<bool>();
+                return;
+            }
+            multiline.enabled = true;
+            if (node["pattern"]) {
+                auto pattern = node["pattern"].as<std::string>();
+                try {
+                    multiline.pattern =
+                      std::make_shared<const std::regex>(pattern, std::regex::ECMAScript | std::regex::optimize);
+                } catch (std::regex_error& e) {
+                    auto message = "Invalid multiline pattern '" + pattern + "': " + e.what();
+                    throw ConfigParseException(message.c_str());
+                }
+            }
+            if (node["timeout_ms"]) {
+                multiline.timeout_ms = node["timeout_ms"].as<unsigned int>();
+            }
+            if (node["max_bytes"]) {
+                multiline.max_bytes = parse_size(node["max_bytes"]);
+            }
+            if (multiline.timeout_ms == 0 || multiline.max_bytes == 0) {
+                throw ConfigParseException("'multiline' needs a timeout_ms and max_bytes above 0!");
+            }
+        }
+
+        // Either 'true' or a map with 'socket', 'facility' and the severities for 'stdout' and 'stderr'
+        void parse_syslog(const YAML::Node& node, ProgramOptions& options) noexcept(false) {
+            auto& syslog = options.syslog;
+            if (node.IsScalar()) {
+                if (node.as<bool>()) {
+                    syslog.socket = "/dev/log";
+                }
+                return;
+            }
+            syslog.socket = node["socket"] ? node["socket"].as<std::string>() : "/dev/log";
+            if (node["facility"]) {
+                static const std::vector<std::string> facilities = {
+                  "kern", "user", "mail", "daemon", "auth", "syslog", "lpr", "news", "uucp", "cron", "authpriv", "ftp"};
+                auto facility = node["facility"].as<std::string>();
+                auto known = std::find(facilities.begin(), facilities.end(), facility);
+                if (known != facilities.end()) {
+                    syslog.facility = static_cast<unsigned int>(known - facilities.begin());
+                } else if (facility.size() == 6 && facility.compare(0, 5, "local") == 0 && facility[5] >= '0' &&
+                           facility[5] <= '7') {
+                    syslog.facility = 16 + static_cast<unsigned int>(facility[5] - '0');
+                } else {
+                    throw ConfigParseException("Unknown syslog facility!");
+                }
+            }
+            if (node["stdout"]) {
+                syslog.stdout_severity = parse_severity(node["stdout"]);
+            }
+            if (node["stderr"]) {
+                syslog.stderr_severity = parse_severity(node["stderr"]);
+            }
+            if (node["min_level"]) {
+                syslog.min_level = parse_level(node["min_level"]);
+            }
+        }
+
+        unsigned int parse_severity(const YAML::Node& node) noexcept(false) {
+            static const std::vector<std::string> severities = {"emerg",   "alert",  "crit", "err",
+                                                                "warning", "notice", "info", "debug"};
+            auto known = std::find(severities.begin(), severities.end(), node.as<std::string>());
+            if (known == severities.end()) {
+                throw ConfigParseException("Unknown syslog severity, expected one of emerg, alert, crit, err, "
+                                           "warning, notice, info or debug!");
+            }
+            return static_cast<unsigned int>(known - severities.begin());
+        }
+
+        levels::Level parse_level(const YAML::Node& node) noexcept(false) {
+            auto name = node.as<std::string>();
+            levels::Level level = spdlog::level::trace;
+            if (!levels::parse(name.data(), name.size(), level)) {
+                throw ConfigParseException("Unknown level, expected one of trace, debug, info, warning, error or "
+                                           "critical!");
+            }
+            return level;
+        }
+
+        std::shared_ptr<Scheduling> parse_scheduling(const YAML::Node& program) noexcept(false) {
+            auto scheduling = std::make_shared<Scheduling>();
+            auto affinity = program["cpu_affinity"];
+            if (!affinity) {
+                shared_cpus.push_back(scheduling);
+            } else if (affinity.IsSequence()) {
+                scheduling->set_cpus(affinity.as<std::vector<unsigned int>>());
+            } else if (affinity.as<std::string>() == "exclusive") {
+                // One CPU per instance, assigned once all programs are known
+                unsigned int cpus = 1;
+                if (program["max_instances"]) {
+                    cpus = parse_instances(program["max_instances"]);
+                } else if (program["instances"]) {
+                    cpus = parse_instances(program["instances"]);
+                }
+                exclusive_cpus.emplace_back(program["name"].as<std::string>(), cpus, scheduling);
+            } else {
+                scheduling->set_cpus(affinity.as<std::string>());
+            }
+            if (program["nice"]) {
+                scheduling->set_nice(program["nice"].as<int>());
+            }
+            if (program["sched_policy"]) {
+                scheduling->set_policy(program["sched_policy"].as<std::string>(),
+                                       program["sched_priority"] ? program["sched_priority"].as<int>() : 0);
+            }
+            if (program["ioprio"]) {
+                scheduling->set_ioprio(program["ioprio"].as<std::string>());
+            }
+            if (program["rlimits"]) {
+                // 'soft:hard' or a single value for both
+                for (auto limit : program["rlimits"]) {
+                    auto value = limit.second.as<std::string>();
+                    auto colon = value.find(':');
+                    scheduling->add_rlimit(limit.first.as<std::string>(), value.substr(0, colon),
+                                           colon == std::string::npos ? value : value.substr(colon + 1));
+                }
+            }
+            if (program["oom_score_adj"]) {
+                scheduling->set_oom_score_adj(program["oom_score_adj"].as<int>());
+            }
+            return scheduling;
+        }
+
+        /*
+         * 'numa: spread' places the instances of a group round robin on the NUMA nodes that have memory and CPUs
+         * we may use. Returns the nodes, or a single pseudo node 0 if the topology can't be read.
+         */
+        std::vector<resources::NumaNode> parse_numa(const YAML::Node& program,
+                                                    ProgramOptions& options) noexcept(false) {
+            auto name = program["name"].as<std::string>();
+            if (program["numa"].as<std::string>() != "spread") {
+                throw ConfigParseException(("Unknown NUMA placement of " + name + ", expected 'spread'!").c_str());
+            }
+            if (!program["instances"] && !program["max_instances"]) {
+                throw ConfigParseException(
+                  ("NUMA placement of " + name + " needs 'instances' or 'max_instances'!").c_str());
+            }
+            if (program["cpu_affinity"] && program["cpu_affinity"].IsScalar() &&
+                program["cpu_affinity"].as<std::string>() == "exclusive") {
+                throw ConfigParseException(
+                  ("'numa: spread' and 'cpu_affinity: exclusive' of " + name + " can't be combined!").c_str());
+            }
+            auto nodes = resources::numa_nodes();
+            if (nodes.empty()) {
+                LOG->warn("Couldn't read the NUMA topology, placing all instances of {0} on node 0", name);
+                nodes.push_back(resources::NumaNode{0, resources::allowed_cpus()});
+            } else if (nodes.size() > 1 && options.zygote) {
+                // The zygote applies one set of scheduling settings to all instances
+                LOG->warn("Instances of {0} are bound to different NUMA nodes, not using a zygote", name);
+                options.zygote.reset();
+            }
+            return nodes;
+        }
+
+        /*
+         * Bind the instance's CPUs and memory to its node. With a single node there is nothing to bind, the
+         * instance keeps the settings of its group.
+         */
+        void place_on_node(const std::vector<resources::NumaNode>& nodes, unsigned int instance,
+                           const std::shared_ptr<Scheduling>& group, ProgramOptions& options) noexcept(false) {
+            const auto& node = nodes[instance % nodes.size()];
+            options.numa_node = static_cast<int>(node.id);
+            options.scheduling = group;
+            if (nodes.size() == 1) {
+                return;
+            }
+            auto cpus = node.cpus;
+            options.scheduling = std::make_shared<Scheduling>(*group);
+            if (group->has_cpus()) {
+                // An explicit cpu_affinity narrows down the CPUs of the node
+                auto allowed = group->get_cpus();
+                cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                          [&allowed](unsigned int cpu) {
+                                              return std::find(allowed.begin(), allowed.end(), cpu) == allowed.end();
+                                          }),
+                           cpus.end());
+                if (cpus.empty()) {
+                    auto message = "cpu_affinity of " + options.group + " has no CPUs on NUMA node " +
+                                   std::to_string(node.id) + "!";
+                    throw ConfigParseException(message.c_str());
+                }
+            } else {
+                // Like the shared CPUs, these must not include CPUs taken by 'cpu_affinity: exclusive'
+                numa_cpus.push_back(options.scheduling);
+            }
+            options.scheduling->set_cpus(cpus);
+            options.scheduling->set_memory_node(node.id);
+        }
+
+        /*
+         * Programs with 'cpu_affinity: exclusive' get CPUs of their own, all programs without an explicit affinity
+         * share the remaining ones. CPU 0 usually does most of the housekeeping, so the exclusive CPUs are taken
+         * from the top.
+         */
+        void partition_cpus() noexcept(false) {
+            if (exclusive_cpus.empty()) {
+                return;
+            }
+            auto available = resources::allowed_cpus();
+            unsigned int needed = 0;
+            for (const auto& entry : exclusive_cpus) {
+                needed += std::get<1>(entry);
+            }
+            if (needed >= available.size()) {
+                throw ConfigParseException("Not enough CPUs for exclusive cpu_affinity, at least one has to be left!");
+            }
+            auto end = available.end();
+            for (const auto& entry : exclusive_cpus) {
+                std::vector<unsigned int> cpus(end - std::get<1>(entry), end);
+                end -= std::get<1>(entry);
+                std::get<2>(entry)->set_cpus(cpus);
+                std::string list;
+                for (auto cpu : cpus) {
+                    list += (list.empty() ? "" : ",") + std::to_string(cpu);
+                }
+                LOG->info("{0} runs on CPU(s) {1} exclusively", std::get<0>(entry), list);
+            }
+            std::vector<unsigned int> rest(available.begin(), end);
+            for (const auto& scheduling : shared_cpus) {
+                scheduling->set_cpus(rest);
+            }
+            for (const auto& scheduling : numa_cpus) {
+                auto cpus = scheduling->get_cpus();
+                cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                          [&rest](unsigned int cpu) {
+                                              return std::find(rest.begin(), rest.end(), cpu) == rest.end();
+                                          }),
+                           cpus.end());
+                // All CPUs of the node are taken, the memory stays on the node anyway
+                scheduling->set_cpus(cpus.empty() ? rest : cpus);
+            }
+        }
+
+        void parse_autoscaling(const YAML::Node& program, ProgramOptions& options) noexcept(false) {
+            options.max_instances = parse_instances(program["max_instances"]);
+            options.min_instances = program["min_instances"] ? program["min_instances"].as<unsigned int>() : 1;
+            if (options.min_instances == 0 || options.min_instances > options.max_instances) {
+                throw ConfigParseException("'min_instances' must be between 1 and 'max_instances'!");
+            }
+            auto autoscale = program["autoscale"];
+            if (!autoscale) {
+                return;
+            }
+            if (autoscale["signal"]) {
+                auto signal = autoscale["signal"].as<std::string>();
+                if (signal == "metric") {
+                    options.scale_signal = ProgramOptions::METRIC;
+                } else if (signal != "cpu") {
+                    throw ConfigParseException("Unknown autoscaling signal, expected 'cpu' or 'metric'!");
+                }
+            }
+            if (autoscale["up_threshold"]) {
+                options.scale_up_threshold = autoscale["up_threshold"].as<double>();
+            }
+            if (autoscale["down_threshold"]) {
+                options.scale_down_threshold = autoscale["down_threshold"].as<double>();
+            }
+            if (options.scale_down_threshold > options.scale_up_threshold) {
+                throw ConfigParseException("'down_threshold' must not be above 'up_threshold'!");
+            }
+            if (autoscale["cooldown"]) {
+                options.scale_cooldown = autoscale["cooldown"].as<unsigned int>();
+            }
+            if (autoscale["metric_file"]) {
+                options.scale_metric_file = autoscale["metric_file"].as<std::string>();
             }
         }
 
         std::list<std::shared_ptr<CTYPE>> processes;
+        // Program name, number of CPUs and settings for 'cpu_affinity: exclusive', settings without an affinity
+        std::list<std::tuple<std::string, unsigned int, std::shared_ptr<Scheduling>>> exclusive_cpus;
+        std::list<std::shared_ptr<Scheduling>> shared_cpus;
+        // Per-instance settings of 'numa: spread' groups without an explicit affinity
+        std::list<std::shared_ptr<Scheduling>> numa_cpus;
         int child_counter = 0;
         std::shared_ptr<ProcessHandlerInterface> handler;
     };
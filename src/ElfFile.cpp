@@ -0,0 +1,343 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ElfFile.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <set>
+#include <vector>
+
+// Upper bounds for the sizes read from a file, protects against garbage in corrupt files
+#define MAX_PROGRAM_HEADERS 4096
+#define MAX_DYNAMIC_ENTRIES 65536
+#define MAX_STRTAB_SIZE (16 * 1024 * 1024)
+
+namespace scinit {
+    namespace elf {
+        namespace {
+            bool read_exactly(int fd, void* buf, size_t size, uint64_t offset) noexcept {
+                auto pos = static_cast<char*>(buf);
+                while (size > 0) {
+                    auto nread = pread(fd, pos, size, static_cast<off_t>(offset));
+                    if (nread <= 0) {
+                        return false;
+                    }
+                    pos += nread;
+                    size -= static_cast<size_t>(nread);
+                    offset += static_cast<uint64_t>(nread);
+                }
+                return true;
+            }
+
+            std::string directory_of(const std::string& path) noexcept {
+                char resolved[PATH_MAX];
+                std::string real = realpath(path.c_str(), static_cast<char*>(resolved)) != nullptr
+                                     ? std::string(static_cast<char*>(resolved))
+                                     : path;
+                auto slash = real.rfind('/');
+                return slash == std::string::npos ? "." : real.substr(0, slash == 0 ? 1 : slash);
+            }
+
+            std::list<std::string> split_path(const std::string& list, const std::string& origin) noexcept {
+                std::list<std::string> result;
+                size_t begin = 0;
+                while (begin <= list.size()) {
+                    auto end = list.find(':', begin);
+                    if (end == std::string::npos) {
+                        end = list.size();
+                    }
+                    auto dir = list.substr(begin, end - begin);
+                    for (const char* token : {"${ORIGIN}", "$ORIGIN"}) {
+                        size_t pos;
+                        while ((pos = dir.find(token)) != std::string::npos) {
+                            dir.replace(pos, std::strlen(token), origin);
+                        }
+                    }
+                    if (!dir.empty()) {
+                        result.push_back(dir);
+                    }
+                    begin = end + 1;
+                }
+                return result;
+            }
+
+            // Program header table and dynamic section, for either ELF class
+            template <typename Ehdr, typename Phdr, typename Dyn>
+            bool parse(int fd, const std::string& path, Dependencies& deps) noexcept {
+                Ehdr header{};
+                if (!read_exactly(fd, &header, sizeof(header), 0) || header.e_phentsize != sizeof(Phdr) ||
+                    header.e_phnum == 0 || header.e_phnum > MAX_PROGRAM_HEADERS) {
+                    return false;
+                }
+                deps.machine = header.e_machine;
+                std::vector<Phdr> phdrs(header.e_phnum);
+                if (!read_exactly(fd, phdrs.data(), phdrs.size() * sizeof(Phdr), header.e_phoff)) {
+                    return false;
+                }
+
+                const Phdr* dynamic = nullptr;
+                for (const auto& phdr : phdrs) {
+                    if (phdr.p_type == PT_INTERP && phdr.p_filesz > 0 && phdr.p_filesz < PATH_MAX) {
+                        std::vector<char> interpreter(phdr.p_filesz);
+                        if (!read_exactly(fd, interpreter.data(), interpreter.size(), phdr.p_offset)) {
+                            return false;
+                        }
+                        deps.interpreter =
+                          std::string(interpreter.data(), strnlen(interpreter.data(), interpreter.size()));
+                    } else if (phdr.p_type == PT_DYNAMIC) {
+                        dynamic = &phdr;
+                    }
+                }
+                if (dynamic == nullptr) {
+                    // Statically linked
+                    return true;
+                }
+
+                auto count = dynamic->p_filesz / sizeof(Dyn);
+                if (count > MAX_DYNAMIC_ENTRIES) {
+                    return false;
+                }
+                std::vector<Dyn> entries(count);
+                if (!read_exactly(fd, entries.data(), count * sizeof(Dyn), dynamic->p_offset)) {
+                    return false;
+                }
+                uint64_t strtab = 0, strsz = 0;
+                std::list<uint64_t> needed, runpath, rpath;
+                for (const auto& entry : entries) {
+                    if (entry.d_tag == DT_NULL) {
+                        break;
+                    }
+                    switch (entry.d_tag) {
+                        case DT_STRTAB:
+                            strtab = entry.d_un.d_ptr;
+                            break;
+                        case DT_STRSZ:
+                            strsz = entry.d_un.d_val;
+                            break;
+                        case DT_NEEDED:
+                            needed.push_back(entry.d_un.d_val);
+                            break;
+                        case DT_RUNPATH:
+                            runpath.push_back(entry.d_un.d_val);
+                            break;
+                        case DT_RPATH:
+                            rpath.push_back(entry.d_un.d_val);
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                if (needed.empty() && runpath.empty() && rpath.empty()) {
+                    return true;
+                }
+                if (strsz == 0 || strsz > MAX_STRTAB_SIZE) {
+                    return false;
+                }
+
+                // DT_STRTAB is a virtual address, find the loaded segment it is in to get the file offset
+                uint64_t strtab_offset = 0;
+                bool mapped = false;
+                for (const auto& phdr : phdrs) {
+                    if (phdr.p_type == PT_LOAD && strtab >= phdr.p_vaddr && strtab - phdr.p_vaddr < phdr.p_filesz) {
+                        strtab_offset = phdr.p_offset + (strtab - phdr.p_vaddr);
+                        mapped = true;
+                        break;
+                    }
+                }
+                std::vector<char> strings(strsz);
+                if (!mapped || !read_exactly(fd, strings.data(), strings.size(), strtab_offset)) {
+                    return false;
+                }
+                auto string_at = [&strings](uint64_t offset) -> std::string {
+                    if (offset >= strings.size()) {
+                        return "";
+                    }
+                    return std::string(strings.data() + offset,
+                                       strnlen(strings.data() + offset, strings.size() - offset));
+                };
+
+                for (auto offset : needed) {
+                    auto soname = string_at(offset);
+                    if (!soname.empty()) {
+                        deps.needed.push_back(soname);
+                    }
+                }
+                auto origin = directory_of(path);
+                for (auto offset : runpath.empty() ? rpath : runpath) {
+                    deps.runpath.splice(deps.runpath.end(), split_path(string_at(offset), origin));
+                }
+                return true;
+            }
+
+            // Directories listed in /etc/ld.so.conf, following 'include' lines
+            void read_ld_so_conf(const std::string& file, std::list<std::string>& dirs, unsigned int depth) noexcept {
+                std::ifstream conf(file);
+                std::string line;
+                while (depth < 8 && std::getline(conf, line)) {
+                    line = line.substr(0, line.find('#'));
+                    auto begin = line.find_first_not_of(" \t");
+                    if (begin == std::string::npos) {
+                        continue;
+                    }
+                    auto end = line.find_last_not_of(" \t\r");
+                    line = line.substr(begin, end - begin + 1);
+                    if (line.compare(0, 8, "include ") == 0 || line.compare(0, 8, "include\t") == 0) {
+                        auto pattern = line.substr(line.find_first_not_of(" \t", 8));
+                        if (pattern[0] != '/') {
+                            pattern = "/etc/" + pattern;
+                        }
+                        glob_t matches{};
+                        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+                            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                                read_ld_so_conf(matches.gl_pathv[i], dirs, depth + 1);  // NOLINT
+                            }
+                        }
+                        globfree(&matches);
+                    } else if (line[0] == '/') {
+                        dirs.push_back(line);
+                    }
+                }
+            }
+
+            // Find a library matching the class and machine of the executable
+            std::string find_library(const std::string& soname, const std::list<std::string>& runpath,
+                                     const std::list<std::string>& system_dirs,
+                                     const Dependencies& executable) noexcept {
+                if (soname.find('/') != std::string::npos) {
+                    return access(soname.c_str(), R_OK) == 0 ? soname : "";
+                }
+                for (const auto* dirs : {&runpath, &system_dirs}) {
+                    for (const auto& dir : *dirs) {
+                        auto candidate = dir + "/" + soname;
+                        Dependencies deps;
+                        if (access(candidate.c_str(), R_OK) == 0 && read_dependencies(candidate, deps) &&
+                            deps.elf_class == executable.elf_class && deps.machine == executable.machine) {
+                            return candidate;
+                        }
+                    }
+                }
+                return "";
+            }
+        }  // namespace
+
+        bool read_dependencies(const std::string& path, Dependencies& deps) noexcept {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                return false;
+            }
+            unsigned char ident[EI_NIDENT];
+            bool ok = read_exactly(fd, static_cast<unsigned char*>(ident), EI_NIDENT, 0) &&
+                      std::memcmp(static_cast<unsigned char*>(ident), ELFMAG, SELFMAG) == 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            ok = ok && ident[EI_DATA] == ELFDATA2LSB;
+#else
+            ok = ok && ident[EI_DATA] == ELFDATA2MSB;
+#endif
+            if (ok) {
+                deps.elf_class = ident[EI_CLASS];
+                if (deps.elf_class == ELFCLASS64) {
+                    ok = parse<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(fd, path, deps);
+                } else if (deps.elf_class == ELFCLASS32) {
+                    ok = parse<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(fd, path, deps);
+                } else {
+                    ok = false;
+                }
+            }
+            close(fd);
+            return ok;
+        }
+
+        std::string find_executable(const std::string& name) noexcept {
+            if (name.empty() || name.find('/') != std::string::npos) {
+                return name;
+            }
+            const char* path = std::getenv("PATH");
+            for (const auto& dir : split_path(path != nullptr ? path : "/bin:/usr/bin", ".")) {
+                auto candidate = dir + "/" + name;
+                struct stat info {};
+                if (stat(candidate.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+                    access(candidate.c_str(), X_OK) == 0) {
+                    return candidate;
+                }
+            }
+            return "";
+        }
+
+        std::list<std::string> files_to_load(const std::string& executable) noexcept {
+            std::list<std::string> files;
+            Dependencies root;
+            if (!read_dependencies(executable, root)) {
+                // Scripts and the like, the file itself is all we know about
+                if (access(executable.c_str(), R_OK) == 0) {
+                    files.push_back(executable);
+                }
+                return files;
+            }
+            files.push_back(executable);
+            if (!root.interpreter.empty() && access(root.interpreter.c_str(), R_OK) == 0) {
+                files.push_back(root.interpreter);
+            }
+
+            std::list<std::string> system_dirs;
+            const char* ld_library_path = std::getenv("LD_LIBRARY_PATH");
+            if (ld_library_path != nullptr) {
+                system_dirs = split_path(ld_library_path, ".");
+            }
+            read_ld_so_conf("/etc/ld.so.conf", system_dirs, 0);
+            for (const auto& dir : {"/lib64", "/usr/lib64", "/lib", "/usr/lib"}) {
+                system_dirs.emplace_back(dir);
+            }
+
+            // Breadth first, like the loader. The interpreter is already loaded when libraries ask for it by soname.
+            std::set<std::string> seen;
+            if (!root.interpreter.empty()) {
+                seen.insert(root.interpreter.substr(root.interpreter.rfind('/') + 1));
+            }
+            std::deque<std::pair<std::string, std::list<std::string>>> queue;
+            for (const auto& soname : root.needed) {
+                queue.emplace_back(soname, root.runpath);
+            }
+            while (!queue.empty()) {
+                auto soname = queue.front().first;
+                auto runpath = queue.front().second;
+                queue.pop_front();
+                if (!seen.insert(soname).second) {
+                    continue;
+                }
+                auto library = find_library(soname, runpath, system_dirs, root);
+                Dependencies deps;
+                if (library.empty() || !read_dependencies(library, deps)) {
+                    continue;
+                }
+                files.push_back(library);
+                // DT_RPATH of the executable applies to all libraries, DT_RUNPATH only to direct dependencies
+                deps.runpath.insert(deps.runpath.end(), root.runpath.begin(), root.runpath.end());
+                for (const auto& next : deps.needed) {
+                    queue.emplace_back(next, deps.runpath);
+                }
+            }
+            return files;
+        }
+    }  // namespace elf
+}  // namespace scinit
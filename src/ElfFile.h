@@ -0,0 +1,56 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_ELFFILE_H
+#define CINIT_ELFFILE_H
+
+#include <list>
+#include <string>
+
+namespace scinit {
+    namespace elf {
+        // What the dynamic loader needs to run an ELF file
+        struct Dependencies {
+            // ELFCLASS32 or ELFCLASS64 and e_machine, libraries of another class or machine are skipped
+            unsigned char elf_class = 0;
+            unsigned int machine = 0;
+            // Path of the dynamic loader (PT_INTERP), empty for static executables and libraries
+            std::string interpreter;
+            // Sonames from DT_NEEDED, in link order
+            std::list<std::string> needed;
+            // Directories from DT_RUNPATH (or DT_RPATH if there is no DT_RUNPATH), $ORIGIN is expanded
+            std::list<std::string> runpath;
+        };
+
+        /*
+         * Read the program headers and the dynamic section of 'path'. Only files in the host's byte order are
+         * understood. Returns false if the file can't be read or isn't a (sane) ELF file.
+         */
+        bool read_dependencies(const std::string& path, Dependencies& deps) noexcept;
+
+        // Look up 'name' in PATH the same way execvp does, returns an empty string if it can't be found
+        std::string find_executable(const std::string& name) noexcept;
+
+        /*
+         * The executable, its interpreter and all shared libraries it loads (transitively), in the order the
+         * loader opens them. Libraries are searched in the runpath, LD_LIBRARY_PATH, the directories in
+         * /etc/ld.so.conf and the default directories. Unresolvable libraries are left out.
+         */
+        std::list<std::string> files_to_load(const std::string& executable) noexcept;
+    }  // namespace elf
+}  // namespace scinit
+
+#endif  // CINIT_ELFFILE_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JsonLogWriter.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace scinit {
+    namespace {
+        /*
+         * What follows the backslash when escaping a byte, 0 if the byte is copied as it is. Control characters
+         * without a short escape are written as \u00XX. Bytes >= 0x80 are copied, messages are expected in UTF-8.
+         */
+        const char ESCAPES[256] = {
+          'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',  // 0x00
+          'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',  // 0x10
+          0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,    // 0x20
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,    // 0x30
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,    // 0x40
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\', 0,  0,   0,    // 0x50
+        };
+        const char HEX_DIGITS[] = "0123456789abcdef";
+    }  // namespace
+
+    JsonLogWriter::JsonLogWriter(int fd) noexcept : fd(fd) {}
+
+    JsonLogWriter::~JsonLogWriter() { flush(); }
+
+    void JsonLogWriter::stamp(Record& record) noexcept {
+        clock_gettime(CLOCK_REALTIME, &record.wall);
+        clock_gettime(CLOCK_MONOTONIC, &record.mono);
+    }
+
+    void JsonLogWriter::write(const Record& record) noexcept {
+        append_literal("{\"time\":\"");
+        append_wall_time(record.wall);
+        append_literal("\",\"mono\":");
+        append_number(static_cast<unsigned long>(record.mono.tv_sec));
+        append_literal(".");
+        append_number(static_cast<unsigned long>(record.mono.tv_nsec), 9);
+        append_literal(",\"program\":\"");
+        append_escaped(record.program, std::strlen(record.program));
+        append_literal("\"");
+        if (record.instance >= 0) {
+            append_literal(",\"instance\":");
+            append_number(static_cast<unsigned long>(record.instance));
+        }
+        if (record.stream == STDOUT) {
+            append_literal(",\"stream\":\"stdout\"");
+        } else {
+            append_literal(",\"stream\":\"stderr\"");
+        }
+        if (record.level != nullptr) {
+            append_literal(",\"level\":\"");
+            append(record.level, std::strlen(record.level));
+            append_literal("\"");
+        }
+        if (record.pid > 0) {
+            append_literal(",\"pid\":");
+            append_number(static_cast<unsigned long>(record.pid));
+        }
+        append_literal(",\"message\":\"");
+        append_escaped(record.message, record.length);
+        append_literal("\"}\n");
+    }
+
+    void JsonLogWriter::flush() noexcept {
+        size_t written = 0;
+        while (written < used) {
+            auto rc = ::write(fd, static_cast<char*>(buffer) + written, used - written);
+            if (rc == -1 && errno == EINTR) {
+                continue;
+            }
+            if (rc <= 0) {
+                // Nobody reads our output anymore, there is nothing sensible left to do with it
+                break;
+            }
+            written += static_cast<size_t>(rc);
+        }
+        used = 0;
+    }
+
+    size_t JsonLogWriter::escape(const char* message, size_t length, char* out) noexcept {
+        size_t in = 0, pos = 0;
+        while (in < length) {
+            // Copy everything up to the next byte that needs escaping at once
+            size_t run = in;
+            while (run < length && ESCAPES[static_cast<unsigned char>(message[run])] == 0) {
+                run++;
+            }
+            std::memcpy(out + pos, message + in, run - in);
+            pos += run - in;
+            in = run;
+            if (in == length) {
+                break;
+            }
+            auto byte = static_cast<unsigned char>(message[in++]);
+            out[pos++] = '\\';
+            out[pos++] = ESCAPES[byte];
+            if (ESCAPES[byte] == 'u') {
+                out[pos++] = '0';
+                out[pos++] = '0';
+                out[pos++] = HEX_DIGITS[byte >> 4];
+                out[pos++] = HEX_DIGITS[byte & 0xf];
+            }
+        }
+        return pos;
+    }
+
+    void JsonLogWriter::append(const char* data, size_t length) noexcept {
+        while (length > 0) {
+            if (used == JSON_LOG_BUFFER_SIZE) {
+                flush();
+            }
+            auto chunk = std::min(length, JSON_LOG_BUFFER_SIZE - used);
+            std::memcpy(static_cast<char*>(buffer) + used, data, chunk);
+            used += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+    }
+
+    void JsonLogWriter::append_number(unsigned long value, unsigned int min_digits) noexcept {
+        char digits[24];
+        size_t pos = sizeof(digits);
+        do {
+            digits[--pos] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0 || sizeof(digits) - pos < min_digits);
+        append(static_cast<char*>(digits) + pos, sizeof(digits) - pos);
+    }
+
+    void JsonLogWriter::append_escaped(const char* message, size_t length) noexcept {
+        // Escaping makes a byte at most 6 bytes long, escape as much as surely fits and flush in between
+        while (length > 0) {
+            auto fits = (JSON_LOG_BUFFER_SIZE - used) / 6;
+            if (fits < std::min(length, static_cast<size_t>(256))) {
+                flush();
+                continue;
+            }
+            auto chunk = std::min(length, fits);
+            used += escape(message, chunk, static_cast<char*>(buffer) + used);
+            message += chunk;
+            length -= chunk;
+        }
+    }
+
+    void JsonLogWriter::append_wall_time(const struct timespec& wall) noexcept {
+        if (wall.tv_sec != cached_second) {
+            struct tm utc {};
+            gmtime_r(&wall.tv_sec, &utc);
+            cached_date_length =
+              strftime(static_cast<char*>(cached_date), sizeof(cached_date), "%Y-%m-%dT%H:%M:%S.", &utc);
+            cached_second = wall.tv_sec;
+        }
+        append(static_cast<char*>(cached_date), cached_date_length);
+        append_number(static_cast<unsigned long>(wall.tv_nsec / 1000000), 3);
+        append_literal("Z");
+    }
+}  // namespace scinit
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_JSONLOGWRITER_H
+#define CINIT_JSONLOGWRITER_H
+
+#include <sys/types.h>
+#include <cstddef>
+#include <ctime>
+
+// Size of the line buffer, longer lines are written in several parts
+#define JSON_LOG_BUFFER_SIZE 65536
+
+namespace scinit {
+    /*
+     * Writes program output as one JSON object per line (--log-format=json), e.g.
+     *   {"time":"2018-06-01T12:00:00.042Z","mono":1234.567890123,"program":"worker@1","instance":1,
+     *    "stream":"stdout","level":"error","pid":42,"message":"..."}
+     * Lines are formatted into a fixed buffer without allocating and written with a single write() per flush().
+     * The date part of the timestamp only changes once per second and is formatted once per second.
+     */
+    class JsonLogWriter {
+      public:
+        enum Stream { STDOUT, STDERR };
+
+        struct Record {
+            // Name of the process, e.g. 'worker@1'
+            const char* program = "";
+            // Index in the instance group, -1 for single instance programs
+            int instance = -1;
+            Stream stream = STDOUT;
+            // Level found in the line ('detect_level'), null if it isn't detected
+            const char* level = nullptr;
+            // 0 if the process has already exited
+            pid_t pid = 0;
+            const char* message = "";
+            size_t length = 0;
+            // Wall clock and CLOCK_MONOTONIC time of the line
+            struct timespec wall {};
+            struct timespec mono {};
+        };
+
+        explicit JsonLogWriter(int fd) noexcept;
+        JsonLogWriter(const JsonLogWriter&) = delete;
+        JsonLogWriter& operator=(const JsonLogWriter&) = delete;
+        ~JsonLogWriter();
+
+        // Set the timestamps of 'record' to the current time
+        static void stamp(Record& record) noexcept;
+
+        // Format one line, it is written on the next flush() or once the buffer is full
+        void write(const Record& record) noexcept;
+        void flush() noexcept;
+
+        /*
+         * Append 'message' as the contents of a JSON string (without quotes) to 'out', which must have room for
+         * 6 * length bytes. Returns the number of bytes written.
+         */
+        static size_t escape(const char* message, size_t length, char* out) noexcept;
+
+      private:
+        void append(const char* data, size_t length) noexcept;
+        template <size_t N>
+        void append_literal(const char (&literal)[N]) noexcept {
+            append(static_cast<const char*>(literal), N - 1);
+        }
+        void append_number(unsigned long value, unsigned int min_digits = 1) noexcept;
+        void append_escaped(const char* message, size_t length) noexcept;
+        void append_wall_time(const struct timespec& wall) noexcept;
+
+        int fd;
+        char buffer[JSON_LOG_BUFFER_SIZE];
+        size_t used = 0;
+        // 'YYYY-MM-DDTHH:MM:SS.' of the second in 'cached_second'
+        time_t cached_second = -1;
+        char cached_date[32];
+        size_t cached_date_length = 0;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_JSONLOGWRITER_H
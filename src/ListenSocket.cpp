@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ListenSocket.h"
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "ChildProcessException.h"
+#include "ConfigParseException.h"
+#include "log.h"
+
+namespace scinit {
+    namespace {
+        // Close 'fd' and throw, preserving the errno of the failed call in the message
+        void fail_with_errno(int& fd, const std::string& what) noexcept(false) {
+            auto reason = what + ": " + std::strerror(errno);
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
+            }
+            throw ChildProcessException(reason.c_str());
+        }
+    }  // namespace
+
+    ListenSocket::ListenSocket(std::string name, SocketType type, std::string address, unsigned int port,
+                               int backlog, bool reuseport) noexcept
+      : name(std::move(name)), address(std::move(address)), type(type), port(port), backlog(backlog),
+        reuseport(reuseport) {}
+
+    ListenSocket::~ListenSocket() {
+        if (fd != -1) {
+            close(fd);
+            if (type == UNIX) {
+                unlink(address.c_str());
+            }
+        }
+    }
+
+    ListenSocket::SocketType ListenSocket::type_from_string(std::string type) noexcept(false) {
+        std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+        if (type == "tcp") {
+            return TCP;
+        }
+        if (type == "udp") {
+            return UDP;
+        }
+        if (type == "unix") {
+            return UNIX;
+        }
+        throw ConfigParseException("Unknown socket type, expected one of tcp, udp or unix!");
+    }
+
+    std::string ListenSocket::describe() const {
+        switch (type) {
+            case TCP:
+                return "tcp:" + address + ":" + std::to_string(port);
+            case UDP:
+                return "udp:" + address + ":" + std::to_string(port);
+            case UNIX:
+                return "unix:" + address;
+        }
+        return address;
+    }
+
+    void ListenSocket::bind() noexcept(false) {
+        if (fd != -1) {
+            return;
+        }
+        int one = 1;
+        if (type == UNIX) {
+            struct sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            if (address.size() >= sizeof(addr.sun_path)) {
+                throw ChildProcessException("Unix socket path is too long!");
+            }
+            std::strncpy(static_cast<char*>(addr.sun_path), address.c_str(), sizeof(addr.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd == -1) {
+                fail_with_errno(fd, "Couldn't create unix socket");
+            }
+            // Remove stale sockets from a previous run
+            unlink(address.c_str());
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+                fail_with_errno(fd, "Couldn't bind unix socket");
+            }
+        } else {
+            struct addrinfo hints {};
+            struct addrinfo* result = nullptr;
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = type == TCP ? SOCK_STREAM : SOCK_DGRAM;
+            hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+            auto port_str = std::to_string(port);
+            if (getaddrinfo(address.empty() ? nullptr : address.c_str(), port_str.c_str(), &hints, &result) != 0 ||
+                result == nullptr) {
+                throw ChildProcessException("Couldn't parse socket address!");
+            }
+            fd = socket(result->ai_family, result->ai_socktype | SOCK_CLOEXEC, result->ai_protocol);
+            if (fd == -1) {
+                freeaddrinfo(result);
+                fail_with_errno(fd, "Couldn't create socket");
+            }
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1) {
+                LOG->warn("Couldn't set SO_REUSEPORT on socket {0}", describe());
+            }
+            int rc = ::bind(fd, result->ai_addr, result->ai_addrlen);
+            int bind_errno = errno;
+            freeaddrinfo(result);
+            if (rc == -1) {
+                errno = bind_errno;
+                fail_with_errno(fd, "Couldn't bind socket");
+            }
+        }
+        if (type != UDP && listen(fd, backlog) == -1) {
+            fail_with_errno(fd, "Couldn't listen on socket");
+        }
+        LOG->info("Listening on {0} (fd {1})", describe(), fd);
+    }
+}  // namespace scinit
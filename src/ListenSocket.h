@@ -0,0 +1,61 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_LISTENSOCKET_H
+#define CINIT_LISTENSOCKET_H
+
+#include <string>
+
+namespace scinit {
+    /*
+     * A socket that is created and bound by scinit and handed to a child process on exec (socket activation).
+     * The socket is owned by this object and outlives the processes using it, so that clients queue up in the
+     * kernel backlog while a program restarts instead of getting their connection refused.
+     */
+    class ListenSocket {
+      public:
+        enum SocketType { TCP, UDP, UNIX };
+
+        // 'address' is an IP address for TCP/UDP and a filesystem path for UNIX sockets
+        ListenSocket(std::string name, SocketType type, std::string address, unsigned int port, int backlog,
+                     bool reuseport) noexcept;
+        ListenSocket(const ListenSocket&) = delete;
+        ListenSocket& operator=(const ListenSocket&) = delete;
+        ~ListenSocket();
+
+        // Create and bind the socket. Does nothing if it is already bound.
+        void bind() noexcept(false);
+
+        int get_fd() const noexcept { return fd; }
+        std::string get_name() const noexcept { return name; }
+        SocketType get_type() const noexcept { return type; }
+        std::string get_address() const noexcept { return address; }
+        unsigned int get_port() const noexcept { return port; }
+        std::string describe() const;
+
+        // Parse 'tcp', 'udp' or 'unix' (case insensitive)
+        static SocketType type_from_string(std::string) noexcept(false);
+
+      private:
+        std::string name, address;
+        SocketType type;
+        unsigned int port;
+        int backlog, fd = -1;
+        bool reuseport;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_LISTENSOCKET_H
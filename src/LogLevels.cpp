@@ -0,0 +1,316 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogLevels.h"
+#include <cstdint>
+#include <cstring>
+
+// Levels in brackets and logfmt fields are only looked for in the beginning of the line
+#define MARKER_WINDOW 64
+// Longest level name ('critical')
+#define MAX_NAME_LENGTH 8
+
+namespace scinit {
+    namespace levels {
+        namespace {
+            bool is_upper(char c) noexcept { return c >= 'A' && c <= 'Z'; }
+            bool is_alpha(char c) noexcept { return is_upper(c) || (c >= 'a' && c <= 'z'); }
+            bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+            // A name of up to eight characters as one integer, laid out like the characters in memory
+            constexpr uint64_t pack(const char* name) noexcept {
+                uint64_t packed = 0;
+                for (unsigned int i = 0; name[i] != '\0'; i++) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                    packed |= static_cast<uint64_t>(static_cast<unsigned char>(name[i])) << (8 * i);
+#else
+                    packed |= static_cast<uint64_t>(static_cast<unsigned char>(name[i])) << (56 - 8 * i);
+#endif
+                }
+                return packed;
+            }
+
+            // Length of the run of letters at 'begin', at most MAX_NAME_LENGTH + 1
+            size_t word_length(const char* begin, const char* end) noexcept {
+                size_t length = 0;
+                while (begin + length < end && length <= MAX_NAME_LENGTH && is_alpha(begin[length])) {
+                    length++;
+                }
+                return length;
+            }
+
+            // pino and bunyan log levels as numbers: 10 trace, 20 debug, 30 info, 40 warn, 50 error, 60 fatal
+            bool parse_number(const char* begin, const char* end, Level& level) noexcept {
+                if (end - begin < 2 || !is_digit(begin[0]) || !is_digit(begin[1]) ||
+                    (end - begin > 2 && is_digit(begin[2]))) {
+                    return false;
+                }
+                switch (begin[0]) {
+                    case '1':
+                        level = spdlog::level::trace;
+                        return true;
+                    case '2':
+                        level = spdlog::level::debug;
+                        return true;
+                    case '3':
+                        level = spdlog::level::info;
+                        return true;
+                    case '4':
+                        level = spdlog::level::warn;
+                        return true;
+                    case '5':
+                        level = spdlog::level::err;
+                        return true;
+                    case '6':
+                        level = spdlog::level::critical;
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            // The value of the "level" or "severity" field of a JSON object. Keys are found by hopping from quote to
+            // quote, loggers put the level near the start.
+            bool detect_json(const char* begin, const char* end, Level& level) noexcept {
+                const auto* quote = begin;
+                while ((quote = static_cast<const char*>(
+                          std::memchr(quote, '"', static_cast<size_t>(end - quote)))) != nullptr) {
+                    const auto* key = quote + 1;
+                    auto rest = static_cast<size_t>(end - key);
+                    const char* value = nullptr;
+                    if (rest > 6 && std::memcmp(key, "level\"", 6) == 0) {
+                        value = key + 6;
+                    } else if (rest > 9 && std::memcmp(key, "severity\"", 9) == 0) {
+                        value = key + 9;
+                    }
+                    if (value == nullptr) {
+                        quote = key;
+                        continue;
+                    }
+                    while (value < end && (*value == ' ' || *value == ':')) {
+                        value++;
+                    }
+                    if (value < end && *value == '"') {
+                        value++;
+                        return parse(value, word_length(value, end), level);
+                    }
+                    return parse_number(value, end, level);
+                }
+                return false;
+            }
+
+            // 'E0101 ' (glog: severity, month and day)
+            bool detect_glog(const char* begin, const char* end, Level& level) noexcept {
+                if (end - begin < 6 || !is_digit(begin[1]) || !is_digit(begin[2]) || !is_digit(begin[3]) ||
+                    !is_digit(begin[4]) || begin[5] != ' ') {
+                    return false;
+                }
+                switch (begin[0]) {
+                    case 'I':
+                        level = spdlog::level::info;
+                        return true;
+                    case 'W':
+                        level = spdlog::level::warn;
+                        return true;
+                    case 'E':
+                        level = spdlog::level::err;
+                        return true;
+                    case 'F':
+                        level = spdlog::level::critical;
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            // 'ERROR:', 'WARN ', 'INFO|', upper case only, 'Error connecting...' is a sentence
+            bool detect_word(const char* begin, const char* end, Level& level) noexcept {
+                auto length = word_length(begin, end);
+                if (length == 0 || length > MAX_NAME_LENGTH ||
+                    (begin + length < end && begin[length] != ':' && begin[length] != ' ' && begin[length] != '|')) {
+                    return false;
+                }
+                for (size_t i = 0; i < length; i++) {
+                    if (!is_upper(begin[i])) {
+                        return false;
+                    }
+                }
+                return parse(begin, length, level);
+            }
+
+            // '[error]', '[ WARN ]', 'word' is right after the bracket
+            bool detect_brackets(const char* word, const char* end, Level& level) noexcept {
+                while (word < end && *word == ' ') {
+                    word++;
+                }
+                auto length = word_length(word, end);
+                const auto* after = word + length;
+                while (after < end && *after == ' ') {
+                    after++;
+                }
+                return after < end && *after == ']' && parse(word, length, level);
+            }
+
+            // 'level=warn' (logfmt), 'value' is right after the '='
+            bool detect_logfmt(const char* value, const char* end, Level& level) noexcept {
+                if (value < end && *value == '"') {
+                    value++;
+                }
+                return parse(value, word_length(value, end), level);
+            }
+
+            // High bit set in the lowest byte of 'word' that equals the byte repeated in 'pattern' (higher bytes may be
+            // false positives)
+            uint64_t first_match(uint64_t word, uint64_t pattern) noexcept {
+                auto bytes = word ^ pattern;
+                return (bytes - 0x0101010101010101ULL) & ~bytes & 0x8080808080808080ULL;
+            }
+
+            // Checks a '[' or '=' found at 'pos'
+            bool detect_at(const char* begin, const char* pos, const char* end, Level& level) noexcept {
+                if (*pos == '[') {
+                    return detect_brackets(pos + 1, end, level);
+                }
+                return pos - begin >= 5 && std::memcmp(pos - 5, "level", 5) == 0 &&
+                       (pos - begin == 5 || pos[-6] == ' ') && detect_logfmt(pos + 1, end, level);
+            }
+
+            /*
+             * Levels in brackets or logfmt fields near the start of the line. Both are looked for in one pass, eight
+             * bytes at a time.
+             */
+            bool detect_marker(const char* begin, const char* end, Level& level) noexcept {
+                const auto* window_end = end - begin > MARKER_WINDOW ? begin + MARKER_WINDOW : end;
+                const auto* pos = begin;
+                while (window_end - pos >= 8) {
+                    uint64_t word = 0;
+                    std::memcpy(&word, pos, sizeof(word));
+                    auto found = first_match(word, 0x5b5b5b5b5b5b5b5bULL) | first_match(word, 0x3d3d3d3d3d3d3d3dULL);
+                    if (found == 0) {
+                        pos += 8;
+                        continue;
+                    }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                    pos += __builtin_ctzll(found) / 8;
+#else
+                    pos += __builtin_clzll(found) / 8;
+#endif
+                    // The lowest flagged byte always matches, on big endian machines the first one may not
+                    if ((*pos == '[' || *pos == '=') && detect_at(begin, pos, end, level)) {
+                        return true;
+                    }
+                    pos++;
+                }
+                for (; pos < window_end; pos++) {
+                    if ((*pos == '[' || *pos == '=') && detect_at(begin, pos, end, level)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }  // namespace
+
+        bool detect(const char* line, size_t length, Level& level) noexcept {
+            const auto* end = line + length;
+            while (line < end && (*line == ' ' || *line == '\t')) {
+                line++;
+            }
+            if (line == end) {
+                return false;
+            }
+            if (*line == '{') {
+                return detect_json(line, end, level);
+            }
+            return detect_glog(line, end, level) || detect_word(line, end, level) || detect_marker(line, end, level);
+        }
+
+        bool parse(const char* name, size_t length, Level& level) noexcept {
+            if (length < 3 || length > MAX_NAME_LENGTH) {
+                return false;
+            }
+            // Setting 0x20 lower-cases letters and never turns anything else into one
+            char lower[MAX_NAME_LENGTH] = {};
+            for (size_t i = 0; i < length; i++) {
+                lower[i] = static_cast<char>(name[i] | 0x20);
+            }
+            uint64_t packed = 0;
+            std::memcpy(&packed, static_cast<char*>(lower), sizeof(packed));
+            switch (packed) {
+                case pack("trace"):
+                    level = spdlog::level::trace;
+                    return true;
+                case pack("debug"):
+                    level = spdlog::level::debug;
+                    return true;
+                case pack("info"):
+                case pack("notice"):
+                    level = spdlog::level::info;
+                    return true;
+                case pack("warn"):
+                case pack("warning"):
+                    level = spdlog::level::warn;
+                    return true;
+                case pack("err"):
+                case pack("error"):
+                    level = spdlog::level::err;
+                    return true;
+                case pack("crit"):
+                case pack("critical"):
+                case pack("fatal"):
+                case pack("panic"):
+                case pack("alert"):
+                case pack("emerg"):
+                    level = spdlog::level::critical;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        const char* name(Level level) noexcept {
+            switch (level) {
+                case spdlog::level::trace:
+                    return "trace";
+                case spdlog::level::debug:
+                    return "debug";
+                case spdlog::level::info:
+                    return "info";
+                case spdlog::level::warn:
+                    return "warning";
+                case spdlog::level::err:
+                    return "error";
+                default:
+                    return "critical";
+            }
+        }
+
+        unsigned int syslog_severity(Level level) noexcept {
+            switch (level) {
+                case spdlog::level::trace:
+                case spdlog::level::debug:
+                    return 7;
+                case spdlog::level::info:
+                    return 6;
+                case spdlog::level::warn:
+                    return 4;
+                case spdlog::level::err:
+                    return 3;
+                default:
+                    return 2;
+            }
+        }
+    }  // namespace levels
+}  // namespace scinit
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_LOGLEVELS_H
+#define CINIT_LOGLEVELS_H
+
+#include <spdlog/common.h>
+#include <cstddef>
+
+namespace scinit {
+    namespace levels {
+        using Level = spdlog::level::level_enum;
+
+        /*
+         * Find the level of a line of program output ('detect_level'), returns false if it has no recognizable
+         * marker. Recognized are, in this order:
+         *   - a JSON object with a "level" or "severity" field, a name or a pino/bunyan number (30 is info)
+         *   - glog prefixes like 'E0101 12:00:00.000000 ...'
+         *   - an upper case level at the start of the line, followed by ':', ' ' or '|' ('ERROR:root:...')
+         *   - a level in brackets within the first 64 bytes ('[2018-06-01 12:00:00] [error] ...')
+         *   - logfmt 'level=warn' within the first 64 bytes
+         * Only the start of the line is scanned (JSON lines are searched for the field), so it costs a few
+         * nanoseconds per line.
+         */
+        bool detect(const char* line, size_t length, Level& level) noexcept;
+
+        /*
+         * Parse a level name, case insensitive: trace, debug, info, notice (info), warn/warning, err/error and
+         * crit/critical/fatal/panic/alert/emerg. Returns false for anything else.
+         */
+        bool parse(const char* name, size_t length, Level& level) noexcept;
+
+        // Lower case name as used in JSON output: trace, debug, info, warning, error or critical
+        const char* name(Level level) noexcept;
+
+        // RFC 5424 severity of a level
+        unsigned int syslog_severity(Level level) noexcept;
+    }  // namespace levels
+}  // namespace scinit
+
+#endif  // CINIT_LOGLEVELS_H
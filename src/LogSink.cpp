@@ -0,0 +1,332 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogSink.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "ChildProcessException.h"
+#include "log.h"
+
+// Write once this much is buffered, and drop lines once this much couldn't be written
+#define FLUSH_BYTES (64 * 1024)
+#define MAX_PENDING_BYTES (4 * 1024 * 1024)
+// Messages sent with one sendmmsg() call, longer messages are cut off
+#define SYSLOG_BATCH 64
+#define SYSLOG_MAX_MESSAGE 8192
+// RFC 5424 limits
+#define SYSLOG_MAX_APP_NAME 48
+#define SYSLOG_MAX_HOSTNAME 255
+
+namespace scinit {
+    void LogSink::enqueue(std::string message, bool always) {
+        if (!always && pending_bytes + message.size() > MAX_PENDING_BYTES) {
+            dropped++;
+            unreported_drops++;
+            return;
+        }
+        pending_bytes += message.size();
+        pending.push_back(std::move(message));
+    }
+
+    uint64_t LogSink::take_drops() noexcept {
+        auto drops = unreported_drops;
+        unreported_drops = 0;
+        return drops;
+    }
+
+    void LogSink::dequeue(size_t count, size_t partial) noexcept {
+        for (size_t i = 0; i < count; i++) {
+            pending_bytes -= pending[i].size();
+        }
+        pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(count));
+        if (partial > 0) {
+            pending.front().erase(0, partial);
+            pending_bytes -= partial;
+        }
+    }
+
+    FileLogSink::FileLogSink(std::string path, Rotation rotation) noexcept(false)
+      : path(std::move(path)), rotation(rotation) {
+        open_file();
+    }
+
+    FileLogSink::~FileLogSink() {
+        flush();
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void FileLogSink::open_file() noexcept(false) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+        if (fd == -1) {
+            throw ChildProcessException(("Couldn't open log file " + path + ": " + std::strerror(errno)).c_str());
+        }
+        struct stat info {};
+        size = fstat(fd, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+        opened_at = time(nullptr);
+    }
+
+    void FileLogSink::write(const std::string& line) {
+        enqueue(line + "\n");
+        if (pending_bytes >= FLUSH_BYTES) {
+            flush();
+        }
+    }
+
+    void FileLogSink::flush() {
+        if (auto drops = take_drops()) {
+            // Lines are only dropped while the buffer is full, so they were lost right after the pending ones
+            enqueue("scinit: " + std::to_string(drops) + " line(s) dropped\n", true);
+        }
+        if (pending.empty()) {
+            return;
+        }
+        if (rotation.max_bytes > 0 && size > 0 && size + pending_bytes > rotation.max_bytes) {
+            rotate();
+        }
+        write_pending();
+    }
+
+    void FileLogSink::tick(time_t now) {
+        if (rotation.max_age_s > 0 && now - opened_at >= static_cast<time_t>(rotation.max_age_s) &&
+            (size > 0 || !pending.empty())) {
+            write_pending();
+            rotate();
+        }
+        flush();
+    }
+
+    bool FileLogSink::write_pending() noexcept {
+        while (!pending.empty() && fd != -1) {
+            struct iovec iov[IOV_MAX];
+            size_t count = std::min(pending.size(), static_cast<size_t>(IOV_MAX));
+            for (size_t i = 0; i < count; i++) {
+                iov[i].iov_base = &pending[i][0];
+                iov[i].iov_len = pending[i].size();
+            }
+            auto written = writev(fd, static_cast<struct iovec*>(iov), static_cast<int>(count));
+            if (written == -1 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                // Disk full or similar, keep the lines until the buffer is full
+                return false;
+            }
+            size += static_cast<uint64_t>(written);
+            auto done = static_cast<size_t>(written);
+            size_t lines = 0;
+            while (lines < pending.size() && done >= pending[lines].size()) {
+                done -= pending[lines].size();
+                lines++;
+            }
+            dequeue(lines, done);
+        }
+        return pending.empty();
+    }
+
+    void FileLogSink::rotate() {
+        char stamp[32];
+        struct tm local {};
+        auto now = time(nullptr);
+        localtime_r(&now, &local);
+        strftime(static_cast<char*>(stamp), sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+        auto target = path + "." + static_cast<char*>(stamp);
+        struct stat info {};
+        for (int i = 1; stat(target.c_str(), &info) == 0; i++) {
+            target = path + "." + static_cast<char*>(stamp) + "-" + std::to_string(i);
+        }
+        if (rename(path.c_str(), target.c_str()) == -1) {
+            LOG->warn("Couldn't rotate log file {0}: {1}", path, std::strerror(errno));
+            return;
+        }
+        close(fd);
+        fd = -1;
+        try {
+            open_file();
+        } catch (ChildProcessException& e) {
+            LOG->error("{0}", e.what());
+            return;
+        }
+        // Unlinking large files may take a while on some file systems, don't make the event loop wait for it
+        auto expired = expired_files(path, rotation.retain);
+        if (!expired.empty()) {
+            std::thread([expired]() {
+                for (const auto& file : expired) {
+                    unlink(file.c_str());
+                }
+            }).detach();
+        }
+    }
+
+    std::vector<std::string> FileLogSink::expired_files(const std::string& path, unsigned int retain) {
+        auto slash = path.rfind('/');
+        auto dir = slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+        auto prefix = (slash == std::string::npos ? path : path.substr(slash + 1)) + ".";
+        std::vector<std::string> rotated;
+        DIR* listing = opendir(dir.c_str());
+        if (listing == nullptr) {
+            return rotated;
+        }
+        while (auto entry = readdir(listing)) {
+            std::string name(static_cast<char*>(entry->d_name));
+            // Rotated files are '<name>.<timestamp>', which also sorts them by age
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+                std::isdigit(name[prefix.size()])) {
+                rotated.push_back(dir + "/" + name);
+            }
+        }
+        closedir(listing);
+        if (rotated.size() <= retain) {
+            return {};
+        }
+        std::sort(rotated.begin(), rotated.end());
+        rotated.resize(rotated.size() - retain);
+        return rotated;
+    }
+
+    SyslogSink::SyslogSink(std::string socket_path, const std::string& app_name, unsigned int facility,
+                           unsigned int severity) noexcept(false)
+      : socket_path(std::move(socket_path)), priority(facility * 8 + severity) {
+        // APP-NAME and HOSTNAME are printable ASCII without spaces
+        for (auto c : app_name.substr(0, SYSLOG_MAX_APP_NAME)) {
+            this->app_name += c > ' ' && c <= '~' ? c : '_';
+        }
+        char name[SYSLOG_MAX_HOSTNAME + 1] = {0};
+        if (gethostname(static_cast<char*>(name), SYSLOG_MAX_HOSTNAME) == 0) {
+            hostname = static_cast<char*>(name);
+        }
+        if (hostname.empty()) {
+            hostname = "-";
+        }
+        fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            auto reason = "Couldn't create syslog socket: " + std::string(std::strerror(errno));
+            throw ChildProcessException(reason.c_str());
+        }
+        if (!connect_socket()) {
+            LOG->warn("Couldn't connect to syslog at {0}: {1}, trying again later", this->socket_path,
+                      std::strerror(errno));
+        }
+    }
+
+    SyslogSink::~SyslogSink() {
+        flush();
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    bool SyslogSink::connect_socket() noexcept {
+        struct sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(static_cast<char*>(addr.sun_path), socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        connected = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+        return connected;
+    }
+
+    std::string SyslogSink::format(unsigned int priority, const struct timespec& time, const std::string& hostname,
+                                   const std::string& app_name, const char* message, size_t length) {
+        char stamp[32];
+        struct tm utc {};
+        gmtime_r(&time.tv_sec, &utc);
+        auto used = strftime(static_cast<char*>(stamp), sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+        snprintf(static_cast<char*>(stamp) + used, sizeof(stamp) - used, ".%06ldZ", time.tv_nsec / 1000);
+        std::string result = "<" + std::to_string(priority) + ">1 " + static_cast<char*>(stamp) + " " + hostname +
+                             " " + app_name + " - - - ";
+        result.append(message, std::min(length, static_cast<size_t>(SYSLOG_MAX_MESSAGE)));
+        return result;
+    }
+
+    void SyslogSink::write(const std::string& line) { write(line, priority % 8); }
+
+    void SyslogSink::write(const std::string& line, unsigned int severity) {
+        struct timespec now {};
+        clock_gettime(CLOCK_REALTIME, &now);
+        enqueue(format(priority - priority % 8 + severity, now, hostname, app_name, line.data(), line.size()));
+        if (pending.size() >= SYSLOG_BATCH) {
+            send_pending();
+        }
+    }
+
+    void SyslogSink::flush() {
+        if (auto drops = take_drops()) {
+            struct timespec now {};
+            clock_gettime(CLOCK_REALTIME, &now);
+            auto note = "scinit: " + std::to_string(drops) + " line(s) dropped";
+            enqueue(format(priority, now, hostname, app_name, note.data(), note.size()), true);
+        }
+        send_pending();
+    }
+
+    void SyslogSink::tick(time_t /*now*/) {
+        // The syslog daemon might have been (re)started
+        if (!connected) {
+            connect_socket();
+        }
+        flush();
+    }
+
+    void SyslogSink::send_pending() noexcept {
+        while (!pending.empty() && connected) {
+            struct mmsghdr messages[SYSLOG_BATCH];
+            struct iovec iov[SYSLOG_BATCH];
+            auto count = std::min(pending.size(), static_cast<size_t>(SYSLOG_BATCH));
+            for (size_t i = 0; i < count; i++) {
+                iov[i].iov_base = &pending[i][0];
+                iov[i].iov_len = pending[i].size();
+                messages[i] = {};
+                messages[i].msg_hdr.msg_iov = &iov[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            int sent = sendmmsg(fd, static_cast<struct mmsghdr*>(messages), static_cast<unsigned int>(count), 0);
+            if (sent > 0) {
+                dequeue(static_cast<size_t>(sent));
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == ENOBUFS) {
+                // The daemon is behind, try again on the next tick
+                return;
+            }
+            if (errno == ECONNREFUSED || errno == ENOTCONN || errno == ENOENT) {
+                // The daemon went away, the socket has to be connected again once it is back
+                connected = false;
+                close(fd);
+                fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                return;
+            }
+            // Something is wrong with this message (e.g. too large for the daemon), skip it
+            dropped++;
+            dequeue(1);
+        }
+    }
+}  // namespace scinit
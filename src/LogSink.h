@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_LOGSINK_H
+#define CINIT_LOGSINK_H
+
+#include <sys/types.h>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace scinit {
+    /*
+     * Destination for the output lines of programs that don't log to scinit's stdout. Sinks buffer lines and write
+     * them in batches, either once enough has accumulated or when tick() is called from the event loop. A sink
+     * never blocks the event loop waiting for its destination: if it can't keep up, lines are dropped and counted,
+     * and the number of dropped lines is written once the destination accepts data again.
+     */
+    class LogSink {
+      public:
+        LogSink() = default;
+        LogSink(const LogSink&) = delete;
+        LogSink& operator=(const LogSink&) = delete;
+        virtual ~LogSink() = default;
+
+        // Queue one line, without the trailing newline
+        virtual void write(const std::string& line) = 0;
+        // Write everything that is queued
+        virtual void flush() = 0;
+        // Called about once per second from the event loop, 'now' is the wall clock time
+        virtual void tick(time_t now) = 0;
+
+        uint64_t get_dropped() const noexcept { return dropped; }
+
+      protected:
+        /*
+         * Queue a message unless too much is queued already, otherwise it is dropped and counted. With 'always',
+         * it is queued in any case (used for the note about dropped lines).
+         */
+        void enqueue(std::string message, bool always = false);
+        // Number of messages dropped since the last call, the sink writes a note about them
+        uint64_t take_drops() noexcept;
+        // Remove the first 'count' messages, of which the last may only be written up to 'partial' bytes
+        void dequeue(size_t count, size_t partial = 0) noexcept;
+
+        std::vector<std::string> pending;
+        size_t pending_bytes = 0;
+        uint64_t dropped = 0;
+
+      private:
+        uint64_t unreported_drops = 0;
+    };
+
+    /*
+     * Appends to a file (O_APPEND, so concurrent writers never overwrite each other) with writev. The file is
+     * rotated by size or age: it is renamed to '<path>.<timestamp>' and a new one is opened, which are cheap
+     * operations. Deleting rotated files beyond 'retain' happens on a background thread, since unlinking a large
+     * file can take a while.
+     */
+    class FileLogSink : public LogSink {
+      public:
+        struct Rotation {
+            // Rotate once the file reaches this size or age, 0 disables the respective check
+            uint64_t max_bytes = 0;
+            unsigned int max_age_s = 0;
+            // Number of rotated files that are kept
+            unsigned int retain = 5;
+        };
+
+        // Opens (or creates) the file, throws a ChildProcessException if that fails
+        FileLogSink(std::string path, Rotation rotation) noexcept(false);
+        ~FileLogSink() override;
+
+        void write(const std::string& line) override;
+        void flush() override;
+        void tick(time_t now) override;
+
+        std::string get_path() const noexcept { return path; }
+
+        // Rotated files of 'path' that are to be deleted to keep 'retain' of them, oldest first
+        static std::vector<std::string> expired_files(const std::string& path, unsigned int retain);
+
+      private:
+        void open_file() noexcept(false);
+        void rotate();
+        bool write_pending() noexcept;
+
+        std::string path;
+        Rotation rotation;
+        int fd = -1;
+        uint64_t size = 0;
+        time_t opened_at = 0;
+    };
+
+    /*
+     * Sends every line as an RFC 5424 message to a local syslog daemon, over a non-blocking Unix datagram socket
+     * (usually /dev/log). Messages are sent in batches with sendmmsg(). While the daemon doesn't keep up, they stay
+     * queued (and are dropped once too many are), if it isn't there, the socket is connected again on the next
+     * tick.
+     */
+    class SyslogSink : public LogSink {
+      public:
+        // 'facility' and 'severity' as numbers, see RFC 5424. Throws a ChildProcessException if there is no socket.
+        SyslogSink(std::string socket_path, const std::string& app_name, unsigned int facility,
+                   unsigned int severity) noexcept(false);
+        ~SyslogSink() override;
+
+        void write(const std::string& line) override;
+        // Send a line with another severity than the sink's
+        void write(const std::string& line, unsigned int severity);
+        void flush() override;
+        void tick(time_t now) override;
+
+        // '<PRI>1 TIMESTAMP HOSTNAME APP-NAME - - - MSG'
+        static std::string format(unsigned int priority, const struct timespec& time, const std::string& hostname,
+                                  const std::string& app_name, const char* message, size_t length);
+
+      private:
+        bool connect_socket() noexcept;
+        void send_pending() noexcept;
+
+        std::string socket_path, app_name, hostname;
+        unsigned int priority;
+        int fd = -1;
+        bool connected = false;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_LOGSINK_H
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OutputFilter.h"
+#include <algorithm>
+#include <cstring>
+#include "ConfigParseException.h"
+
+namespace scinit {
+    void OutputFilter::add_rule(Action action, Match match, const std::string& pattern) noexcept(false) {
+        Rule rule;
+        rule.action = action;
+        rule.match = match;
+        rule.pattern = pattern;
+        if (match == SUBSTRING) {
+            // How far the window may move if its last byte is 'b'
+            rule.shift.fill(pattern.size());
+            for (size_t i = 0; i + 1 < pattern.size(); i++) {
+                rule.shift[static_cast<unsigned char>(pattern[i])] = pattern.size() - 1 - i;
+            }
+        } else if (match == REGEX) {
+            try {
+                rule.regex = std::regex(pattern, std::regex::ECMAScript | std::regex::optimize);
+                // std::regex_search would still try (and fail) '^' at every position of the line. Alternatives might
+                // not be anchored, so those are left alone.
+                if (!pattern.empty() && pattern[0] == '^' && pattern.find('|') == std::string::npos) {
+                    rule.flags = std::regex_constants::match_continuous;
+                }
+            } catch (std::regex_error& e) {
+                auto message = "Invalid filter regex '" + pattern + "': " + e.what();
+                throw ConfigParseException(message.c_str());
+            }
+        }
+        rules.push_back(std::move(rule));
+    }
+
+    bool OutputFilter::keep(const char* line, size_t length) const noexcept {
+        for (const auto& rule : rules) {
+            bool matches = false;
+            switch (rule.match) {
+                case PREFIX:
+                    matches = length >= rule.pattern.size() &&
+                              std::memcmp(line, rule.pattern.data(), rule.pattern.size()) == 0;
+                    break;
+                case SUBSTRING:
+                    matches = contains(rule, line, length);
+                    break;
+                case REGEX:
+                    matches = std::regex_search(line, line + length, rule.regex, rule.flags);
+                    break;
+            }
+            if (matches) {
+                return rule.action == KEEP;
+            }
+        }
+        return default_action == KEEP;
+    }
+
+    bool OutputFilter::contains(const Rule& rule, const char* line, size_t length) noexcept {
+        const auto& pattern = rule.pattern;
+        auto size = pattern.size();
+        if (size == 0) {
+            return true;
+        }
+        if (size > length) {
+            return false;
+        }
+        if (size == 1) {
+            return std::memchr(line, pattern[0], length) != nullptr;
+        }
+        auto last = pattern[size - 1];
+        for (size_t pos = 0; pos + size <= length;) {
+            auto byte = line[pos + size - 1];
+            if (byte == last && std::memcmp(line + pos, pattern.data(), size - 1) == 0) {
+                return true;
+            }
+            pos += rule.shift[static_cast<unsigned char>(byte)];
+        }
+        return false;
+    }
+
+    OutputSampler::OutputSampler(unsigned int every, unsigned int per_second) noexcept
+      : every(every), per_second(per_second), tokens(per_second) {}
+
+    bool OutputSampler::keep(uint64_t now_ms) noexcept {
+        bool kept = every == 0 || seen % every == 0;
+        seen++;
+        if (kept && per_second > 0) {
+            if (refilled_ms == 0) {
+                refilled_ms = now_ms;
+            }
+            tokens = std::min(static_cast<double>(per_second),
+                              tokens + static_cast<double>(now_ms - refilled_ms) * per_second / 1000);
+            refilled_ms = now_ms;
+            kept = tokens >= 1;
+            if (kept) {
+                tokens--;
+            }
+        }
+        if (!kept) {
+            suppressed++;
+        }
+        return kept;
+    }
+
+    uint64_t OutputSampler::take_suppressed() noexcept {
+        auto count = suppressed;
+        suppressed = 0;
+        return count;
+    }
+}  // namespace scinit
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_OUTPUTFILTER_H
+#define CINIT_OUTPUTFILTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace scinit {
+    /*
+     * Decides which output lines of a program are kept ('filter'), before they are formatted or written anywhere.
+     * Rules are checked in order and the first matching one decides, lines that match no rule get the default.
+     * Prefixes are compared directly, substrings are searched with Boyer-Moore-Horspool and regular expressions
+     * are compiled once, when the config is read. Rules are shared by all instances of a program.
+     */
+    class OutputFilter {
+      public:
+        enum Action { KEEP, DROP };
+        enum Match { PREFIX, SUBSTRING, REGEX };
+
+        // Throws a ConfigParseException if 'pattern' is an invalid regular expression
+        void add_rule(Action action, Match match, const std::string& pattern) noexcept(false);
+        void set_default(Action action) noexcept { default_action = action; }
+
+        bool keep(const char* line, size_t length) const noexcept;
+
+      private:
+        struct Rule {
+            Action action;
+            Match match;
+            std::string pattern;
+            // Horspool shift per byte for SUBSTRING rules
+            std::array<size_t, 256> shift;
+            std::regex regex;
+            std::regex_constants::match_flag_type flags = std::regex_constants::match_default;
+        };
+
+        static bool contains(const Rule& rule, const char* line, size_t length) noexcept;
+
+        std::vector<Rule> rules;
+        Action default_action = KEEP;
+    };
+
+    /*
+     * Rate-based sampling of the lines of one process: keeps one in 'every' lines and at most 'per_second' lines
+     * per second (a token bucket that allows bursts of up to one second's worth). 0 disables either limit.
+     */
+    class OutputSampler {
+      public:
+        OutputSampler(unsigned int every, unsigned int per_second) noexcept;
+
+        bool keep(uint64_t now_ms) noexcept;
+        // Number of lines suppressed since the last call
+        uint64_t take_suppressed() noexcept;
+
+      private:
+        unsigned int every, per_second;
+        uint64_t seen = 0, suppressed = 0, refilled_ms = 0;
+        double tokens;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_OUTPUTFILTER_H
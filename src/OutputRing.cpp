@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OutputRing.h"
+#include <algorithm>
+#include <cstring>
+
+namespace scinit {
+    OutputRing::OutputRing(size_t max_lines, size_t max_bytes)
+      : data(std::max(max_bytes, static_cast<size_t>(1))), entries(std::max(max_lines, static_cast<size_t>(1))) {}
+
+    void OutputRing::add(const char* line, size_t length, bool is_stderr) noexcept {
+        if (length > data.size()) {
+            line += length - data.size();
+            length = data.size();
+        }
+        while (count == entries.size() || used + length > data.size()) {
+            drop_oldest();
+        }
+        entries[(first + count) % entries.size()] = Entry{head, length, is_stderr};
+        count++;
+        // The line may wrap around the end of the buffer
+        auto tail = std::min(length, data.size() - head);
+        std::memcpy(&data[head], line, tail);
+        std::memcpy(&data[0], line + tail, length - tail);
+        head = (head + length) % data.size();
+        used += length;
+    }
+
+    void OutputRing::clear() noexcept { first = count = head = used = 0; }
+
+    void OutputRing::drop_oldest() noexcept {
+        used -= entries[first].length;
+        first = (first + 1) % entries.size();
+        count--;
+    }
+
+    std::string OutputRing::dump() const {
+        std::string result;
+        result.reserve(used + count * 10);
+        for (size_t i = 0; i < count; i++) {
+            const auto& entry = entries[(first + i) % entries.size()];
+            if (i > 0) {
+                result += '\n';
+            }
+            if (entry.is_stderr) {
+                result += "[stderr] ";
+            }
+            auto tail = std::min(entry.length, data.size() - entry.offset);
+            result.append(&data[entry.offset], tail);
+            result.append(&data[0], entry.length - tail);
+        }
+        return result;
+    }
+}  // namespace scinit
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_OUTPUTRING_H
+#define CINIT_OUTPUTRING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace scinit {
+    /*
+     * The most recent output lines of a program ('crash_log_lines'/'crash_log_bytes'), dumped when it crashes.
+     * Both the line index and the bytes are rings that are allocated once, adding a line only copies it and drops
+     * the oldest lines until it fits. A line longer than the whole buffer keeps its end.
+     */
+    class OutputRing {
+      public:
+        OutputRing(size_t max_lines, size_t max_bytes);
+
+        void add(const char* line, size_t length, bool is_stderr) noexcept;
+        void clear() noexcept;
+
+        size_t get_lines() const noexcept { return count; }
+        size_t get_bytes() const noexcept { return used; }
+
+        // All lines, oldest first and separated by newlines. Lines from stderr are prefixed with '[stderr] '.
+        std::string dump() const;
+
+      private:
+        struct Entry {
+            size_t offset, length;
+            bool is_stderr;
+        };
+
+        void drop_oldest() noexcept;
+
+        std::vector<char> data;
+        std::vector<Entry> entries;
+        // Index of the oldest entry, number of entries, next byte to write and number of bytes in use
+        size_t first = 0, count = 0, head = 0, used = 0;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_OUTPUTRING_H
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OutputTarget.h"
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include "ChildProcessException.h"
+
+// Largest chunk that is copied at once if splicing isn't possible
+#define COPY_BUF_SIZE 65536
+
+namespace scinit {
+    OutputTarget::OutputTarget(int fd, bool owned) noexcept : fd(fd), owned(owned) {
+        struct stat info {};
+        is_pipe = fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+    }
+
+    OutputTarget::~OutputTarget() {
+        if (owned) {
+            close(fd);
+        }
+        if (scratch[0] != -1) {
+            close(scratch[0]);
+            close(scratch[1]);
+        }
+    }
+
+    std::unique_ptr<OutputTarget> OutputTarget::open_file(const std::string& path) noexcept(false) {
+        int file = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0640);
+        if (file == -1 || lseek(file, 0, SEEK_END) == -1) {
+            auto reason = "Couldn't open " + path + ": " + std::strerror(errno);
+            if (file != -1) {
+                close(file);
+            }
+            throw ChildProcessException(reason.c_str());
+        }
+        return std::make_unique<OutputTarget>(file, true);
+    }
+
+    ssize_t OutputTarget::forward(int from, OutputTarget* mirror) noexcept {
+        int available = 0;
+        if (ioctl(from, FIONREAD, &available) == -1 || available <= 0) {
+            return 0;
+        }
+        auto remaining = static_cast<size_t>(available);
+        ssize_t total = 0;
+        while (remaining > 0) {
+            size_t chunk = is_pipe || (mirror && mirror->is_pipe) ? line_chunk(from, remaining) : remaining;
+            auto moved = -1L;
+            if (can_splice && (!mirror || mirror->can_splice)) {
+                moved = splice_chunk(from, chunk, mirror);
+            }
+            if (moved == -1) {
+                moved = copy_chunk(from, chunk, mirror);
+            }
+            if (moved <= 0) {
+                break;
+            }
+            total += moved;
+            remaining -= std::min(remaining, static_cast<size_t>(moved));
+        }
+        return total;
+    }
+
+    size_t OutputTarget::chunk_size(const char* data, size_t size) noexcept {
+        if (size <= PIPE_BUF) {
+            return size;
+        }
+        auto last = static_cast<const char*>(memrchr(data, '\n', PIPE_BUF));
+        if (last == nullptr) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            last = static_cast<const char*>(std::memchr(data + PIPE_BUF, '\n', size - PIPE_BUF));
+        }
+        return last == nullptr ? size : static_cast<size_t>(last - data) + 1;
+    }
+
+    size_t OutputTarget::line_chunk(int from, size_t available) noexcept {
+        char buf[COPY_BUF_SIZE];
+        auto peeked = peek(from, static_cast<char*>(buf), std::min(available, sizeof(buf)));
+        if (peeked <= 0) {
+            // Can't look ahead (e.g. the program writes to a PTY), at least keep the chunks atomic
+            return std::min(available, static_cast<size_t>(PIPE_BUF));
+        }
+        return chunk_size(static_cast<char*>(buf), static_cast<size_t>(peeked));
+    }
+
+    ssize_t OutputTarget::peek(int from, char* buf, size_t size) noexcept {
+        if (scratch[0] == -1 && pipe2(static_cast<int*>(scratch), O_CLOEXEC | O_NONBLOCK) == -1) {
+            return -1;
+        }
+        // tee() leaves the data in 'from', reading the duplicate back doesn't consume anything
+        auto teed = tee(from, scratch[1], size, SPLICE_F_NONBLOCK);
+        if (teed <= 0) {
+            return -1;
+        }
+        ssize_t got = 0;
+        while (got < teed) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            auto n = read(scratch[0], buf + got, static_cast<size_t>(teed - got));
+            if (n <= 0) {
+                // Don't let leftovers end up in the next peek
+                close(scratch[0]);
+                close(scratch[1]);
+                scratch[0] = scratch[1] = -1;
+                return -1;
+            }
+            got += n;
+        }
+        return got;
+    }
+
+    ssize_t OutputTarget::splice_chunk(int from, size_t size, OutputTarget* mirror) noexcept {
+        if (mirror) {
+            // tee() only duplicates between two pipes and doesn't consume the data
+            auto teed = mirror->is_pipe ? tee(from, mirror->fd, size, 0) : -1;
+            if (teed <= 0) {
+                mirror->can_splice = false;
+                return -1;
+            }
+            size = static_cast<size_t>(teed);
+        }
+        auto moved = splice(from, nullptr, fd, nullptr, size, SPLICE_F_MOVE);
+        if (moved == -1) {
+            if (errno == EINVAL) {
+                can_splice = false;
+            }
+            // The mirror already has its copy
+            return mirror ? copy_chunk(from, size, nullptr) : -1;
+        }
+        if (mirror && static_cast<size_t>(moved) < size) {
+            // Short splice (e.g. a full disk), the rest is already in the mirror as well
+            auto copied = copy_chunk(from, size - static_cast<size_t>(moved), nullptr);
+            moved += std::max(copied, 0L);
+        }
+        return moved;
+    }
+
+    ssize_t OutputTarget::copy_chunk(int from, size_t size, OutputTarget* mirror) noexcept {
+        char buf[COPY_BUF_SIZE];
+        auto got = read(from, static_cast<char*>(buf), std::min(size, sizeof(buf)));
+        if (got <= 0) {
+            return got;
+        }
+        write_all(static_cast<char*>(buf), static_cast<size_t>(got));
+        if (mirror) {
+            mirror->write_all(static_cast<char*>(buf), static_cast<size_t>(got));
+        }
+        return got;
+    }
+
+    bool OutputTarget::write_all(const char* data, size_t size) noexcept {
+        while (size > 0) {
+            auto written = write(fd, data, size);
+            if (written == -1 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}  // namespace scinit
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_OUTPUTTARGET_H
+#define CINIT_OUTPUTTARGET_H
+
+#include "gtest/gtest_prod.h"
+#include <sys/types.h>
+#include <memory>
+#include <string>
+
+namespace scinit {
+    /*
+     * Where the output of programs with 'output: passthrough' or 'output: tee' goes: scinit's stdout/stderr or a
+     * file. Data is moved from the program's pipe with splice() (and duplicated with tee() for a mirror), so it
+     * never passes through userspace. If the kernel can't splice to the destination, the data is copied instead.
+     *
+     * Pipe destinations get the data in chunks that end at a line boundary and are at most PIPE_BUF bytes long,
+     * which the kernel writes atomically, so forwarded lines never interleave with other writers of the same pipe.
+     * A line longer than PIPE_BUF is forwarded in one piece, but the kernel doesn't write that much atomically, so
+     * only such lines may still be interleaved with other output.
+     */
+    class OutputTarget {
+      public:
+        // If 'owned' is set, 'fd' is closed when the target is destroyed
+        OutputTarget(int fd, bool owned) noexcept;
+        OutputTarget(const OutputTarget&) = delete;
+        OutputTarget& operator=(const OutputTarget&) = delete;
+        ~OutputTarget();
+
+        /*
+         * Open a file for appending. Older kernels refuse to splice() into files opened with O_APPEND, so the file
+         * is opened without it and written at its end instead, which is safe as long as scinit is the only writer.
+         */
+        static std::unique_ptr<OutputTarget> open_file(const std::string& path) noexcept(false);
+
+        /*
+         * Move everything that is currently buffered in the pipe 'from' to this target and copy it to 'mirror'
+         * as well, if given. Returns the number of bytes forwarded.
+         */
+        ssize_t forward(int from, OutputTarget* mirror = nullptr) noexcept;
+
+        int get_fd() const noexcept { return fd; }
+        bool is_zero_copy() const noexcept { return can_splice; }
+
+        /*
+         * Length of the first chunk of 'data' for a pipe destination: all complete lines that fit into PIPE_BUF
+         * bytes, or the first line if it is longer than that. Data without a newline is one chunk.
+         */
+        static size_t chunk_size(const char* data, size_t size) noexcept;
+
+      private:
+        FRIEND_TEST(OutputTargetTests, LinesStraddlingPipeBufAreWrittenWhole);
+
+        size_t line_chunk(int from, size_t available) noexcept;
+        ssize_t peek(int from, char* buf, size_t size) noexcept;
+        ssize_t splice_chunk(int from, size_t size, OutputTarget* mirror) noexcept;
+        ssize_t copy_chunk(int from, size_t size, OutputTarget* mirror) noexcept;
+        bool write_all(const char* data, size_t size) noexcept;
+
+        int fd;
+        // Scratch pipe for peek()
+        int scratch[2] = {-1, -1};
+        bool owned, is_pipe = false, can_splice = true;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_OUTPUTTARGET_H
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Prefetcher.h"
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <set>
+#include "ChildProcessException.h"
+#include "ElfFile.h"
+
+namespace scinit {
+    Prefetcher::~Prefetcher() {
+        cancelled = true;
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (event_fd != -1) {
+            close(event_fd);
+        }
+    }
+
+    void Prefetcher::start(std::list<std::pair<unsigned int, std::string>> programs) noexcept(false) {
+        event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (event_fd == -1) {
+            throw ChildProcessException("Couldn't create eventfd for prefetching!");
+        }
+        pending = static_cast<unsigned int>(programs.size());
+        worker = std::thread(&Prefetcher::run, this, std::move(programs));
+    }
+
+    std::list<Prefetcher::Result> Prefetcher::collect() noexcept {
+        uint64_t count = 0;
+        if (read(event_fd, &count, sizeof(count)) == -1) {
+            count = 0;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        std::list<Result> done;
+        done.swap(results);
+        pending -= static_cast<unsigned int>(done.size());
+        return done;
+    }
+
+    bool Prefetcher::is_done() noexcept {
+        std::lock_guard<std::mutex> guard(lock);
+        return pending == 0 && results.empty();
+    }
+
+    uint64_t Prefetcher::warm_up(const std::string& path) noexcept {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return 0;
+        }
+        struct stat info {};
+        uint64_t size = 0;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            size = static_cast<uint64_t>(info.st_size);
+            // readahead blocks until the pages are read, the hint is the fallback where it isn't supported
+            if (readahead(fd, 0, size) == -1 && posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) != 0) {
+                size = 0;
+            }
+        }
+        close(fd);
+        return size;
+    }
+
+    void Prefetcher::run(std::list<std::pair<unsigned int, std::string>> programs) noexcept {
+        // Canonical paths of the files read so far
+        std::set<std::string> warmed;
+        for (const auto& program : programs) {
+            if (cancelled) {
+                return;
+            }
+            auto begin = std::chrono::steady_clock::now();
+            Result result;
+            result.id = program.first;
+            for (const auto& file : elf::files_to_load(elf::find_executable(program.second))) {
+                char resolved[PATH_MAX];
+                if (realpath(file.c_str(), static_cast<char*>(resolved)) == nullptr ||
+                    !warmed.insert(static_cast<char*>(resolved)).second) {
+                    continue;
+                }
+                auto bytes = warm_up(static_cast<char*>(resolved));
+                if (bytes > 0) {
+                    result.files++;
+                    result.bytes += bytes;
+                }
+            }
+            result.duration_us = static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                results.push_back(result);
+            }
+            uint64_t one = 1;
+            if (write(event_fd, &one, sizeof(one)) == -1) {
+                // Only fails if the counter overflows, the results are picked up with the next one anyway
+                continue;
+            }
+        }
+    }
+}  // namespace scinit
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_PREFETCHER_H
+#define CINIT_PREFETCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace scinit {
+    /*
+     * Reads the executables of programs that can't start yet, their ELF interpreter and shared libraries into the
+     * page cache, so that they don't page fault their way through start up once their dependencies are satisfied.
+     *
+     * The files are read on a worker thread, which exits once all programs are warmed up. Finished programs are
+     * announced on an eventfd, the event loop then picks up the results with collect(). Files shared between
+     * programs (libc, ...) are only read once and count towards the first program using them.
+     */
+    class Prefetcher {
+      public:
+        struct Result {
+            unsigned int id = 0;
+            unsigned int files = 0;
+            uint64_t bytes = 0, duration_us = 0;
+        };
+
+        Prefetcher() = default;
+        Prefetcher(const Prefetcher&) = delete;
+        Prefetcher& operator=(const Prefetcher&) = delete;
+        ~Prefetcher();
+
+        // Start warming up the executables of the given programs (id, path), in order
+        void start(std::list<std::pair<unsigned int, std::string>> programs) noexcept(false);
+
+        // eventfd that becomes readable when results are available
+        int get_fd() const noexcept { return event_fd; }
+
+        // Results of programs that were warmed up since the last call
+        std::list<Result> collect() noexcept;
+
+        // Whether all programs have been warmed up and collected
+        bool is_done() noexcept;
+
+        // Read a single file into the page cache, returns the number of bytes or 0 on failure
+        static uint64_t warm_up(const std::string& path) noexcept;
+
+      private:
+        void run(std::list<std::pair<unsigned int, std::string>> programs) noexcept;
+
+        std::thread worker;
+        std::mutex lock;
+        std::list<Result> results;
+        std::atomic<bool> cancelled{false};
+        unsigned int pending = 0;
+        int event_fd = -1;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_PREFETCHER_H
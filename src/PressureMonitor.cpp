@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PressureMonitor.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "ChildProcessException.h"
+#include "SystemResources.h"
+#include "log.h"
+
+namespace scinit {
+    PressureMonitor::PressureMonitor(Resource resource, unsigned int stall_us, unsigned int window_us) noexcept
+      : resource(resource), stall_us(stall_us), window_us(window_us) {}
+
+    PressureMonitor::~PressureMonitor() {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void PressureMonitor::open() noexcept(false) {
+        if (fd != -1) {
+            return;
+        }
+        const char* name = resource == CPU ? "cpu" : resource == MEMORY ? "memory" : "io";
+        // Our cgroup is what we actually compete in, the system wide numbers are only a fallback
+        auto cgroup = resources::own_cgroup();
+        for (const auto& candidate : {cgroup.empty() ? std::string() : cgroup + "/" + name + ".pressure",
+                                      std::string("/proc/pressure/") + name}) {
+            if (candidate.empty()) {
+                continue;
+            }
+            fd = ::open(candidate.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            if (fd == -1) {
+                // Triggers need write access, reading the averages doesn't
+                fd = ::open(candidate.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+            if (fd != -1) {
+                path = candidate;
+                break;
+            }
+        }
+        if (fd == -1) {
+            throw ChildProcessException("Couldn't open pressure stall information, is PSI enabled?");
+        }
+
+        auto trigger = "some " + std::to_string(stall_us) + " " + std::to_string(window_us);
+        // The terminating NUL byte is part of the trigger
+        if (write(fd, trigger.c_str(), trigger.size() + 1) == -1) {
+            LOG->warn("Couldn't register PSI trigger on {0} ({1}), only sampling averages", path,
+                      std::strerror(errno));
+        } else {
+            has_trigger = true;
+        }
+    }
+
+    double PressureMonitor::read_avg10() const noexcept {
+        char buf[256] = {0};
+        if (fd == -1 || pread(fd, static_cast<char*>(buf), sizeof(buf) - 1, 0) <= 0) {
+            return 0;
+        }
+        double avg10 = 0;
+        // NOLINTNEXTLINE(cert-err34-c)
+        if (std::sscanf(static_cast<char*>(buf), "some avg10=%lf", &avg10) != 1) {
+            return 0;
+        }
+        return avg10;
+    }
+}  // namespace scinit
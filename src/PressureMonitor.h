@@ -0,0 +1,58 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_PRESSUREMONITOR_H
+#define CINIT_PRESSUREMONITOR_H
+
+#include <string>
+
+namespace scinit {
+    /*
+     * Pressure stall information (PSI) for one resource, preferably of our own cgroup and otherwise system wide.
+     * If possible, a trigger is registered on the file: the kernel then signals the fd with EPOLLPRI as soon as
+     * tasks were stalled for more than 'stall_us' within 'window_us'. The averages can be sampled independently of
+     * the trigger, which is what the event loop uses for everything that is not latency sensitive.
+     */
+    class PressureMonitor {
+      public:
+        enum Resource { CPU, MEMORY, IO };
+
+        PressureMonitor(Resource resource, unsigned int stall_us, unsigned int window_us) noexcept;
+        PressureMonitor(const PressureMonitor&) = delete;
+        PressureMonitor& operator=(const PressureMonitor&) = delete;
+        ~PressureMonitor();
+
+        // Open the pressure file and register the trigger. Throws if there is no PSI support at all.
+        void open() noexcept(false);
+
+        // File descriptor to watch for EPOLLPRI, -1 if the trigger couldn't be registered
+        int get_trigger_fd() const noexcept { return has_trigger ? fd : -1; }
+
+        // 'some' avg10 in percent (share of the last 10s in which at least one task was stalled)
+        double read_avg10() const noexcept;
+
+        std::string get_path() const noexcept { return path; }
+
+      private:
+        Resource resource;
+        unsigned int stall_us, window_us;
+        std::string path;
+        int fd = -1;
+        bool has_trigger = false;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_PRESSUREMONITOR_H
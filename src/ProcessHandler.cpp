@@ -16,21 +16,82 @@
 
 #include "ProcessHandler.h"
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <sys/signalfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <mutex>
+#include <tuple>
+#include "Cgroup.h"
 #include "ChildProcess.h"
 #include "ChildProcessException.h"
 #include "Config.h"
+#include "JsonLogWriter.h"
+#include "LogSink.h"
+#include "OutputRing.h"
+#include "OutputTarget.h"
 #include "ProcessHandlerException.h"
+#include "ProcessStats.h"
+#include "RingFile.h"
 #include "log.h"
 
 #define MAX_EVENTS 10
 #define BUF_SIZE 4096
+#define DEADLOCK_CHECK_INTERVAL_MS 5000
+#define AUTOSCALE_INTERVAL_MS 1000
+#define KIB_PER_MIB 1024
+// Buffered log file lines are written at least this often
+#define LOG_FLUSH_INTERVAL_MS 1000
+// How often the number of lines suppressed by sampling is logged
+#define SAMPLING_SUMMARY_INTERVAL_MS 10000
+// RSS growth is only judged once a process was observed for this long, so that the startup doesn't count as a leak
+#define RSS_GROWTH_WINDOW_MS (15 * 60 * 1000)
+#define MS_PER_HOUR (60.0 * 60 * 1000)
+// Consecutive samples above/below a threshold before scaling
+#define AUTOSCALE_SUSTAIN 3
+// PSI trigger: stalled for 10% of a 2s window (unprivileged triggers need windows in multiples of 2s)
+#define CPU_PRESSURE_STALL_US 200000
+#define CPU_PRESSURE_WINDOW_US 2000000
+#define MEMORY_PRESSURE_STALL_US 200000
+#define MEMORY_PRESSURE_WINDOW_US 2000000
+#define SHED_INTERVAL_MS 1000
+// Memory 'some avg10' (in %) above which programs are shed and below which they are resumed, one per decision
+#define SHED_PRESSURE_HIGH 10.0
+#define SHED_PRESSURE_LOW 2.0
+// Consecutive samples (or trigger events) before the next program is shed or resumed
+#define SHED_SUSTAIN 3
+#define RESUME_SUSTAIN 10
 
 namespace scinit {
+    namespace {
+        /*
+         * Call 'handle' with the start and length of every line in 'output'. Output of programs with 'multiline' is
+         * always a single record, which may contain newlines.
+         */
+        template <typename Handler>
+        void for_each_line(const ChildProcessInterface& program, const std::string& output, Handler handle) {
+            if (program.get_options().multiline.enabled) {
+                handle(output.data(), output.size());
+                return;
+            }
+            for (size_t begin = 0; begin <= output.size();) {
+                auto end = std::min(output.find('\n', begin), output.size());
+                handle(output.data() + begin, end - begin);
+                begin = end + 1;
+            }
+        }
+    }  // namespace
+
     void ProcessHandler::register_processes(std::list<std::weak_ptr<ChildProcessInterface>>& refs) {
         this->all_objs = refs;
         for (auto& child : all_objs) {
@@ -40,6 +101,12 @@ namespace scinit {
                 LOG->warn("Free'd child in child list!");
             }
         }
+        // Bind all sockets before anything is started, clients may then connect in any order
+        for (auto& child : all_objs) {
+            if (auto ptr = child.lock()) {
+                ptr->bind_sockets();
+            }
+        }
     }
 
     void ProcessHandler::register_for_process_state(
@@ -56,15 +123,149 @@ namespace scinit {
         obj_for_id[id] = std::move(obj);
     }
 
+    ProcessHandlerInterface::TimerId ProcessHandler::schedule_timer(uint64_t delay_ms,
+                                                                    std::function<void()> callback) {
+        return timers.schedule(monotonic_ms(), delay_ms, std::move(callback));
+    }
+
+    bool ProcessHandler::cancel_timer(TimerId id) { return timers.cancel(id); }
+
+    std::string ProcessHandler::get_notify_socket() const { return notify_socket_name; }
+
+    uint64_t ProcessHandler::monotonic_ms() noexcept {
+        struct timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000 + static_cast<uint64_t>(now.tv_nsec) / 1000000;
+    }
+
+    void ProcessHandler::run_timers() {
+        auto fired = timers.advance(monotonic_ms());
+        if (fired > 0) {
+            LOG->debug("{0} timer(s) fired", fired);
+        }
+
+        // Re-arm the timerfd for the next deadline, but only touch it if the deadline actually changed
+        uint64_t deadline = 0;
+        if (!timers.next_deadline(deadline)) {
+            deadline = 0;
+        }
+        if (deadline == armed_deadline || timer_fd == -1) {
+            return;
+        }
+        struct itimerspec spec {};
+        spec.it_value.tv_sec = static_cast<time_t>(deadline / 1000);
+        spec.it_value.tv_nsec = static_cast<long>((deadline % 1000) * 1000000);
+        if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+            LOG->critical("Couldn't arm timerfd, aborting!");
+            throw ProcessHandlerException();
+        }
+        armed_deadline = deadline;
+    }
+
+    void ProcessHandler::detect_deadlocks() {
+        /*
+         * Build the wait-for graph of all blocked processes and look for strongly connected components (Tarjan).
+         * Every component with more than one member (or a process waiting for itself) can never become runnable.
+         */
+        std::map<unsigned int, std::list<unsigned int>> edges;
+        for (const auto& pair : obj_for_id) {
+            if (auto ptr = pair.second.lock()) {
+                if (ptr->get_state() == ChildProcessInterface::ProcessState::BLOCKED) {
+                    edges[pair.first] = ptr->get_dependencies();
+                }
+            }
+        }
+
+        std::map<unsigned int, unsigned int> index, lowlink;
+        std::list<unsigned int> stack;
+        std::map<unsigned int, bool> on_stack;
+        std::list<std::list<unsigned int>> cycles;
+        unsigned int next_index = 0;
+        std::function<void(unsigned int)> connect = [&](unsigned int node) {
+            index[node] = lowlink[node] = next_index++;
+            stack.push_back(node);
+            on_stack[node] = true;
+            for (auto other : edges[node]) {
+                if (edges.count(other) == 0) {
+                    // Not blocked, so this edge can't be part of a cycle
+                    continue;
+                }
+                if (index.count(other) == 0) {
+                    connect(other);
+                    lowlink[node] = std::min(lowlink[node], lowlink[other]);
+                } else if (on_stack[other]) {
+                    lowlink[node] = std::min(lowlink[node], index[other]);
+                }
+            }
+            if (lowlink[node] == index[node]) {
+                std::list<unsigned int> component;
+                unsigned int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = false;
+                    component.push_back(member);
+                } while (member != node);
+                auto& deps = edges[node];
+                if (component.size() > 1 || std::find(deps.begin(), deps.end(), node) != deps.end()) {
+                    cycles.push_back(component);
+                }
+            }
+        };
+        for (const auto& pair : edges) {
+            if (index.count(pair.first) == 0) {
+                connect(pair.first);
+            }
+        }
+
+        for (const auto& cycle : cycles) {
+            std::string names;
+            for (auto id : cycle) {
+                if (auto ptr = obj_for_id[id].lock()) {
+                    names += (names.empty() ? "" : ", ") + ptr->get_name();
+                }
+            }
+            LOG->error("Dependency cycle detected, these programs wait for each other and can never start: {0}",
+                       names);
+            for (auto id : cycle) {
+                if (sig_for_id.count(id) > 0) {
+                    (*sig_for_id[id])(UNSATISFIABLE, 0);
+                }
+            }
+        }
+    }
+
+    void ProcessHandler::schedule_deadlock_check() {
+        schedule_timer(DEADLOCK_CHECK_INTERVAL_MS, [this]() {
+            detect_deadlocks();
+            schedule_deadlock_check();
+        });
+    }
+
     void ProcessHandler::signal_received(unsigned int signal) {
         if (signal == SIGCHLD) {
             // Already handled with waitpid
+        } else if (signal == RELOAD_SIGNAL) {
+            // Not forwarded: children are restarted group by group instead
+            LOG->info("Received SIGHUP, restarting instance groups");
+            start_rolling_restart();
+        } else if (signal == USAGE_SIGNAL) {
+            log_resource_usage();
+        } else if (signal == DUMP_SIGNAL) {
+            for (const auto& ring : crash_logs) {
+                auto ptr = obj_for_id[ring.first].lock();
+                dump_crash_log(ring.first, ptr ? ptr->get_name() : "?");
+            }
         } else {
             // Shell children sometimes do not handle SIGINT correctly when not connected to a PTY. Work around this
             // by always converting SIGINT to SIGTERM.
             if (signal == SIGINT) {
                 signal = SIGTERM;
             }
+            // Paused programs wouldn't handle the signal
+            while (!shed_programs.empty()) {
+                resume_shed_program();
+            }
             // Forward signal
             for (auto pair : id_for_pid) {
                 LOG->debug("Forwarding signal {0} to pid {1}", signal, pair.first);
@@ -82,27 +283,365 @@ namespace scinit {
     void ProcessHandler::handle_child_output(int fd, const std::string& str) {
         auto id = id_for_fd.at(fd);
         if (auto obj = obj_for_id.at(id).lock()) {
-            std::string name = obj->get_name();
             if (!fd_type.count(fd)) {
                 LOG->critical(
                   "BUG: Child (id {0}) outputted something from a file descriptor we don't know the type of!", id);
-            } else {
-                switch (fd_type[fd]) {
-                    case FDType::STDOUT:
-                        spdlog::get(name)->info(str);
-                        break;
-                    case FDType::STDERR:
-                        spdlog::get(name)->warn(str);
-                        break;
+                return;
+            }
+            auto type = fd_type[fd];
+            // The crash log gets everything, the lines before a crash are worth keeping even if they are noise
+            record_output(*obj, type, str);
+            std::string buffer;
+            auto filtered = filter_output(*obj, type, str, buffer);
+            if (filtered == nullptr) {
+                return;
+            }
+            const auto& output = *filtered;
+            const auto& options = obj->get_options();
+            auto level = type == FDType::STDOUT ? spdlog::level::info : spdlog::level::warn;
+            if (!options.detect_level) {
+                if (level >= options.min_level) {
+                    route_output(*obj, type, output, level);
                 }
+                return;
             }
+            // The lines of one read may have different levels
+            for_each_line(*obj, output, [&](const char* line, size_t length) {
+                auto line_level = level;
+                levels::detect(line, length, line_level);
+                if (line_level >= options.min_level) {
+                    route_output(*obj, type, std::string(line, length), line_level);
+                }
+            });
         } else {
             LOG->critical("BUG: Child (id {0}) outputted something but the object has already been freed!", id);
         }
     }
 
+    void ProcessHandler::route_output(const ChildProcessInterface& program, FDType type, const std::string& str,
+                                      levels::Level level) {
+        write_ring_file(program, type, str);
+        if (log_to_file(program, type, str, level) || log_to_syslog(program, type, str, level) ||
+            log_as_json(program, type, str, level)) {
+            return;
+        }
+        if (type == FDType::STDOUT || type == FDType::STDERR) {
+            spdlog::get(program.get_name())->log(level, str);
+        }
+    }
+
+    const std::string* ProcessHandler::filter_output(const ChildProcessInterface& program, FDType type,
+                                                     const std::string& str, std::string& buffer) {
+        const auto& options = program.get_options();
+        bool sampled = options.sample_every > 0 || options.max_lines_per_second > 0;
+        if ((!options.filter && !sampled) || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return &str;
+        }
+        OutputSampler* sampler = nullptr;
+        if (sampled) {
+            auto& state = output_samplers[program.get_id()];
+            if (!state) {
+                state = std::make_unique<OutputSampler>(options.sample_every, options.max_lines_per_second);
+            }
+            sampler = state.get();
+        }
+        auto now = monotonic_ms();
+        size_t kept = 0, lines = 0;
+        for_each_line(program, str, [&](const char* line, size_t length) {
+            lines++;
+            if ((options.filter && !options.filter->keep(line, length)) || (sampler && !sampler->keep(now))) {
+                return;
+            }
+            if (kept++ > 0) {
+                buffer += '\n';
+            }
+            buffer.append(line, length);
+        });
+        if (kept == 0) {
+            return nullptr;
+        }
+        return kept == lines ? &str : &buffer;
+    }
+
+    void ProcessHandler::setup_output_sampling() {
+        bool enabled = std::any_of(all_objs.begin(), all_objs.end(), [](const auto& program) {
+            auto ptr = program.lock();
+            return ptr && (ptr->get_options().sample_every > 0 || ptr->get_options().max_lines_per_second > 0);
+        });
+        if (!enabled) {
+            return;
+        }
+        schedule_timer(SAMPLING_SUMMARY_INTERVAL_MS, [this]() {
+            for (const auto& sampler : output_samplers) {
+                auto suppressed = sampler.second->take_suppressed();
+                auto ptr = obj_for_id[sampler.first].lock();
+                if (suppressed > 0 && ptr) {
+                    LOG->info("{0}: {1} line(s) of output suppressed by sampling in the last {2}s", ptr->get_name(),
+                              suppressed, SAMPLING_SUMMARY_INTERVAL_MS / 1000);
+                }
+            }
+            setup_output_sampling();
+        });
+    }
+
+    void ProcessHandler::record_output(const ChildProcessInterface& program, FDType type, const std::string& str) {
+        const auto& options = program.get_options();
+        if (options.crash_log_lines == 0 || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return;
+        }
+        auto& ring = crash_logs[program.get_id()];
+        if (!ring) {
+            ring = std::make_unique<OutputRing>(options.crash_log_lines, options.crash_log_bytes);
+        }
+        for_each_line(program, str,
+                      [&](const char* line, size_t length) { ring->add(line, length, type == FDType::STDERR); });
+    }
+
+    void ProcessHandler::write_ring_file(const ChildProcessInterface& program, FDType type, const std::string& str) {
+        const auto& options = program.get_options();
+        if (options.ring_file.empty() || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return;
+        }
+        auto ring = ring_files.find(options.ring_file);
+        if (ring == ring_files.end()) {
+            std::unique_ptr<RingFile> file;
+            try {
+                file = std::make_unique<RingFile>(options.ring_file, options.ring_size);
+            } catch (ChildProcessException& e) {
+                // Don't try again for every line
+                LOG->error("{0}", e.what());
+            }
+            ring = ring_files.emplace(options.ring_file, std::move(file)).first;
+        }
+        if (!ring->second) {
+            return;
+        }
+        struct timespec now {};
+        clock_gettime(CLOCK_REALTIME, &now);
+        auto time_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+        auto name = program.get_name();
+        auto stream = type == FDType::STDOUT ? RingFile::STDOUT : RingFile::STDERR;
+        for_each_line(program, str, [&](const char* line, size_t length) {
+            ring->second->append(name.data(), name.size(), stream, line, length, time_ns);
+        });
+    }
+
+    void ProcessHandler::dump_crash_log(unsigned int id, const std::string& name) {
+        auto ring = crash_logs.find(id);
+        if (ring == crash_logs.end() || ring->second->get_lines() == 0) {
+            return;
+        }
+        LOG->warn("Last {0} line(s) of output of {1}:\n{2}", ring->second->get_lines(), name, ring->second->dump());
+    }
+
+    void ProcessHandler::drain_output(unsigned int id) {
+        std::list<int> fds;
+        for (const auto& pair : id_for_fd) {
+            auto type = fd_type.find(pair.first);
+            if (pair.second == id && type != fd_type.end() &&
+                (type->second == FDType::STDOUT || type->second == FDType::STDERR)) {
+                fds.push_back(pair.first);
+            }
+        }
+        // The pipes are blocking, only read what is already there
+        for (auto fd : fds) {
+            int available = 0;
+            while (id_for_fd.count(fd) > 0 && ioctl(fd, FIONREAD, &available) == 0 && available > 0) {
+                event_received(fd, EPOLLIN);
+            }
+            // The end of a stack trace is what's most interesting after a crash
+            flush_framer(fd);
+        }
+    }
+
+    void ProcessHandler::setup_framers(const ChildProcessInterface& program) {
+        const auto& multiline = program.get_options().multiline;
+        if (!multiline.enabled) {
+            return;
+        }
+        for (const auto& pair : id_for_fd) {
+            auto type = fd_type.find(pair.first);
+            if (pair.second == program.get_id() && type != fd_type.end() &&
+                (type->second == FDType::STDOUT || type->second == FDType::STDERR)) {
+                framers[pair.first].framer = std::make_unique<RecordFramer>(multiline.pattern, multiline.max_bytes);
+            }
+        }
+    }
+
+    void ProcessHandler::frame_output(int fd, const char* data, size_t length) {
+        auto& framing = framers[fd];
+        framing.framer->add(data, length, [this, fd](const std::string& record) { handle_child_output(fd, record); });
+        // Records are complete once nothing was read for a while, so every read restarts the timer
+        if (framing.flush_timer != TimerWheel::INVALID_TIMER) {
+            cancel_timer(framing.flush_timer);
+            framing.flush_timer = TimerWheel::INVALID_TIMER;
+        }
+        if (!framing.framer->empty()) {
+            auto obj = obj_for_id.at(id_for_fd.at(fd)).lock();
+            auto timeout = obj ? obj->get_options().multiline.timeout_ms : 0;
+            framing.flush_timer = schedule_timer(timeout, [this, fd]() {
+                framers[fd].flush_timer = TimerWheel::INVALID_TIMER;
+                flush_framer(fd);
+            });
+        }
+    }
+
+    void ProcessHandler::flush_framer(int fd) {
+        auto framing = framers.find(fd);
+        if (framing == framers.end()) {
+            return;
+        }
+        if (framing->second.flush_timer != TimerWheel::INVALID_TIMER) {
+            cancel_timer(framing->second.flush_timer);
+            framing->second.flush_timer = TimerWheel::INVALID_TIMER;
+        }
+        framing->second.framer->flush([this, fd](const std::string& record) { handle_child_output(fd, record); });
+    }
+
+    bool ProcessHandler::log_to_file(const ChildProcessInterface& program, FDType type, const std::string& str,
+                                     levels::Level level) {
+        const auto& files = program.get_options().log_file;
+        if (!files.enabled() || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return false;
+        }
+        bool is_stdout = type == FDType::STDOUT;
+        const auto& path =
+          files.combined.empty() ? (is_stdout ? files.stdout_path : files.stderr_path) : files.combined;
+        if (path.empty()) {
+            return false;
+        }
+        auto sink = log_sinks.find(path);
+        if (sink == log_sinks.end()) {
+            FileLogSink::Rotation rotation;
+            rotation.max_bytes = files.rotate_bytes;
+            rotation.max_age_s = files.rotate_interval;
+            rotation.retain = files.retain;
+            std::shared_ptr<LogSink> file;
+            try {
+                file = std::make_shared<FileLogSink>(path, rotation);
+            } catch (ChildProcessException& e) {
+                // Don't try again for every line
+                LOG->error("{0}, logging to stdout instead", e.what());
+            }
+            sink = log_sinks.emplace(path, file).first;
+        }
+        if (!sink->second) {
+            return false;
+        }
+        if (level < files.min_level) {
+            return true;
+        }
+        // The combined file tags each line with where it came from
+        auto tag =
+          files.combined.empty() ? "" : "[" + program.get_name() + "] [" + (is_stdout ? "stdout" : "stderr") + "] ";
+        for_each_line(program, str,
+                      [&](const char* line, size_t length) { sink->second->write(tag + std::string(line, length)); });
+        return true;
+    }
+
+    bool ProcessHandler::log_to_syslog(const ChildProcessInterface& program, FDType type, const std::string& str,
+                                       levels::Level level) {
+        const auto& syslog = program.get_options().syslog;
+        if (!syslog.enabled() || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return false;
+        }
+        bool is_stdout = type == FDType::STDOUT;
+        auto name = program.get_name();
+        auto key = std::make_pair(name, is_stdout);
+        auto sink = syslog_sinks.find(key);
+        if (sink == syslog_sinks.end()) {
+            std::shared_ptr<SyslogSink> daemon;
+            try {
+                daemon = std::make_shared<SyslogSink>(syslog.socket, name, syslog.facility,
+                                                      is_stdout ? syslog.stdout_severity : syslog.stderr_severity);
+            } catch (ChildProcessException& e) {
+                LOG->error("{0}, logging to stdout instead", e.what());
+            }
+            sink = syslog_sinks.emplace(key, daemon).first;
+        }
+        if (!sink->second) {
+            return false;
+        }
+        if (level < syslog.min_level) {
+            return true;
+        }
+        if (program.get_options().detect_level) {
+            sink->second->write(str, levels::syslog_severity(level));
+            return true;
+        }
+        for_each_line(program, str,
+                      [&](const char* line, size_t length) { sink->second->write(std::string(line, length)); });
+        return true;
+    }
+
+    bool ProcessHandler::log_as_json(const ChildProcessInterface& program, FDType type, const std::string& str,
+                                     levels::Level level) {
+        if (!json_output || (type != FDType::STDOUT && type != FDType::STDERR)) {
+            return false;
+        }
+        JsonLogWriter::Record record;
+        JsonLogWriter::stamp(record);
+        auto name = program.get_name();
+        record.program = name.c_str();
+        record.instance = program.get_options().group.empty() ? -1 : static_cast<int>(program.get_options().instance);
+        record.stream = type == FDType::STDOUT ? JsonLogWriter::STDOUT : JsonLogWriter::STDERR;
+        if (program.get_options().detect_level) {
+            record.level = levels::name(level);
+        }
+        auto id = program.get_id();
+        auto pid = std::find_if(id_for_pid.begin(), id_for_pid.end(),
+                                [id](const std::pair<const int, unsigned int>& entry) { return entry.second == id; });
+        record.pid = pid == id_for_pid.end() ? 0 : pid->first;
+        for_each_line(program, str, [&](const char* line, size_t length) {
+            record.message = line;
+            record.length = length;
+            json_output->write(record);
+        });
+        json_output->flush();
+        return true;
+    }
+
+    void ProcessHandler::set_json_output(int fd) noexcept { json_output = std::make_unique<JsonLogWriter>(fd); }
+
+    void ProcessHandler::setup_log_files() {
+        bool enabled = std::any_of(all_objs.begin(), all_objs.end(), [](const auto& program) {
+            auto ptr = program.lock();
+            return ptr && (ptr->get_options().log_file.enabled() || ptr->get_options().syslog.enabled());
+        });
+        if (!enabled) {
+            return;
+        }
+        schedule_timer(LOG_FLUSH_INTERVAL_MS, [this]() {
+            auto now = time(nullptr);
+            for (const auto& sink : log_sinks) {
+                if (sink.second) {
+                    sink.second->tick(now);
+                }
+            }
+            for (const auto& sink : syslog_sinks) {
+                if (sink.second) {
+                    sink.second->tick(now);
+                }
+            }
+            setup_log_files();
+        });
+    }
+
     void ProcessHandler::event_received(int fd, unsigned int event) {
-        if (event & EPOLLIN) {
+        if (cpu_pressure && fd == cpu_pressure->get_trigger_fd()) {
+            // PSI triggers signal EPOLLPRI, there is nothing to read
+            LOG->debug("CPU pressure trigger fired");
+            autoscale(true);
+        } else if (memory_pressure && fd == memory_pressure->get_trigger_fd()) {
+            LOG->debug("Memory pressure trigger fired");
+            shed_load(memory_pressure->read_avg10(), true);
+        } else if (fd_type.count(fd) > 0 && fd_type[fd] == FDType::MEMORY_EVENTS) {
+            // cgroup files always poll readable, a change is signalled with EPOLLPRI (and EPOLLERR)
+            auto id = id_for_fd[fd];
+            if (sig_for_id.count(id) > 0) {
+                (*sig_for_id[id])(MEMORY_EVENT, 0);
+            }
+        } else if (event & EPOLLIN) {
             if (fd == signal_fd) {
                 // None of our children, this is a signal
                 struct signalfd_siginfo signal = {};
@@ -113,9 +652,31 @@ namespace scinit {
                 }
 
                 signal_received(signal.ssi_signo);
+            } else if (fd == notify_fd) {
+                notify_received();
+            } else if (prefetcher && fd == prefetcher->get_fd()) {
+                prefetch_done();
+            } else if (fd_type.count(fd) > 0 && fd_type[fd] == FDType::LISTEN) {
+                activate(id_for_fd[fd]);
+            } else if (fd_type.count(fd) > 0 &&
+                       (fd_type[fd] == FDType::PASSTHROUGH_STDOUT || fd_type[fd] == FDType::PASSTHROUGH_STDERR)) {
+                forward_output(fd);
+            } else if (fd == timer_fd) {
+                // Timers are run once per loop iteration, just acknowledge the expiration
+                uint64_t expirations = 0;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+                    LOG->critical("Couldn't read from timerfd, aborting!");
+                    throw ProcessHandlerException();
+                }
             } else {
                 char buf[BUF_SIZE + 1] = {0};
                 ssize_t nchars = read(fd, &buf, BUF_SIZE);
+                if (framers.count(fd) > 0) {
+                    if (nchars > 0) {
+                        frame_output(fd, static_cast<char*>(buf), static_cast<size_t>(nchars));
+                    }
+                    return;
+                }
                 auto str = std::string(static_cast<char*>(buf));
 
                 // Strip leading and trailing newlines
@@ -145,12 +706,15 @@ namespace scinit {
             }
         } else if (event & EPOLLHUP) {
             LOG->debug("Child process has closed control terminal (SIGHUP)!");
+            flush_framer(fd);
+            framers.erase(fd);
             struct epoll_event event_buf {};
             event_buf.data.fd = fd;
             if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &event_buf) == -1) {
                 LOG->critical("Couldn't remove child file descriptor from epoll, aborting!");
                 throw ProcessHandlerException();
             }
+            close(fd);
             // Clean up process if necessary
             auto id = id_for_fd[fd];
             id_for_fd.erase(fd);
@@ -173,32 +737,239 @@ namespace scinit {
         }
     }
 
-    void ProcessHandler::sigchld_received(int pid, int rc) {
+    void ProcessHandler::forward_output(int fd) {
+        auto program = obj_for_id[id_for_fd[fd]].lock();
+        if (!program) {
+            return;
+        }
+        const auto& options = program->get_options();
+        auto& standard = fd_type[fd] == FDType::PASSTHROUGH_STDOUT ? stdout_target : stderr_target;
+        if (!standard) {
+            standard = std::make_unique<OutputTarget>(fd_type[fd] == FDType::PASSTHROUGH_STDOUT ? STDOUT_FILENO
+                                                                                                : STDERR_FILENO,
+                                                      false);
+        }
+        OutputTarget* target = standard.get();
+        OutputTarget* mirror = nullptr;
+        if (!options.output_file.empty()) {
+            auto& file = output_files[options.output_file];
+            if (!file) {
+                try {
+                    file = OutputTarget::open_file(options.output_file);
+                } catch (ChildProcessException& e) {
+                    LOG->error("{0}, writing the output of {1} to scinit's output instead", e.what(),
+                               program->get_name());
+                    output_files.erase(options.output_file);
+                }
+            }
+            if (output_files.count(options.output_file) > 0) {
+                mirror = options.output == ProgramOptions::OUTPUT_TEE ? target : nullptr;
+                target = output_files[options.output_file].get();
+            }
+        }
+        target->forward(fd, mirror);
+    }
+
+    void ProcessHandler::activate(unsigned int id) {
+        // The program takes over its sockets, so stop watching all of them
+        for (auto it = fd_type.begin(); it != fd_type.end();) {
+            if (it->second == FDType::LISTEN && id_for_fd[it->first] == id) {
+                struct epoll_event event_buf {};
+                event_buf.data.fd = it->first;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->first, &event_buf) == -1) {
+                    LOG->critical("Couldn't remove listening socket from epoll, aborting!");
+                    throw ProcessHandlerException();
+                }
+                id_for_fd.erase(it->first);
+                it = fd_type.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        (*sig_for_id[id])(ACTIVATE, 0);
+    }
+
+    bool ProcessHandler::waiting_for_start() const {
+        bool restarting = std::any_of(all_objs.begin(), all_objs.end(), [](const auto& program) {
+            auto ptr = program.lock();
+            return ptr && ptr->get_state() == ChildProcessInterface::BACKOFF;
+        });
+        // A program stopped to shed load comes back once the memory pressure is down, even if it was the last one
+        return restarting || !shed_programs.empty() ||
+               std::any_of(fd_type.begin(), fd_type.end(), [](const std::pair<const int, FDType>& entry) {
+                   return entry.second == FDType::LISTEN;
+               });
+    }
+
+    int ProcessHandler::exit_status() const {
+        std::string failed;
+        for (const auto& pair : obj_for_id) {
+            auto ptr = pair.second.lock();
+            if (!ptr) {
+                continue;
+            }
+            // Programs killed by the signal that stops everything didn't crash on their own
+            auto state = ptr->get_state();
+            if (state == ChildProcessInterface::FAILED ||
+                (state == ChildProcessInterface::CRASHED && exited_on_quit.count(pair.first) == 0)) {
+                failed += (failed.empty() ? "" : ", ") + ptr->get_name();
+            }
+        }
+        if (failed.empty()) {
+            return 0;
+        }
+        LOG->error("Programs that failed or crashed: {0}", failed);
+        return 1;
+    }
+
+    void ProcessHandler::sigchld_received(int pid, int rc, const ResourceUsage& usage) {
+        samplers.erase(pid);
+        rss_baselines.erase(pid);
+        memory_restarts.erase(pid);
+        auto status = describe_exit_status(rc);
         if (id_for_pid.count(pid) > 0) {
             // One of ours!
             unsigned int id = id_for_pid[pid];
             if (auto ptr = obj_for_id[id].lock()) {
                 if (rc == 0) {
-                    LOG->info("Child {0} (PID {1}) exitted with RC {2}", ptr->get_name(), pid, rc);
+                    LOG->info("Child {0} (PID {1}) exitted with {2} ({3})", ptr->get_name(), pid, status,
+                              usage.describe());
                 } else {
-                    LOG->warn("Child {0} (PID {1}) exitted with RC {2}", ptr->get_name(), pid, rc);
+                    LOG->warn("Child {0} (PID {1}) exitted with {2} ({3})", ptr->get_name(), pid, status,
+                              usage.describe());
+                    // Children stopped during shutdown didn't crash
+                    if (!should_quit && ptr->get_options().crash_log_lines > 0) {
+                        // Pick up what it wrote right before exiting
+                        drain_output(id);
+                        dump_crash_log(id, ptr->get_name());
+                    }
+                }
+                if (crash_logs.count(id) > 0) {
+                    crash_logs[id]->clear();
                 }
             } else {
-                LOG->critical("BUG: Child (PID {0}) exitted with RC {1} and the object has already been freed!", pid,
-                              rc);
+                LOG->critical("BUG: Child (PID {0}) exitted with {1} and the object has already been freed!", pid,
+                              status);
             }
             number_of_running_procs--;
+            if (should_quit) {
+                exited_on_quit.insert(id);
+            } else {
+                exited_on_quit.erase(id);
+            }
             // Notify child process of exit
             (*sig_for_id[id])(EXIT, rc);
             id_for_pid.erase(pid);
         } else {
-            LOG->info("Reaped zombie (PID {0}) with RC {1}", pid, rc);
+            LOG->info("Reaped zombie (PID {0}) with {1}", pid, status);
+        }
+    }
+
+    void ProcessHandler::set_sample_interval(unsigned int seconds) noexcept { sample_interval_s = seconds; }
+
+    void ProcessHandler::setup_sampling() {
+        if (sample_interval_s == 0) {
+            return;
+        }
+        schedule_timer(sample_interval_s * 1000, [this]() {
+            sample_processes();
+            setup_sampling();
+        });
+    }
+
+    void ProcessHandler::sample_processes() {
+        auto now = monotonic_ms();
+        for (const auto& pair : id_for_pid) {
+            auto sampler = samplers.find(pair.first);
+            if (sampler == samplers.end()) {
+                try {
+                    sampler = samplers.emplace(pair.first, std::make_unique<ProcessSampler>(pair.first)).first;
+                } catch (ChildProcessException& e) {
+                    // Exited, but not reaped yet
+                    continue;
+                }
+            }
+            if (!sampler->second->sample(now)) {
+                samplers.erase(sampler);
+                continue;
+            }
+            check_memory(pair.first, sampler->second->last());
+        }
+    }
+
+    std::string ProcessHandler::memory_restart_reason(const ProgramOptions& options,
+                                                      const ProcessSampler::Sample& baseline,
+                                                      const ProcessSampler::Sample& sample) {
+        if (options.max_rss_kib > 0 && sample.rss_kib > options.max_rss_kib) {
+            return "RSS of " + std::to_string(sample.rss_kib / KIB_PER_MIB) + " MiB is above max_rss (" +
+                   std::to_string(options.max_rss_kib / KIB_PER_MIB) + " MiB)";
+        }
+        if (options.max_rss_growth_kib_per_hour == 0 || sample.at_ms < baseline.at_ms + RSS_GROWTH_WINDOW_MS ||
+            sample.rss_kib <= baseline.rss_kib) {
+            return "";
+        }
+        auto per_hour = static_cast<double>(sample.rss_kib - baseline.rss_kib) /
+                        (static_cast<double>(sample.at_ms - baseline.at_ms) / MS_PER_HOUR);
+        if (per_hour <= static_cast<double>(options.max_rss_growth_kib_per_hour)) {
+            return "";
+        }
+        return "RSS grew from " + std::to_string(baseline.rss_kib / KIB_PER_MIB) + " MiB to " +
+               std::to_string(sample.rss_kib / KIB_PER_MIB) + " MiB, " +
+               std::to_string(static_cast<unsigned long>(per_hour) / KIB_PER_MIB) +
+               " MiB per hour is above max_rss_growth_per_hour (" +
+               std::to_string(options.max_rss_growth_kib_per_hour / KIB_PER_MIB) + " MiB)";
+    }
+
+    void ProcessHandler::check_memory(int pid, const ProcessSampler::Sample& sample) {
+        auto baseline = rss_baselines.emplace(pid, sample).first->second;
+        auto ptr = obj_for_id[id_for_pid[pid]].lock();
+        if (!ptr || ptr->get_state() != ChildProcessInterface::RUNNING || memory_restarts.count(pid) > 0) {
+            return;
+        }
+        const auto& options = ptr->get_options();
+        auto reason = memory_restart_reason(options, baseline, sample);
+        if (reason.empty()) {
+            return;
+        }
+        if (!options.group.empty()) {
+            // Instances run the same code, so they most likely all leak: restart the whole group batch by batch
+            if (rolling_restarts.count(options.group) > 0) {
+                return;
+            }
+            LOG->warn("{0}: {1}, restarting instance group {2}", ptr->get_name(), reason, options.group);
+            start_rolling_restart(options.group);
+        } else {
+            LOG->warn("{0}: {1}, restarting it", ptr->get_name(), reason);
+            ptr->stop(true);
+        }
+        memory_restarts.insert(pid);
+    }
+
+    void ProcessHandler::log_resource_usage() {
+        sample_processes();
+        for (const auto& pair : samplers) {
+            auto ptr = obj_for_id[id_for_pid[pair.first]].lock();
+            const auto& sample = pair.second->last();
+            LOG->info("{0} (PID {1}): {2:.1f}% CPU, {3:.2f}s CPU time, RSS {4} MiB, {5} thread(s)",
+                      ptr ? ptr->get_name() : "?", pair.first, pair.second->cpu_percent(), sample.cpu_s,
+                      sample.rss_kib / KIB_PER_MIB, sample.threads);
         }
     }
 
     int ProcessHandler::enter_eventloop() {
         setup_signal_handlers();
+        setup_timer();
+        setup_notify_socket();
+        setup_autoscaling();
+        setup_cgroups();
+        detect_deadlocks();
+        schedule_deadlock_check();
         start_programs();
+        setup_prefetch();
+        setup_sampling();
+        setup_load_shedding();
+        setup_log_files();
+        setup_output_sampling();
 
         // Everything is set up, now we only need to wait for events
         LOG->debug("Entering main event loop");
@@ -211,8 +982,9 @@ namespace scinit {
 
             // Go look for children and zombies
             int rc, pid;
-            while ((pid = waitpid(-1, &rc, WNOHANG)) > 0) {
-                sigchld_received(pid, rc);
+            struct rusage usage {};
+            while ((pid = wait4(-1, &rc, WNOHANG, &usage)) > 0) {
+                sigchld_received(pid, rc, ResourceUsage::from_rusage(usage));
             }
 
             if (num_fds > 0) {
@@ -222,17 +994,19 @@ namespace scinit {
                     event_received(event.data.fd, event.events);
                 }
             }
+            run_timers();
 
             if (number_of_running_procs == 0 && should_quit) {
                 LOG->info("Last running process exitted and we're supposed to quit, exiting program");
-                return 0;
+                return exit_status();
             }
 
             if (!should_quit) {
+                continue_rolling_restarts();
                 start_programs();
-                if (number_of_running_procs == 0) {
+                if (number_of_running_procs == 0 && !waiting_for_start()) {
                     LOG->info("Last running process exitted and no process left to restart, exiting program");
-                    return 0;
+                    return exit_status();
                 }
             }
         }
@@ -246,6 +1020,9 @@ namespace scinit {
         sigaddset(&mask, SIGCHLD);
         sigaddset(&mask, SIGINT);
         sigaddset(&mask, SIGQUIT);
+        sigaddset(&mask, RELOAD_SIGNAL);
+        sigaddset(&mask, USAGE_SIGNAL);
+        sigaddset(&mask, DUMP_SIGNAL);
         if (sigprocmask(SIG_BLOCK, &mask, nullptr) == -1) {
             LOG->critical("Couldn't block signals from executing their default handlers, aborting!");
             throw ProcessHandlerException();
@@ -270,6 +1047,412 @@ namespace scinit {
         }
     }
 
+    void ProcessHandler::setup_timer() noexcept(false) {
+        // All timers are multiplexed onto a single timerfd which is armed for the next deadline of the timer wheel
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd == -1) {
+            LOG->critical("Couldn't create timerfd, aborting!");
+            throw ProcessHandlerException();
+        }
+        struct epoll_event setup {};
+        setup.data.fd = timer_fd;
+        setup.events = EPOLLIN;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &setup) == -1) {
+            LOG->critical("Couldn't add timerfd to epoll socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        armed_deadline = 0;
+        run_timers();
+    }
+
+    void ProcessHandler::setup_notify_socket() noexcept(false) {
+        notify_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (notify_fd == -1) {
+            LOG->critical("Couldn't create notify socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        // Binding with just the address family autobinds to a unique name in the abstract namespace
+        struct sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        socklen_t len = sizeof(sa_family_t);
+        int one = 1;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (bind(notify_fd, reinterpret_cast<struct sockaddr*>(&addr), len) == -1 ||
+            setsockopt(notify_fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof(one)) == -1) {
+            LOG->critical("Couldn't bind notify socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        len = sizeof(addr);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (getsockname(notify_fd, reinterpret_cast<struct sockaddr*>(&addr), &len) == -1) {
+            LOG->critical("Couldn't read address of notify socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        // Abstract names start with a NUL byte, which is written as '@' in NOTIFY_SOCKET
+        notify_socket_name = "@" + std::string(static_cast<char*>(addr.sun_path) + 1, len - sizeof(sa_family_t) - 1);
+
+        struct epoll_event setup {};
+        setup.data.fd = notify_fd;
+        setup.events = EPOLLIN;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, notify_fd, &setup) == -1) {
+            LOG->critical("Couldn't add notify socket to epoll socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        LOG->debug("Notify socket: {0}", notify_socket_name);
+    }
+
+    void ProcessHandler::notify_received() {
+        char buf[BUF_SIZE + 1] = {0};
+        union {
+            struct cmsghdr header;
+            char data[CMSG_SPACE(sizeof(struct ucred))];
+        } control{};
+        while (true) {
+            struct iovec iov {};
+            iov.iov_base = static_cast<char*>(buf);
+            iov.iov_len = BUF_SIZE;
+            struct msghdr msg {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = &control;
+            msg.msg_controllen = sizeof(control);
+            auto size = recvmsg(notify_fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if (size <= 0) {
+                break;
+            }
+            // The sender is identified by its credentials, which the kernel fills in for us
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_CREDENTIALS) {
+                LOG->warn("Notify message without credentials, ignoring it");
+                continue;
+            }
+            struct ucred cred {};
+            std::memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+            if (id_for_pid.count(cred.pid) == 0) {
+                LOG->debug("Notify message from unknown PID {0}, ignoring it", cred.pid);
+                continue;
+            }
+            auto id = id_for_pid[cred.pid];
+            std::string message(static_cast<char*>(buf), static_cast<size_t>(size));
+            std::string::size_type begin = 0;
+            while (begin < message.size()) {
+                auto end = message.find('\n', begin);
+                if (end == std::string::npos) {
+                    end = message.size();
+                }
+                if (message.compare(begin, end - begin, "READY=1") == 0) {
+                    (*sig_for_id[id])(NOTIFY_READY, cred.pid);
+                } else if (message.compare(begin, 14, "X_SCINIT_LOAD=") == 0) {
+                    reported_load[id] = std::strtod(message.c_str() + begin + 14, nullptr);
+                }
+                begin = end + 1;
+            }
+        }
+    }
+
+    void ProcessHandler::start_rolling_restart(const std::string& only_group) {
+        std::map<std::string, RollingRestart> restarts;
+        for (const auto& weak_program : all_objs) {
+            if (auto program = weak_program.lock()) {
+                const auto& options = program->get_options();
+                if (options.group.empty() || program->get_state() != ChildProcessInterface::RUNNING ||
+                    (!only_group.empty() && options.group != only_group)) {
+                    continue;
+                }
+                auto& restart = restarts[options.group];
+                restart.pending.push_back(program);
+                restart.batch = std::max(options.restart_batch, 1u);
+            }
+        }
+        for (auto& restart : restarts) {
+            if (rolling_restarts.count(restart.first) > 0) {
+                LOG->warn("Rolling restart of {0} is still in progress, ignoring", restart.first);
+                continue;
+            }
+            LOG->info("Rolling restart of {0}: {1} instance(s), {2} at a time", restart.first,
+                      restart.second.pending.size(), restart.second.batch);
+            rolling_restarts.emplace(restart.first, std::move(restart.second));
+        }
+        continue_rolling_restarts();
+    }
+
+    void ProcessHandler::continue_rolling_restarts() {
+        for (auto it = rolling_restarts.begin(); it != rolling_restarts.end();) {
+            auto& restart = it->second;
+            // Instances count as restarted once the new process is running (and ready, if it reports readiness)
+            for (auto flight = restart.in_flight.begin(); flight != restart.in_flight.end();) {
+                auto program = flight->first.lock();
+                if (!program) {
+                    flight = restart.in_flight.erase(flight);
+                    continue;
+                }
+                auto state = program->get_state();
+                bool restarted = program->get_start_count() > flight->second;
+                if (restarted && state == ChildProcessInterface::RUNNING) {
+                    LOG->info("{0} restarted", program->get_name());
+                    flight = restart.in_flight.erase(flight);
+                } else if (restarted && state == ChildProcessInterface::READY && program->get_options().on_demand) {
+                    // Back to waiting for connections, nothing to wait for
+                    flight = restart.in_flight.erase(flight);
+                } else if (state == ChildProcessInterface::FAILED || state == ChildProcessInterface::CRASHED ||
+                           state == ChildProcessInterface::DONE) {
+                    LOG->error("{0} didn't come back, aborting rolling restart of {1}", program->get_name(),
+                               it->first);
+                    restart.pending.clear();
+                    flight = restart.in_flight.erase(flight);
+                } else {
+                    ++flight;
+                }
+            }
+            // Stop the next batch, the remaining instances keep serving the shared sockets meanwhile
+            while (restart.in_flight.size() < restart.batch && !restart.pending.empty()) {
+                auto program = restart.pending.front().lock();
+                restart.pending.pop_front();
+                if (program && program->get_state() == ChildProcessInterface::RUNNING) {
+                    restart.in_flight.emplace_back(program, program->get_start_count());
+                    program->stop(true);
+                }
+            }
+            if (restart.pending.empty() && restart.in_flight.empty()) {
+                LOG->info("Rolling restart of {0} done", it->first);
+                it = rolling_restarts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void ProcessHandler::setup_cgroups() {
+        // Children have to be created in their own cgroups from the beginning, so this happens before any start
+        bool limits = std::any_of(all_objs.begin(), all_objs.end(), [](const auto& program) {
+            auto ptr = program.lock();
+            return ptr && ptr->get_options().has_resource_limits();
+        });
+        if (limits) {
+            Cgroup::delegate();
+        }
+    }
+
+    void ProcessHandler::setup_autoscaling() {
+        std::map<std::string, ProgramOptions> group_options;
+        for (const auto& weak_program : all_objs) {
+            if (auto program = weak_program.lock()) {
+                const auto& options = program->get_options();
+                if (options.group.empty() || options.max_instances == 0) {
+                    continue;
+                }
+                scaling_groups[options.group].instances.push_back(program);
+                group_options.emplace(options.group, options);
+            }
+        }
+        for (auto& entry : scaling_groups) {
+            auto& group = entry.second;
+            const auto& options = group_options[entry.first];
+            unsigned int active = 0;
+            for (const auto& weak_instance : group.instances) {
+                auto instance = weak_instance.lock();
+                active += instance && !instance->is_parked() ? 1 : 0;
+            }
+            group.signal = options.scale_signal;
+            group.metric_file = options.scale_metric_file;
+            group.scaler = std::make_unique<Autoscaler>(options.min_instances, options.max_instances, active,
+                                                        options.scale_up_threshold, options.scale_down_threshold,
+                                                        AUTOSCALE_SUSTAIN, options.scale_cooldown * 1000ull);
+            LOG->info("Autoscaling {0} between {1} and {2} instances, {3} running", entry.first,
+                      options.min_instances, options.max_instances, active);
+            if (group.signal == ProgramOptions::CPU_PRESSURE && !cpu_pressure) {
+                cpu_pressure = std::make_unique<PressureMonitor>(PressureMonitor::CPU, CPU_PRESSURE_STALL_US,
+                                                                 CPU_PRESSURE_WINDOW_US);
+            }
+        }
+        if (scaling_groups.empty()) {
+            return;
+        }
+        if (cpu_pressure) {
+            try {
+                cpu_pressure->open();
+            } catch (ChildProcessException& e) {
+                LOG->error("CPU pressure is not available ({0}), groups scaling on it stay at their size", e.what());
+                cpu_pressure.reset();
+            }
+        }
+        if (cpu_pressure && cpu_pressure->get_trigger_fd() != -1) {
+            struct epoll_event setup {};
+            setup.data.fd = cpu_pressure->get_trigger_fd();
+            setup.events = EPOLLPRI;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, setup.data.fd, &setup) == -1) {
+                LOG->warn("Couldn't add CPU pressure trigger to epoll socket, only sampling it");
+            }
+        }
+        schedule_autoscaling();
+    }
+
+    void ProcessHandler::setup_load_shedding() {
+        bool sheddable = std::any_of(all_objs.begin(), all_objs.end(), [](const auto& program) {
+            auto ptr = program.lock();
+            return ptr && ptr->get_options().sheddable != ProgramOptions::SHED_NEVER;
+        });
+        if (!sheddable) {
+            return;
+        }
+        memory_pressure = std::make_unique<PressureMonitor>(PressureMonitor::MEMORY, MEMORY_PRESSURE_STALL_US,
+                                                            MEMORY_PRESSURE_WINDOW_US);
+        try {
+            memory_pressure->open();
+        } catch (ChildProcessException& e) {
+            LOG->error("Memory pressure is not available ({0}), programs won't be shed", e.what());
+            memory_pressure.reset();
+            return;
+        }
+        if (memory_pressure->get_trigger_fd() != -1) {
+            struct epoll_event setup {};
+            setup.data.fd = memory_pressure->get_trigger_fd();
+            setup.events = EPOLLPRI;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, setup.data.fd, &setup) == -1) {
+                LOG->warn("Couldn't add memory pressure trigger to epoll socket, only sampling it");
+            }
+        }
+        schedule_load_shedding();
+    }
+
+    void ProcessHandler::schedule_load_shedding() {
+        schedule_timer(SHED_INTERVAL_MS, [this]() {
+            shed_load(memory_pressure->read_avg10(), false);
+            schedule_load_shedding();
+        });
+    }
+
+    void ProcessHandler::shed_load(double pressure, bool trigger_fired) {
+        if (trigger_fired || pressure >= SHED_PRESSURE_HIGH) {
+            pressure_high_samples++;
+            pressure_low_samples = 0;
+        } else if (pressure <= SHED_PRESSURE_LOW) {
+            pressure_low_samples++;
+            pressure_high_samples = 0;
+        } else {
+            pressure_high_samples = pressure_low_samples = 0;
+        }
+
+        if (pressure_low_samples >= RESUME_SUSTAIN && !shed_programs.empty()) {
+            pressure_low_samples = 0;
+            LOG->info("Memory pressure is down to {0:.1f}%", pressure);
+            resume_shed_program();
+            return;
+        }
+        if (pressure_high_samples < SHED_SUSTAIN) {
+            return;
+        }
+        pressure_high_samples = 0;
+        // One program at a time, the lowest priority first, so that no more is shed than necessary
+        std::shared_ptr<ChildProcessInterface> victim;
+        for (const auto& weak_program : all_objs) {
+            auto program = weak_program.lock();
+            if (!program || program->get_options().sheddable == ProgramOptions::SHED_NEVER ||
+                program->get_state() != ChildProcessInterface::RUNNING || program->is_paused() ||
+                program->is_parked()) {
+                continue;
+            }
+            if (!victim || program->get_options().priority < victim->get_options().priority) {
+                victim = program;
+            }
+        }
+        if (!victim) {
+            LOG->debug("Memory pressure at {0:.1f}%, but nothing left to shed", pressure);
+            return;
+        }
+        LOG->warn("Memory pressure at {0:.1f}%, {1} {2}", pressure,
+                  victim->get_options().sheddable == ProgramOptions::SHED_PAUSE ? "pausing" : "stopping",
+                  victim->get_name());
+        if (victim->get_options().sheddable == ProgramOptions::SHED_PAUSE) {
+            victim->set_paused(true);
+        } else {
+            victim->set_parked(true);
+        }
+        shed_programs.push_back(victim);
+    }
+
+    void ProcessHandler::resume_shed_program() {
+        // Last shed, first resumed: programs with a higher priority come back first
+        auto program = shed_programs.back().lock();
+        shed_programs.pop_back();
+        if (!program) {
+            return;
+        }
+        if (program->get_options().sheddable == ProgramOptions::SHED_PAUSE) {
+            program->set_paused(false);
+        } else {
+            program->set_parked(false);
+        }
+    }
+
+    void ProcessHandler::schedule_autoscaling() {
+        schedule_timer(AUTOSCALE_INTERVAL_MS, [this]() {
+            autoscale(false);
+            schedule_autoscaling();
+        });
+    }
+
+    double ProcessHandler::group_load(const ScalingGroup& group) const {
+        unsigned int running = 0;
+        double total = 0;
+        for (const auto& weak_instance : group.instances) {
+            if (auto instance = weak_instance.lock()) {
+                if (instance->get_state() == ChildProcessInterface::RUNNING) {
+                    running++;
+                    auto reported = reported_load.find(instance->get_id());
+                    total += reported == reported_load.end() ? 0 : reported->second;
+                }
+            }
+        }
+        if (group.signal == ProgramOptions::CPU_PRESSURE) {
+            return cpu_pressure ? cpu_pressure->read_avg10() : 0;
+        }
+        if (!group.metric_file.empty()) {
+            std::ifstream metric(group.metric_file);
+            if (!(metric >> total)) {
+                total = 0;
+            }
+        }
+        return total / std::max(running, 1u);
+    }
+
+    void ProcessHandler::autoscale(bool pressure_event) {
+        auto now = monotonic_ms();
+        for (auto& entry : scaling_groups) {
+            auto& group = entry.second;
+            if (group.signal == ProgramOptions::CPU_PRESSURE && !cpu_pressure) {
+                continue;
+            }
+            unsigned int instances;
+            if (pressure_event) {
+                if (group.signal != ProgramOptions::CPU_PRESSURE) {
+                    continue;
+                }
+                instances = group.scaler->urgent(now);
+            } else {
+                instances = group.scaler->update(now, group_load(group));
+            }
+            scale_group(group, instances);
+        }
+    }
+
+    void ProcessHandler::scale_group(ScalingGroup& group, unsigned int instances) {
+        // Lower instance numbers are started first and parked last
+        unsigned int active = 0;
+        for (const auto& weak_instance : group.instances) {
+            auto instance = weak_instance.lock();
+            if (!instance) {
+                continue;
+            }
+            if (active < instances) {
+                instance->set_parked(false);
+                active++;
+            } else {
+                instance->set_parked(true);
+            }
+        }
+    }
+
     void ProcessHandler::start_programs() {
         for (auto& child : all_objs) {
             if (auto ptr = child.lock()) {
@@ -279,25 +1462,172 @@ namespace scinit {
             }
         }
 
+        std::vector<std::shared_ptr<ChildProcessInterface>> runnable;
         for (const auto& weak_program : all_objs) {
             if (auto program = weak_program.lock()) {
                 if (!program->can_start_now()) {
+                    try {
+                        program->wait_for_activation(epoll_fd, id_for_fd, fd_type);
+                    } catch (ChildProcessException& e) {
+                        LOG->critical("Couldn't wait for activation: {0}", e.what());
+                    }
                     continue;
                 }
-                try {
-                    // Register logger
-                    auto console = spdlog::stdout_color_st(program->get_name());
+                runnable.push_back(program);
+            } else {
+                LOG->warn("Free'd child in child list!");
+            }
+        }
+        if (max_parallel_starts > 0) {
+            schedule_starts(runnable);
+        }
+
+        for (const auto& program : runnable) {
+            try {
+                // Register logger, programs which are restarted already have one
+                auto name = program->get_name();
+                if (!spdlog::get(name)) {
+                    auto console = spdlog::stdout_color_st(name);
                     console->set_pattern("[%^%n%$] [%H:%M:%S.%e] %v");
+                    // Detected debug lines are only shown with --verbose
+                    console->set_level(LOG->level());
+                }
 
-                    // Start program
-                    LOG->info("Starting: {0}", program->get_name());
-                    program->do_fork(id_for_pid);
-                    program->register_with_epoll(epoll_fd, id_for_fd, fd_type);
-                    num_fd_for_id[program->get_id()] = 2;
-                    number_of_running_procs++;
-                } catch (std::exception& e) { LOG->critical("Couldn't start program: {0}", e.what()); }
+                // Start program
+                LOG->info("Starting: {0}", program->get_name());
+                program->do_fork(id_for_pid);
+                program->register_with_epoll(epoll_fd, id_for_fd, fd_type);
+                setup_framers(*program);
+                num_fd_for_id[program->get_id()] = 2;
+                number_of_running_procs++;
+            } catch (ChildProcessException& e) {
+                LOG->critical("Couldn't start program: {0}", e.what());
+            } catch (std::exception& e) { LOG->critical("Couldn't start program: {0}", e.what()); }
+        }
+    }
+
+    void ProcessHandler::set_max_parallel_starts(unsigned int max) noexcept { max_parallel_starts = max; }
+
+    void ProcessHandler::set_prefetch(bool enabled) noexcept { prefetch = enabled; }
+
+    void ProcessHandler::setup_prefetch() {
+        if (!prefetch) {
+            return;
+        }
+        // Everything that could start has been started already, only warm up programs that are still waiting
+        std::list<std::pair<unsigned int, std::string>> waiting;
+        for (const auto& weak_program : all_objs) {
+            if (auto program = weak_program.lock()) {
+                auto state = program->get_state();
+                if (state == ChildProcessInterface::BLOCKED ||
+                    (state == ChildProcessInterface::READY && !program->can_start_now())) {
+                    waiting.emplace_back(program->get_id(), program->get_path());
+                }
+            }
+        }
+        if (waiting.empty()) {
+            return;
+        }
+        try {
+            prefetcher = std::make_unique<Prefetcher>();
+            prefetcher->start(waiting);
+        } catch (ChildProcessException& e) {
+            LOG->warn("Couldn't start prefetching: {0}", e.what());
+            prefetcher.reset();
+            return;
+        }
+        struct epoll_event setup {};
+        setup.data.fd = prefetcher->get_fd();
+        setup.events = EPOLLIN;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, prefetcher->get_fd(), &setup) == -1) {
+            LOG->critical("Couldn't add prefetch eventfd to epoll socket, aborting!");
+            throw ProcessHandlerException();
+        }
+        LOG->debug("Warming up {0} program(s)", waiting.size());
+    }
+
+    void ProcessHandler::prefetch_done() {
+        for (const auto& result : prefetcher->collect()) {
+            auto program = obj_for_id[result.id].lock();
+            if (!program) {
+                continue;
+            }
+            // Warm-up that finished too late didn't help, that is worth knowing when looking at start times
+            auto state = program->get_state();
+            bool late = state != ChildProcessInterface::BLOCKED && state != ChildProcessInterface::READY;
+            LOG->info("Warm-up of {0}: {1} file(s), {2} KiB in {3:.1f} ms{4}", program->get_name(), result.files,
+                      result.bytes / 1024, static_cast<double>(result.duration_us) / 1000.0,
+                      late ? " (finished after the start)" : "");
+        }
+        if (prefetcher->is_done()) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, prefetcher->get_fd(), nullptr);
+            prefetcher.reset();
+        }
+    }
+
+    void ProcessHandler::schedule_starts(std::vector<std::shared_ptr<ChildProcessInterface>>& runnable) {
+        // Forked, but not ready yet
+        unsigned int starting = 0;
+        std::map<unsigned int, std::list<unsigned int>> dependents;
+        for (const auto& weak_program : all_objs) {
+            if (auto program = weak_program.lock()) {
+                auto state = program->get_state();
+                if (state == ChildProcessInterface::STARTING) {
+                    starting++;
+                } else if (state == ChildProcessInterface::BLOCKED) {
+                    for (auto dependency : program->get_dependencies()) {
+                        dependents[dependency].push_back(program->get_id());
+                    }
+                }
+            }
+        }
+        if (starting >= max_parallel_starts) {
+            if (!runnable.empty()) {
+                LOG->debug("{0} program(s) starting, deferring {1} more", starting, runnable.size());
+            }
+            runnable.clear();
+            return;
+        }
+        auto budget = max_parallel_starts - starting;
+        if (runnable.size() <= budget) {
+            return;
+        }
+
+        /*
+         * Length of the longest chain of programs waiting for this one, directly or transitively. Starting the head
+         * of a long chain first gets everything up sooner than starting a program nobody waits for.
+         */
+        std::map<unsigned int, unsigned int> chain;
+        std::function<unsigned int(unsigned int)> chain_length = [&](unsigned int id) -> unsigned int {
+            auto known = chain.find(id);
+            if (known != chain.end()) {
+                return known->second;
+            }
+            // Guards against cycles, those are reported by the deadlock detection
+            chain[id] = 0;
+            unsigned int longest = 0;
+            for (auto dependent : dependents[id]) {
+                longest = std::max(longest, chain_length(dependent) + 1);
+            }
+            chain[id] = longest;
+            return longest;
+        };
+        std::vector<std::tuple<int, unsigned int, std::shared_ptr<ChildProcessInterface>>> order;
+        for (const auto& program : runnable) {
+            order.emplace_back(program->get_options().priority, chain_length(program->get_id()), program);
+        }
+        std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+            if (std::get<0>(a) != std::get<0>(b)) {
+                return std::get<0>(a) > std::get<0>(b);
+            }
+            return std::get<1>(a) > std::get<1>(b);
+        });
+        runnable.clear();
+        for (const auto& entry : order) {
+            if (runnable.size() < budget) {
+                runnable.push_back(std::get<2>(entry));
             } else {
-                LOG->warn("Free'd child in child list!");
+                LOG->debug("Deferring start of {0}, too many programs starting", std::get<2>(entry)->get_name());
             }
         }
     }
@@ -18,7 +18,23 @@
 #define CINIT_PROCESSHANDLER_H
 
 #include "gtest/gtest_prod.h"
+#include <set>
+#include <string>
+#include "Autoscaler.h"
+#include "JsonLogWriter.h"
+#include "LogLevels.h"
+#include "LogSink.h"
+#include "OutputFilter.h"
+#include "OutputRing.h"
+#include "RecordFramer.h"
+#include "RingFile.h"
+#include "OutputTarget.h"
+#include "Prefetcher.h"
+#include "PressureMonitor.h"
 #include "ProcessHandlerInterface.h"
+#include "ProcessStats.h"
+#include "ProgramOptions.h"
+#include "TimerWheel.h"
 
 namespace scinit {
     // See base class for documentation
@@ -34,22 +50,119 @@ namespace scinit {
           int id, std::function<void(ProcessHandlerInterface::ProcessEvent, int)> handler) override;
         void register_obj_id(int, std::weak_ptr<ChildProcessInterface>) override;
         int enter_eventloop() override;
+        TimerId schedule_timer(uint64_t delay_ms, std::function<void()> callback) override;
+        bool cancel_timer(TimerId id) override;
+        std::string get_notify_socket() const override;
+
+        // Limit the number of programs starting (forked, but not ready yet) at once, 0 means no limit
+        void set_max_parallel_starts(unsigned int max) noexcept;
+
+        // Warm up the page cache for programs that are waiting for their dependencies
+        void set_prefetch(bool enabled) noexcept;
+
+        // Sample CPU time and memory of running programs every 'seconds', 0 disables sampling
+        void set_sample_interval(unsigned int seconds) noexcept;
+
+        // Write program output to 'fd' as one JSON object per line (--log-format=json) instead of logging it
+        void set_json_output(int fd) noexcept;
+
+        /*
+         * Why a process has to be restarted according to max_rss and max_rss_growth_per_hour, given the sample its
+         * growth is measured from and the current one. Empty if it may keep running.
+         */
+        static std::string memory_restart_reason(const ProgramOptions& options,
+                                                 const ProcessSampler::Sample& baseline,
+                                                 const ProcessSampler::Sample& sample);
+
+        // Current value of CLOCK_MONOTONIC in ms, this is the clock used for all timers
+        static uint64_t monotonic_ms() noexcept;
 
       private:
         void setup_signal_handlers();
+        void setup_timer();
+        void setup_notify_socket();
+        void notify_received();
+        void start_rolling_restart(const std::string& only_group = "");
+        void continue_rolling_restarts();
+        void setup_cgroups();
+        void setup_autoscaling();
+        void schedule_autoscaling();
+        void autoscale(bool pressure_event);
+        void setup_prefetch();
+        void prefetch_done();
+        void schedule_starts(std::vector<std::shared_ptr<ChildProcessInterface>>& runnable);
+        void run_timers();
+        void detect_deadlocks();
+        void schedule_deadlock_check();
         void event_received(int fd, unsigned int event);
-        void sigchld_received(int pid, int rc);
+        void sigchld_received(int pid, int rc, const ResourceUsage& usage = ResourceUsage());
+        void setup_sampling();
+        void sample_processes();
+        void log_resource_usage();
+        void check_memory(int pid, const ProcessSampler::Sample& sample);
+        void setup_load_shedding();
+        void schedule_load_shedding();
+        void shed_load(double pressure, bool trigger_fired);
+        void resume_shed_program();
+        void activate(unsigned int id);
+        void forward_output(int fd);
+        // Read path of programs with 'multiline': pass what was read through the fd's framer, flush it after a pause
+        void setup_framers(const ChildProcessInterface& program);
+        void frame_output(int fd, const char* data, size_t length);
+        void flush_framer(int fd);
+        // Send (filtered) output with its level to the first destination that takes it
+        void route_output(const ChildProcessInterface& program, FDType type, const std::string& str,
+                          levels::Level level);
+        // Write output to the program's log file, false if it doesn't have one for this stream
+        bool log_to_file(const ChildProcessInterface& program, FDType type, const std::string& str,
+                         levels::Level level);
+        // Send output to syslog, false if the program doesn't use syslog
+        bool log_to_syslog(const ChildProcessInterface& program, FDType type, const std::string& str,
+                           levels::Level level);
+        // Write output as JSON lines, false if --log-format isn't json
+        bool log_as_json(const ChildProcessInterface& program, FDType type, const std::string& str,
+                         levels::Level level);
+        /*
+         * Apply the program's filter rules and sampling. Returns null if all lines were dropped, 'str' if none were
+         * and otherwise 'buffer', which then contains the remaining lines.
+         */
+        const std::string* filter_output(const ChildProcessInterface& program, FDType type, const std::string& str,
+                                         std::string& buffer);
+        void setup_output_sampling();
+        // Keep the output in the program's crash log, if it has one
+        void record_output(const ChildProcessInterface& program, FDType type, const std::string& str);
+        void dump_crash_log(unsigned int id, const std::string& name);
+        // Append the output to the program's ring file, if it has one
+        void write_ring_file(const ChildProcessInterface& program, FDType type, const std::string& str);
+        // Handle output that is still buffered in the pipes of a process
+        void drain_output(unsigned int id);
+        void setup_log_files();
+        // On-demand programs wait for a connection or programs wait to be restarted after a crash
+        bool waiting_for_start() const;
+        // 1 if a program failed or crashed (other than while stopping everything), 0 otherwise
+        int exit_status() const;
 
         FRIEND_TEST(ProcessHandlerTests, TestOneRunnableChild);
         FRIEND_TEST(ProcessHandlerTests, TestOneChildLifecycle);
+        FRIEND_TEST(ProcessHandlerTests, LeakingProcessIsRestartedOnce);
+        FRIEND_TEST(ProcessHandlerTests, MemoryPressureShedsByPriority);
+        FRIEND_TEST(ProcessHandlerTests, SheddingTheLastProgramKeepsRunning);
         FRIEND_TEST(ProcessLifecycleTests, SingleProcessLifecycle);
         FRIEND_TEST(ProcessLifecycleTests, TwoDependantOneshotProcessesLifecycle);
         FRIEND_TEST(ProcessLifecycleTests, TwoDependantSimpleProcessesLifecycle);
+        FRIEND_TEST(ProcessLifecycleTests, RequiredDependencyFailurePropagates);
+        FRIEND_TEST(ProcessLifecycleTests, DependencyCycleIsDetected);
+        FRIEND_TEST(ProcessLifecycleTests, NotifyReadyGatesDependants);
+        FRIEND_TEST(ProcessLifecycleTests, RollingRestartInBatches);
+        FRIEND_TEST(ProcessLifecycleTests, AutoscalingParksAndUnparksInstances);
+        FRIEND_TEST(ProcessLifecycleTests, ParallelStartsPreferPriorityAndCriticalPath);
+        FRIEND_TEST(ProcessLifecycleTests, CrashedProcessIsRestartedWithBackoff);
         FRIEND_TEST(IntegrationTests, TestStdOutErr);
         FRIEND_TEST(IntegrationTests, TestPty);
         FRIEND_TEST(IntegrationTests, TestPrivDrop);
         FRIEND_TEST(IntegrationTests, TestEnvFilter);
         FRIEND_TEST(IntegrationTests, TestComplexEnv);
+        FRIEND_TEST(IntegrationTests, TestSignalMask);
 
       protected:
         virtual void handle_child_output(int, const std::string&);
@@ -63,8 +176,75 @@ namespace scinit {
         std::map<unsigned int, unsigned int> num_fd_for_id;
         std::map<int, ProcessHandlerInterface::FDType> fd_type;
         std::list<std::weak_ptr<ChildProcessInterface>> all_objs;
-        int epoll_fd = -1, signal_fd = -1, number_of_running_procs = 0;
+        int epoll_fd = -1, signal_fd = -1, timer_fd = -1, number_of_running_procs = 0;
         bool should_quit = false;
+        unsigned int max_parallel_starts = 0;
+        bool prefetch = false;
+        std::unique_ptr<Prefetcher> prefetcher;
+        unsigned int sample_interval_s = 10;
+        // Samplers of running processes by pid
+        std::map<int, std::unique_ptr<ProcessSampler>> samplers;
+        // First sample of each process, RSS growth is measured from there
+        std::map<int, ProcessSampler::Sample> rss_baselines;
+        // Processes that are being restarted because of their memory usage
+        std::set<int> memory_restarts;
+        // Programs whose last exit happened while scinit was stopping everything
+        std::set<unsigned int> exited_on_quit;
+        TimerWheel timers{monotonic_ms()};
+        uint64_t armed_deadline = 0;
+        // Datagram socket for sd_notify style readiness reports, in the abstract namespace
+        int notify_fd = -1;
+        std::string notify_socket_name;
+
+        /*
+         * A rolling restart of an instance group: instances that still have to be restarted and the ones that are
+         * currently restarting, together with their start count before the restart
+         */
+        struct RollingRestart {
+            std::list<std::weak_ptr<ChildProcessInterface>> pending;
+            std::list<std::pair<std::weak_ptr<ChildProcessInterface>, unsigned int>> in_flight;
+            unsigned int batch = 1;
+        };
+        std::map<std::string, RollingRestart> rolling_restarts;
+
+        // An autoscaled instance group, instances are ordered by their instance number
+        struct ScalingGroup {
+            std::vector<std::weak_ptr<ChildProcessInterface>> instances;
+            std::unique_ptr<Autoscaler> scaler;
+            ProgramOptions::ScaleSignal signal = ProgramOptions::CPU_PRESSURE;
+            std::string metric_file;
+        };
+        std::map<std::string, ScalingGroup> scaling_groups;
+        std::unique_ptr<PressureMonitor> cpu_pressure;
+        // Destinations of 'output: passthrough' and 'output: tee', files by path
+        std::unique_ptr<OutputTarget> stdout_target, stderr_target;
+        std::map<std::string, std::unique_ptr<OutputTarget>> output_files;
+        // Per-program log files by path, null if the file couldn't be opened
+        std::map<std::string, std::shared_ptr<LogSink>> log_sinks;
+        // Syslog connections by process name and stream (true for stdout), null if there is no socket
+        std::map<std::pair<std::string, bool>, std::shared_ptr<SyslogSink>> syslog_sinks;
+        // Framing buffers of the output pipes of programs with 'multiline', by fd, and the timer that flushes them
+        struct Framing {
+            std::unique_ptr<RecordFramer> framer;
+            TimerId flush_timer = TimerWheel::INVALID_TIMER;
+        };
+        std::map<int, Framing> framers;
+        // Sampling state of programs with sample_every or max_lines_per_second, by process id
+        std::map<unsigned int, std::unique_ptr<OutputSampler>> output_samplers;
+        // Recent output of programs with crash_log_lines, by process id
+        std::map<unsigned int, std::unique_ptr<OutputRing>> crash_logs;
+        // Ring files by path, null if the file couldn't be opened
+        std::map<std::string, std::unique_ptr<RingFile>> ring_files;
+        // Set with --log-format=json
+        std::unique_ptr<JsonLogWriter> json_output;
+        // Load shedding: programs paused or stopped under memory pressure in the order they were shed
+        std::unique_ptr<PressureMonitor> memory_pressure;
+        std::vector<std::weak_ptr<ChildProcessInterface>> shed_programs;
+        unsigned int pressure_high_samples = 0, pressure_low_samples = 0;
+        // Last X_SCINIT_LOAD= reported by each process
+        std::map<unsigned int, double> reported_load;
+        void scale_group(ScalingGroup& group, unsigned int instances);
+        double group_load(const ScalingGroup& group) const;
     };
 }  // namespace scinit
 
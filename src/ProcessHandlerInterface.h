@@ -18,20 +18,31 @@
 #define CINIT_PROCESSHANDLERINTERFACE_H
 
 #include <boost/signals2.hpp>
+#include <csignal>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace scinit {
     class ChildProcessInterface;
 
     class ProcessHandlerInterface {
       public:
+        // The enum below shadows SIGHUP, keep the signal number for the reload handler
+        static constexpr int RELOAD_SIGNAL = SIGHUP;
+        // Log the resource usage of all running programs
+        static constexpr int USAGE_SIGNAL = SIGUSR2;
+        // Log the recent output (crash_log_lines) of all programs
+        static constexpr int DUMP_SIGNAL = SIGUSR1;
 // Somebody defines SIGHUP, so let's remove that for the enum
 #define TMP_SIGHUP SIGHUP
 #undef SIGHUP
         /*
-         * Event notifier reasons: SIGHUP received or process exitted
+         * Event notifier reasons: SIGHUP received, process exitted, process can never be started because it is
+         * part of a dependency cycle, a connection arrived on a socket of an on-demand process, the process
+         * reported readiness on the notify socket or the memory.events file of its cgroup changed
          */
-        enum ProcessEvent { SIGHUP, EXIT };
+        enum ProcessEvent { SIGHUP, EXIT, UNSATISFIABLE, ACTIVATE, NOTIFY_READY, MEMORY_EVENT };
 #define SIGHUP TMP_SIGHUP
         ProcessHandlerInterface() = default;
         virtual ~ProcessHandlerInterface() = default;
@@ -61,9 +72,30 @@ namespace scinit {
         virtual int enter_eventloop() = 0;
 
         /*
-         * Type of file descriptors that are registered by child processes
+         * Timers. The callback is executed from within the event loop once 'delay_ms' have passed. Timers that
+         * expire close to each other are coalesced, so the callback might run a few ms late, but never early.
          */
-        enum FDType { STDOUT, STDERR };
+        using TimerId = uint64_t;
+        virtual TimerId schedule_timer(uint64_t delay_ms, std::function<void()> callback) = 0;
+
+        /*
+         * Cancel a timer that has not fired yet. Returns false if the timer is unknown or has already fired.
+         */
+        virtual bool cancel_timer(TimerId id) = 0;
+
+        /*
+         * Value for NOTIFY_SOCKET in the environment of processes that report readiness, empty if there is no
+         * notify socket
+         */
+        virtual std::string get_notify_socket() const = 0;
+
+        /*
+         * Type of file descriptors that are registered by child processes. LISTEN is a listening socket of an
+         * on-demand process that is waiting for its first connection, MEMORY_EVENTS is the memory.events file of
+         * the process' cgroup, which signals changes with EPOLLPRI. The output of programs that don't want their output
+         * logged is registered as PASSTHROUGH_STDOUT and PASSTHROUGH_STDERR.
+         */
+        enum FDType { STDOUT, STDERR, LISTEN, MEMORY_EVENTS, PASSTHROUGH_STDOUT, PASSTHROUGH_STDERR };
     };
 }  // namespace scinit
 
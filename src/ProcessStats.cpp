@@ -0,0 +1,178 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProcessStats.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include "ChildProcessException.h"
+
+// Large enough for /proc/<pid>/stat, even with a long comm
+#define STAT_BUF_SIZE 1024
+// Fields of /proc/<pid>/stat after the comm, counted from 'state' (field 3)
+#define STAT_UTIME 11
+#define STAT_STIME 12
+#define STAT_THREADS 17
+
+namespace scinit {
+    ResourceUsage ResourceUsage::from_rusage(const struct rusage& usage) noexcept {
+        ResourceUsage result;
+        result.user_s = static_cast<double>(usage.ru_utime.tv_sec) + static_cast<double>(usage.ru_utime.tv_usec) / 1e6;
+        result.system_s =
+          static_cast<double>(usage.ru_stime.tv_sec) + static_cast<double>(usage.ru_stime.tv_usec) / 1e6;
+        // ru_maxrss is in KiB on Linux
+        result.max_rss_kib = usage.ru_maxrss;
+        result.voluntary_switches = usage.ru_nvcsw;
+        result.involuntary_switches = usage.ru_nivcsw;
+        return result;
+    }
+
+    std::string ResourceUsage::describe() const {
+        char buf[160];
+        snprintf(static_cast<char*>(buf), sizeof(buf),
+                 "%.2fs user, %.2fs system, max RSS %ld KiB, %ld voluntary / %ld involuntary context switches", user_s,
+                 system_s, max_rss_kib, voluntary_switches, involuntary_switches);
+        return std::string(static_cast<char*>(buf));
+    }
+
+    std::string describe_exit_status(int status) {
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        if (WIFEXITED(status)) {
+            // NOLINTNEXTLINE(hicpp-signed-bitwise)
+            return "exit code " + std::to_string(WEXITSTATUS(status));
+        }
+        // NOLINTNEXTLINE(hicpp-signed-bitwise)
+        if (WIFSIGNALED(status)) {
+            // NOLINTNEXTLINE(hicpp-signed-bitwise)
+            auto signal = WTERMSIG(status);
+            auto description = "signal " + std::to_string(signal) + " (" + strsignal(signal) + ")";
+            // NOLINTNEXTLINE(hicpp-signed-bitwise)
+            if (WCOREDUMP(status)) {
+                description += ", core dumped";
+            }
+            return description;
+        }
+        return "status " + std::to_string(status);
+    }
+
+    ProcessSampler::ProcessSampler(int pid) noexcept(false) {
+        auto dir = "/proc/" + std::to_string(pid);
+        stat_fd = open((dir + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+        statm_fd = open((dir + "/statm").c_str(), O_RDONLY | O_CLOEXEC);
+        if (stat_fd == -1 || statm_fd == -1) {
+            if (stat_fd != -1) {
+                close(stat_fd);
+            }
+            if (statm_fd != -1) {
+                close(statm_fd);
+            }
+            throw ChildProcessException(("Couldn't open " + dir + ": " + std::strerror(errno)).c_str());
+        }
+    }
+
+    ProcessSampler::~ProcessSampler() {
+        close(stat_fd);
+        close(statm_fd);
+    }
+
+    bool ProcessSampler::parse_stat(const char* stat, double& cpu_s, unsigned int& threads) noexcept {
+        // The comm may contain spaces and parentheses, everything else starts after the last ')'
+        const char* pos = std::strrchr(stat, ')');
+        if (pos == nullptr || pos[1] != ' ') {
+            return false;
+        }
+        pos += 2;
+        static const auto ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+        unsigned long long utime = 0, stime = 0;
+        for (int field = 0; field <= STAT_THREADS; field++) {
+            if (*pos == '\0') {
+                return false;
+            }
+            char* end = nullptr;
+            auto value = std::strtoull(pos, &end, 10);
+            if (field == STAT_UTIME) {
+                utime = value;
+            } else if (field == STAT_STIME) {
+                stime = value;
+            } else if (field == STAT_THREADS) {
+                threads = static_cast<unsigned int>(value);
+            }
+            // The first field is the state, a letter
+            if (end == pos && field > 0) {
+                return false;
+            }
+            pos = std::strchr(end, ' ');
+            if (pos == nullptr) {
+                if (field == STAT_THREADS) {
+                    break;
+                }
+                return false;
+            }
+            pos++;
+        }
+        cpu_s = static_cast<double>(utime + stime) / ticks;
+        return true;
+    }
+
+    bool ProcessSampler::parse_statm(const char* statm, unsigned long& rss_pages) noexcept {
+        // size resident shared text lib data dt, in pages
+        char* end = nullptr;
+        std::strtoul(statm, &end, 10);
+        if (end == statm || *end != ' ') {
+            return false;
+        }
+        const char* resident = end + 1;
+        rss_pages = std::strtoul(resident, &end, 10);
+        return end != resident;
+    }
+
+    bool ProcessSampler::sample(uint64_t now_ms) noexcept {
+        char buf[STAT_BUF_SIZE];
+        auto size = pread(stat_fd, static_cast<char*>(buf), sizeof(buf) - 1, 0);
+        if (size <= 0) {
+            return false;
+        }
+        buf[size] = '\0';
+        Sample next;
+        next.at_ms = now_ms;
+        if (!parse_stat(static_cast<char*>(buf), next.cpu_s, next.threads)) {
+            return false;
+        }
+        size = pread(statm_fd, static_cast<char*>(buf), sizeof(buf) - 1, 0);
+        if (size <= 0) {
+            return false;
+        }
+        buf[size] = '\0';
+        unsigned long pages = 0;
+        if (!parse_statm(static_cast<char*>(buf), pages)) {
+            return false;
+        }
+        static const auto page_kib = static_cast<unsigned long>(sysconf(_SC_PAGESIZE)) / 1024;
+        next.rss_kib = pages * page_kib;
+        previous = current;
+        current = next;
+        return true;
+    }
+
+    double ProcessSampler::cpu_percent() const noexcept {
+        if (previous.at_ms == 0 || current.at_ms <= previous.at_ms) {
+            return 0;
+        }
+        return (current.cpu_s - previous.cpu_s) * 100000 / static_cast<double>(current.at_ms - previous.at_ms);
+    }
+}  // namespace scinit
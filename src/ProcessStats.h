@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_PROCESSSTATS_H
+#define CINIT_PROCESSSTATS_H
+
+#include <sys/resource.h>
+#include <cstdint>
+#include <string>
+
+namespace scinit {
+    // What the kernel accounted for a process once it was reaped (wait4)
+    struct ResourceUsage {
+        double user_s = 0, system_s = 0;
+        // Peak resident set size
+        long max_rss_kib = 0;
+        long voluntary_switches = 0, involuntary_switches = 0;
+
+        static ResourceUsage from_rusage(const struct rusage& usage) noexcept;
+        std::string describe() const;
+    };
+
+    // Decode a wait status: "exit code 1", "signal 9 (Killed)", "signal 11 (Segmentation fault), core dumped"
+    std::string describe_exit_status(int status);
+
+    /*
+     * Samples a running process from /proc/<pid>/stat and /proc/<pid>/statm. Both files are opened once and read
+     * with pread on every sample, which is a lot cheaper than opening them again (no path lookup in procfs). The
+     * fds refer to the process, not the pid, so a sample of a process that is gone fails instead of silently
+     * reading a recycled pid.
+     */
+    class ProcessSampler {
+      public:
+        struct Sample {
+            uint64_t at_ms = 0;
+            // User and system time
+            double cpu_s = 0;
+            unsigned long rss_kib = 0;
+            unsigned int threads = 0;
+        };
+
+        // Throws a ChildProcessException if the process doesn't exist
+        explicit ProcessSampler(int pid) noexcept(false);
+        ProcessSampler(const ProcessSampler&) = delete;
+        ProcessSampler& operator=(const ProcessSampler&) = delete;
+        ~ProcessSampler();
+
+        // Take a sample, false if the process is gone
+        bool sample(uint64_t now_ms) noexcept;
+
+        const Sample& last() const noexcept { return current; }
+        // CPU usage between the last two samples, in percent of one CPU
+        double cpu_percent() const noexcept;
+
+        // Parse the contents of a stat/statm file, exposed for tests
+        static bool parse_stat(const char* stat, double& cpu_s, unsigned int& threads) noexcept;
+        static bool parse_statm(const char* statm, unsigned long& rss_pages) noexcept;
+
+      private:
+        int stat_fd = -1, statm_fd = -1;
+        Sample previous, current;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_PROCESSSTATS_H
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_PROGRAMOPTIONS_H
+#define CINIT_PROGRAMOPTIONS_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <regex>
+#include <string>
+#include "ListenSocket.h"
+#include "LogLevels.h"
+#include "OutputFilter.h"
+#include "Scheduling.h"
+#include "Zygote.h"
+
+namespace scinit {
+    /*
+     * Optional per-program settings. Config fills this in once per program entry and ChildProcess only reads it.
+     * Durations are in seconds, a value of 0 disables the respective feature.
+     */
+    struct ProgramOptions {
+        // Time a program may spend in BLOCKED/READY before it is declared failed
+        unsigned int start_timeout = 0;
+
+        // Like 'after', but if one of these programs fails, this program fails as well
+        std::list<std::string> required;
+
+        // Sockets bound by scinit and passed to the program starting at fd 3 (LISTEN_FDS protocol)
+        std::list<std::shared_ptr<ListenSocket>> sockets;
+
+        // Don't start the program before the first connection arrives on one of its sockets
+        bool on_demand = false;
+
+        // Stop an on-demand program once it had no connections for this long
+        unsigned int idle_timeout = 0;
+
+        // Time between SIGTERM and SIGKILL when stopping a program
+        unsigned int stop_timeout = 10;
+
+        // Program entry this is an instance of (empty for single instance programs) and its index in there
+        std::string group;
+        unsigned int instance = 0;
+
+        // Only count as running after READY=1 arrived on the notify socket
+        bool notify_ready = false;
+
+        // Number of instances that are restarted at once during a rolling restart
+        unsigned int restart_batch = 1;
+
+        // Autoscaling keeps between min_instances and max_instances of the group running, 0 disables it
+        unsigned int min_instances = 0, max_instances = 0;
+        // Created for autoscaling, but not started before the group is scaled up
+        bool start_parked = false;
+        // Load signal: 'some' CPU pressure (avg10, in %) or a number reported by the program, per running instance
+        enum ScaleSignal { CPU_PRESSURE, METRIC };
+        ScaleSignal scale_signal = CPU_PRESSURE;
+        double scale_up_threshold = 20, scale_down_threshold = 5;
+        unsigned int scale_cooldown = 30;
+        // File containing the load of the whole group. If empty, instances report X_SCINIT_LOAD= via notify.
+        std::string scale_metric_file;
+
+        // Programs with a higher priority are started first when starts are limited (--max-parallel-starts)
+        int priority = 0;
+
+        // cgroup v2 limits, values are written as given (memory sizes may use K, M and G), empty/0 means unlimited
+        std::string memory_max, memory_high;
+        unsigned int cpu_weight = 0, io_weight = 0, pids_max = 0;
+        // Number of CPUs the program may use, fractions are allowed
+        double cpu_max = 0;
+        bool has_resource_limits() const noexcept {
+            return !memory_max.empty() || !memory_high.empty() || cpu_weight > 0 || io_weight > 0 || pids_max > 0 ||
+                   cpu_max > 0;
+        }
+
+        // Output is logged line by line, or moved to scinit's stdout/stderr or 'output_file' without being looked at
+        // (passthrough). Tee writes to 'output_file' and scinit's stdout/stderr.
+        enum OutputMode { OUTPUT_LOG, OUTPUT_PASSTHROUGH, OUTPUT_TEE };
+        OutputMode output = OUTPUT_LOG;
+        std::string output_file;
+
+        /*
+         * Write the output to files instead of scinit's stdout: stdout and stderr to separate files, or both to
+         * 'combined' with each line tagged with the program and the stream. Files are shared by path.
+         */
+        struct LogFiles {
+            std::string combined, stdout_path, stderr_path;
+            uint64_t rotate_bytes = 0;
+            unsigned int rotate_interval = 0, retain = 5;
+            // Lines below this level (see 'detect_level') are not written to the file
+            levels::Level min_level = spdlog::level::trace;
+            bool enabled() const noexcept {
+                return !combined.empty() || !stdout_path.empty() || !stderr_path.empty();
+            }
+        };
+        LogFiles log_file;
+
+        // Send output (of streams that don't go to a log file) to a local syslog daemon as RFC 5424 messages
+        struct Syslog {
+            // Empty if disabled
+            std::string socket;
+            // Numbers as in RFC 5424, defaults: daemon, informational and warning
+            unsigned int facility = 3, stdout_severity = 6, stderr_severity = 4;
+            // Lines below this level are not sent, with 'detect_level' the severity follows the line's level
+            levels::Level min_level = spdlog::level::trace;
+            bool enabled() const noexcept { return !socket.empty(); }
+        };
+        Syslog syslog;
+
+        /*
+         * Find the level of each line ('[ERROR]', glog prefixes, a JSON "level" field, see LogLevels.h) instead of
+         * logging stdout as info and stderr as warning. Lines below 'min_level' are dropped before they reach any
+         * output but the crash log.
+         */
+        bool detect_level = false;
+        levels::Level min_level = spdlog::level::trace;
+
+        // Join continuation lines to the line before them (e.g. stack traces), the record is passed on once a line that
+        // isn't a continuation arrives or nothing was read for 'timeout_ms'
+        struct Multiline {
+            bool enabled = false;
+            // Null if continuation lines are those that start with whitespace
+            std::shared_ptr<const std::regex> pattern;
+            unsigned int timeout_ms = 100;
+            size_t max_bytes = 65536;
+        };
+        Multiline multiline;
+
+        // Lines dropped by 'filter' (null if there are no rules) or by sampling never reach any output
+        std::shared_ptr<OutputFilter> filter;
+        unsigned int sample_every = 0, max_lines_per_second = 0;
+
+        // Keep this many of the most recent output lines (and at most this many bytes of them) in memory, they are
+        // logged as a block if the program exits with an error. 0 disables it.
+        unsigned int crash_log_lines = 0;
+        size_t crash_log_bytes = 0;
+
+        // Memory-mapped file that keeps the most recent output even if scinit is killed, may be shared by programs
+        std::string ring_file;
+        uint64_t ring_size = 0;
+
+        // Restart the program gracefully once its RSS is above max_rss or grows faster than this per hour (in KiB,
+        // 0 disables the check). Needs sampling (--sample-interval).
+        unsigned long max_rss_kib = 0, max_rss_growth_kib_per_hour = 0;
+
+        // Paused (cgroup freeze or SIGSTOP) or stopped under sustained memory pressure, lowest priority first
+        enum ShedMode { SHED_NEVER, SHED_PAUSE, SHED_STOP };
+        ShedMode sheddable = SHED_NEVER;
+
+        // Whether a program that exited by itself is started again (after an increasing delay)
+        enum RestartPolicy { NEVER, ON_FAILURE, ALWAYS };
+        RestartPolicy restart = NEVER;
+
+        // CPU affinity, priorities, rlimits and OOM score, shared by all instances of the program entry unless they
+        // are spread across NUMA nodes
+        std::shared_ptr<Scheduling> scheduling;
+        // NUMA node the instance was placed on ('numa: spread'), -1 if it wasn't placed
+        int numa_node = -1;
+
+        // Pre-fork helper shared by all instances of the program entry, null if processes are forked directly
+        std::shared_ptr<Zygote> zygote;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_PROGRAMOPTIONS_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordFramer.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace scinit {
+    RecordFramer::RecordFramer(std::shared_ptr<const std::regex> continuation, size_t max_bytes) noexcept
+      : continuation(std::move(continuation)), max_bytes(std::max(max_bytes, static_cast<size_t>(1))) {}
+
+    void RecordFramer::add(const char* data, size_t length, const Handler& handle) {
+        while (length > 0) {
+            const auto* newline = static_cast<const char*>(std::memchr(data, '\n', length));
+            if (newline == nullptr) {
+                partial.append(data, length);
+                // There is no point in waiting for more of a line than fits in a record
+                if (partial.size() >= max_bytes) {
+                    auto cut = partial.size() - partial.size() % max_bytes;
+                    add_line(partial.data(), cut, handle);
+                    partial.erase(0, cut);
+                }
+                return;
+            }
+            auto line_length = static_cast<size_t>(newline - data);
+            if (partial.empty()) {
+                add_line(data, line_length, handle);
+            } else {
+                partial.append(data, line_length);
+                add_line(partial.data(), partial.size(), handle);
+                partial.clear();
+            }
+            data += line_length + 1;
+            length -= line_length + 1;
+        }
+    }
+
+    void RecordFramer::flush(const Handler& handle) {
+        if (!partial.empty()) {
+            add_line(partial.data(), partial.size(), handle);
+            partial.clear();
+        }
+        if (!record.empty()) {
+            handle(record);
+            record.clear();
+        }
+    }
+
+    void RecordFramer::add_line(const char* line, size_t length, const Handler& handle) {
+        // Empty lines are dropped, like at the edges of every read without 'multiline'
+        if (length == 0) {
+            return;
+        }
+        // Lines longer than a record are split into records of their own
+        while (length > max_bytes) {
+            add_line(line, max_bytes, handle);
+            line += max_bytes;
+            length -= max_bytes;
+        }
+        if (!record.empty() && record.size() + 1 + length <= max_bytes && is_continuation(line, length)) {
+            record += '\n';
+            record.append(line, length);
+            return;
+        }
+        if (!record.empty()) {
+            handle(record);
+        }
+        record.assign(line, length);
+    }
+
+    bool RecordFramer::is_continuation(const char* line, size_t length) const {
+        if (continuation) {
+            return std::regex_search(line, line + length, *continuation);
+        }
+        return line[0] == ' ' || line[0] == '\t';
+    }
+}  // namespace scinit
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_RECORDFRAMER_H
+#define CINIT_RECORDFRAMER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+
+namespace scinit {
+    /*
+     * Framing buffer of one output pipe of a program with 'multiline': splits what is read into lines (keeping an
+     * incomplete line until the rest arrives) and joins continuation lines to the record before them, so that e.g.
+     * a stack trace is passed on as one record with embedded newlines. A record is complete once a line that isn't
+     * a continuation arrives or, since nothing tells when a trace is over, when the owner calls flush() after a
+     * short timeout. Records never grow beyond 'max_bytes', a longer one is passed on in pieces.
+     */
+    class RecordFramer {
+      public:
+        using Handler = std::function<void(const std::string&)>;
+
+        // Continuation lines match 'continuation' (searched, so anchor it with '^') or, if it is null, start with a
+        // space or tab
+        RecordFramer(std::shared_ptr<const std::regex> continuation, size_t max_bytes) noexcept;
+
+        // Add what was read from the pipe, complete records are passed to 'handle'
+        void add(const char* data, size_t length, const Handler& handle);
+        // Pass on the pending record and an incomplete line, if any
+        void flush(const Handler& handle);
+        bool empty() const noexcept { return record.empty() && partial.empty(); }
+
+      private:
+        void add_line(const char* line, size_t length, const Handler& handle);
+        bool is_continuation(const char* line, size_t length) const;
+
+        std::shared_ptr<const std::regex> continuation;
+        size_t max_bytes;
+        // Record that may still get continuation lines, and the start of a line without its newline
+        std::string record, partial;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_RECORDFRAMER_H
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RingFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "ChildProcessException.h"
+
+namespace scinit {
+    namespace {
+        const char MAGIC[8] = {'S', 'C', 'I', 'N', 'I', 'T', 'R', 'B'};
+        const uint32_t VERSION = 1;
+        // Records start on the second page
+        const uint32_t DATA_OFFSET = 4096;
+        const uint8_t PADDING = 0xff;
+        const size_t MAX_PROGRAM_LENGTH = 256;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version, data_offset;
+            uint64_t capacity;
+            // Only accessed atomically, see RingFile
+            uint64_t tail, cursor;
+        };
+
+        // Records are aligned to 8 bytes, the rest of the ring is padding if a record doesn't fit before its end
+        struct RecordHeader {
+            // Position the record was written at, a mismatch means it has been overwritten
+            uint64_t position;
+            uint64_t time_ns;
+            // Bytes following the header: program name and message
+            uint32_t length;
+            uint16_t program_length;
+            uint8_t stream, reserved;
+        };
+        static_assert(sizeof(RecordHeader) == 24, "Record header must not contain padding");
+
+        uint64_t record_size(uint64_t length) noexcept { return (sizeof(RecordHeader) + length + 7) & ~7UL; }
+
+        FileHeader* header_of(void* map) noexcept { return static_cast<FileHeader*>(map); }
+
+        char* data_of(void* map) noexcept { return static_cast<char*>(map) + DATA_OFFSET; }
+
+        // Size of the record at 'position', a gap at the end of the ring too small for a header counts as one
+        uint64_t size_at(void* map, uint64_t position, uint64_t capacity) noexcept {
+            auto offset = position % capacity;
+            if (capacity - offset < sizeof(RecordHeader)) {
+                return capacity - offset;
+            }
+            RecordHeader record{};
+            std::memcpy(&record, data_of(map) + offset, sizeof(record));
+            return record_size(record.length);
+        }
+
+        void fail(int& fd, const std::string& what) noexcept(false) {
+            auto reason = what + ": " + std::strerror(errno);
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
+            }
+            throw ChildProcessException(reason.c_str());
+        }
+    }  // namespace
+
+    RingFile::RingFile(const std::string& path, uint64_t capacity) noexcept(false) {
+        // The ring must consist of whole records
+        capacity = std::max(capacity, static_cast<uint64_t>(RING_FILE_MIN_CAPACITY)) & ~7UL;
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+        if (fd == -1) {
+            fail(fd, "Couldn't open ring file " + path);
+        }
+        map_size = DATA_OFFSET + capacity;
+        struct stat info {};
+        if (fstat(fd, &info) == -1) {
+            fail(fd, "Couldn't stat ring file " + path);
+        }
+        bool reuse = static_cast<size_t>(info.st_size) == map_size;
+        if (!reuse && ftruncate(fd, static_cast<off_t>(map_size)) == -1) {
+            fail(fd, "Couldn't resize ring file " + path);
+        }
+        map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            map = nullptr;
+            fail(fd, "Couldn't map ring file " + path);
+        }
+        auto header = header_of(map);
+        // Keep the records of a previous run for post-mortem reading
+        reuse = reuse && std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION &&
+                header->data_offset == DATA_OFFSET && header->capacity == capacity && header->tail <= header->cursor &&
+                header->cursor - header->tail <= capacity;
+        if (!reuse) {
+            std::memset(header, 0, sizeof(FileHeader));
+            header->version = VERSION;
+            header->data_offset = DATA_OFFSET;
+            header->capacity = capacity;
+            // Written last, readers refuse the file until it is complete
+            std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        }
+    }
+
+    RingFile::~RingFile() {
+        if (map != nullptr) {
+            munmap(map, map_size);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void RingFile::append(const char* program, size_t program_length, Stream stream, const char* message,
+                          size_t length, uint64_t time_ns) noexcept {
+        auto header = header_of(map);
+        auto capacity = header->capacity;
+        program_length = std::min(program_length, static_cast<size_t>(MAX_PROGRAM_LENGTH));
+        auto max_length = capacity / 2 - sizeof(RecordHeader) - program_length;
+        length = std::min(length, static_cast<size_t>(max_length));
+        auto size = record_size(program_length + length);
+
+        auto position = header->cursor;
+        auto offset = position % capacity;
+        if (capacity - offset < size) {
+            // Doesn't fit before the end of the ring, fill the rest with padding
+            auto gap = capacity - offset;
+            make_room(position + gap);
+            if (gap >= sizeof(RecordHeader)) {
+                RecordHeader padding{position, 0, static_cast<uint32_t>(gap - sizeof(RecordHeader)), 0, PADDING, 0};
+                std::memcpy(data_of(map) + offset, &padding, sizeof(padding));
+            }
+            position += gap;
+            offset = 0;
+        }
+        make_room(position + size);
+        RecordHeader record{position, time_ns, static_cast<uint32_t>(program_length + length),
+                            static_cast<uint16_t>(program_length), static_cast<uint8_t>(stream), 0};
+        auto target = data_of(map) + offset;
+        std::memcpy(target, &record, sizeof(record));
+        std::memcpy(target + sizeof(record), program, program_length);
+        std::memcpy(target + sizeof(record) + program_length, message, length);
+        // Publish the record
+        __atomic_store_n(&header->cursor, position + size, __ATOMIC_RELEASE);
+    }
+
+    void RingFile::make_room(uint64_t end) noexcept {
+        auto header = header_of(map);
+        auto tail = header->tail;
+        while (end - tail > header->capacity) {
+            tail += size_at(map, tail, header->capacity);
+        }
+        // Readers have to see the new tail before the data under it changes
+        __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    RingFile::Reader::Reader(const std::string& path) noexcept(false) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            fail(fd, "Couldn't open ring file " + path);
+        }
+        struct stat info {};
+        if (fstat(fd, &info) == -1) {
+            fail(fd, "Couldn't stat ring file " + path);
+        }
+        map_size = static_cast<size_t>(info.st_size);
+        if (map_size <= DATA_OFFSET) {
+            close(fd);
+            fd = -1;
+            throw ChildProcessException((path + " is not a ring file").c_str());
+        }
+        map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            map = nullptr;
+            fail(fd, "Couldn't map ring file " + path);
+        }
+        auto header = header_of(map);
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+            header->data_offset != DATA_OFFSET || DATA_OFFSET + header->capacity != map_size) {
+            munmap(map, map_size);
+            map = nullptr;
+            close(fd);
+            fd = -1;
+            throw ChildProcessException((path + " is not a ring file").c_str());
+        }
+        position = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+    }
+
+    RingFile::Reader::~Reader() {
+        if (map != nullptr) {
+            munmap(map, map_size);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    bool RingFile::Reader::next(Record& record) noexcept {
+        auto header = header_of(map);
+        auto capacity = header->capacity;
+        while (position < __atomic_load_n(&header->cursor, __ATOMIC_ACQUIRE)) {
+            auto tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+            if (position < tail) {
+                skipped += tail - position;
+                position = tail;
+                continue;
+            }
+            auto offset = position % capacity;
+            if (capacity - offset < sizeof(RecordHeader)) {
+                position += capacity - offset;
+                continue;
+            }
+            RecordHeader copy{};
+            std::memcpy(&copy, data_of(map) + offset, sizeof(copy));
+            bool valid = copy.position == position && offset + record_size(copy.length) <= capacity &&
+                         copy.program_length <= copy.length;
+            if (valid && copy.stream != PADDING) {
+                auto data = data_of(map) + offset + sizeof(copy);
+                record.time_ns = copy.time_ns;
+                record.stream = copy.stream == STDERR ? STDERR : STDOUT;
+                record.program.assign(data, copy.program_length);
+                record.message.assign(data + copy.program_length, copy.length - copy.program_length);
+            }
+            // If the writer moved the tail past the record while we were reading it, it may be torn
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&header->tail, __ATOMIC_ACQUIRE) > position) {
+                continue;
+            }
+            if (!valid) {
+                // Can't happen with a single writer, unless the file was modified otherwise
+                skipped += capacity - offset;
+                position += capacity - offset;
+                continue;
+            }
+            position += record_size(copy.length);
+            if (copy.stream != PADDING) {
+                return true;
+            }
+        }
+        return false;
+    }
+}  // namespace scinit
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_RINGFILE_H
+#define CINIT_RINGFILE_H
+
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Smallest ring that may be configured
+#define RING_FILE_MIN_CAPACITY 65536
+
+namespace scinit {
+    /*
+     * Output records in a memory-mapped file ('ring_file'), which outlives scinit: the kernel writes the shared
+     * mapping back to the file even if scinit is killed, so the most recent output can be read after the fact with
+     * 'scinit --tail <file>', and while scinit is running without disturbing it.
+     *
+     * The file is a header page followed by a ring of records. 'cursor' is the absolute position (total bytes ever
+     * written) after the last complete record, 'tail' the position of the oldest record that hasn't been
+     * overwritten. There is a single writer, scinit, which moves 'tail' past the records it is about to overwrite,
+     * writes the record and then publishes it by moving 'cursor'. Readers never lock anything: they read a record
+     * and check afterwards that 'tail' hasn't moved past it in the meantime, otherwise it might be torn.
+     */
+    class RingFile {
+      public:
+        enum Stream { STDOUT = 0, STDERR = 1 };
+
+        // A record as read from the ring, the strings are only valid until the next call to next()
+        struct Record {
+            uint64_t time_ns = 0;
+            Stream stream = STDOUT;
+            std::string program, message;
+        };
+
+        /*
+         * Open 'path' for writing, with 'capacity' bytes for records. Records in an existing file with the same
+         * capacity are kept. Throws a ChildProcessException if the file can't be created or mapped.
+         */
+        RingFile(const std::string& path, uint64_t capacity) noexcept(false);
+        RingFile(const RingFile&) = delete;
+        RingFile& operator=(const RingFile&) = delete;
+        ~RingFile();
+
+        // Append a record, messages that don't fit into half of the ring are cut off
+        void append(const char* program, size_t program_length, Stream stream, const char* message, size_t length,
+                    uint64_t time_ns) noexcept;
+
+        /*
+         * Reads the records of a ring file from the oldest one on, concurrently with the writer. Throws a
+         * ChildProcessException if 'path' isn't a ring file.
+         */
+        class Reader {
+          public:
+            explicit Reader(const std::string& path) noexcept(false);
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+            ~Reader();
+
+            // The next record, false if there is none (yet)
+            bool next(Record& record) noexcept;
+            // Number of bytes of records that were overwritten before they could be read
+            uint64_t get_skipped() const noexcept { return skipped; }
+
+          private:
+            int fd = -1;
+            void* map = nullptr;
+            size_t map_size = 0;
+            uint64_t position = 0, skipped = 0;
+        };
+
+      private:
+        void make_room(uint64_t end) noexcept;
+
+        int fd = -1;
+        void* map = nullptr;
+        size_t map_size = 0;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_RINGFILE_H
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Scheduling.h"
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include "ConfigParseException.h"
+#include "SystemResources.h"
+
+// From linux/ioprio.h, which isn't available everywhere
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_RT 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+// From linux/mempolicy.h
+#define SCINIT_MPOL_BIND 2
+
+namespace scinit {
+    namespace {
+        unsigned int parse_number(const std::string& value, const char* what) noexcept(false) {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+                throw ConfigParseException(what);
+            }
+            return static_cast<unsigned int>(std::stoul(value));
+        }
+
+        rlim_t parse_rlimit_value(const std::string& value) noexcept(false) {
+            if (value == "unlimited" || value == "infinity") {
+                return RLIM_INFINITY;
+            }
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+                throw ConfigParseException("rlimit values have to be numbers or 'unlimited'!");
+            }
+            return static_cast<rlim_t>(std::stoull(value));
+        }
+    }  // namespace
+
+    Scheduling::Scheduling() noexcept { CPU_ZERO(&cpus); }
+
+    void Scheduling::set_cpus(const std::string& list) noexcept(false) {
+        std::vector<unsigned int> parsed;
+        if (!resources::parse_cpu_list(list, parsed)) {
+            throw ConfigParseException("Invalid CPU list, expected e.g. '0-3,8'!");
+        }
+        set_cpus(parsed);
+    }
+
+    void Scheduling::set_cpus(const std::vector<unsigned int>& list) noexcept(false) {
+        if (list.empty()) {
+            throw ConfigParseException("CPU list is empty!");
+        }
+        CPU_ZERO(&cpus);
+        for (auto cpu : list) {
+            if (cpu >= CPU_SETSIZE) {
+                throw ConfigParseException("CPU number out of range!");
+            }
+            CPU_SET(cpu, &cpus);
+        }
+        cpus_set = true;
+    }
+
+    std::vector<unsigned int> Scheduling::get_cpus() const noexcept {
+        std::vector<unsigned int> list;
+        for (unsigned int cpu = 0; cpus_set && cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &cpus)) {
+                list.push_back(cpu);
+            }
+        }
+        return list;
+    }
+
+    void Scheduling::set_nice(int value) noexcept(false) {
+        if (value < -20 || value > 19) {
+            throw ConfigParseException("nice has to be between -20 and 19!");
+        }
+        nice = value;
+        nice_set = true;
+    }
+
+    void Scheduling::set_policy(const std::string& name, int priority) noexcept(false) {
+        static const std::map<std::string, int> policies = {
+          {"other", SCHED_OTHER}, {"batch", SCHED_BATCH}, {"idle", SCHED_IDLE}, {"fifo", SCHED_FIFO}, {"rr", SCHED_RR}};
+        auto found = policies.find(name);
+        if (found == policies.end()) {
+            throw ConfigParseException("Unknown sched_policy, expected other, batch, idle, fifo or rr!");
+        }
+        bool realtime = found->second == SCHED_FIFO || found->second == SCHED_RR;
+        if (realtime ? priority < 1 || priority > 99 : priority != 0) {
+            throw ConfigParseException("sched_priority has to be 1-99 for fifo and rr and is not used otherwise!");
+        }
+        policy = found->second;
+        sched_priority.sched_priority = priority;
+        policy_set = true;
+    }
+
+    void Scheduling::set_ioprio(const std::string& value) noexcept(false) {
+        auto colon = value.find(':');
+        auto name = value.substr(0, colon);
+        unsigned int level = 4;
+        if (colon != std::string::npos) {
+            level = parse_number(value.substr(colon + 1), "ioprio level has to be a number between 0 and 7!");
+            if (level > 7) {
+                throw ConfigParseException("ioprio level has to be a number between 0 and 7!");
+            }
+        }
+        int io_class;
+        if (name == "realtime") {
+            io_class = IOPRIO_CLASS_RT;
+        } else if (name == "best-effort") {
+            io_class = IOPRIO_CLASS_BE;
+        } else if (name == "idle" && colon == std::string::npos) {
+            io_class = IOPRIO_CLASS_IDLE;
+            level = 0;
+        } else {
+            throw ConfigParseException("Unknown ioprio, expected 'idle', 'best-effort[:level]' or 'realtime[:level]'!");
+        }
+        ioprio = (io_class << IOPRIO_CLASS_SHIFT) | static_cast<int>(level);
+        ioprio_set = true;
+    }
+
+    void Scheduling::add_rlimit(const std::string& resource, const std::string& soft,
+                                const std::string& hard) noexcept(false) {
+        static const std::map<std::string, int> resources = {
+          {"as", RLIMIT_AS},           {"core", RLIMIT_CORE},       {"cpu", RLIMIT_CPU},
+          {"data", RLIMIT_DATA},       {"fsize", RLIMIT_FSIZE},     {"locks", RLIMIT_LOCKS},
+          {"memlock", RLIMIT_MEMLOCK}, {"msgqueue", RLIMIT_MSGQUEUE}, {"nice", RLIMIT_NICE},
+          {"nofile", RLIMIT_NOFILE},   {"nproc", RLIMIT_NPROC},     {"rss", RLIMIT_RSS},
+          {"rtprio", RLIMIT_RTPRIO},   {"rttime", RLIMIT_RTTIME},   {"sigpending", RLIMIT_SIGPENDING},
+          {"stack", RLIMIT_STACK}};
+        auto found = resources.find(resource);
+        if (found == resources.end()) {
+            throw ConfigParseException(("Unknown rlimit '" + resource + "'!").c_str());
+        }
+        struct rlimit limit {};
+        limit.rlim_cur = parse_rlimit_value(soft);
+        limit.rlim_max = parse_rlimit_value(hard);
+        if (limit.rlim_max != RLIM_INFINITY && (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > limit.rlim_max)) {
+            throw ConfigParseException(("Soft limit of rlimit '" + resource + "' is above the hard limit!").c_str());
+        }
+        rlimits.emplace_back(found->second, limit);
+    }
+
+    void Scheduling::set_oom_score_adj(int adj) noexcept(false) {
+        if (adj < -1000 || adj > 1000) {
+            throw ConfigParseException("oom_score_adj has to be between -1000 and 1000!");
+        }
+        oom_score_adj = std::to_string(adj);
+    }
+
+    void Scheduling::set_memory_node(unsigned int node) noexcept(false) {
+        if (node >= MAX_NUMA_NODES) {
+            throw ConfigParseException("NUMA node out of range!");
+        }
+        std::fill(std::begin(node_mask), std::end(node_mask), 0);
+        node_mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+        memory_node = static_cast<int>(node);
+    }
+
+    bool Scheduling::empty() const noexcept {
+        return !cpus_set && !nice_set && !policy_set && !ioprio_set && rlimits.empty() && oom_score_adj.empty() &&
+               memory_node == -1;
+    }
+
+    const char* Scheduling::apply() const noexcept {
+        if (cpus_set && sched_setaffinity(0, sizeof(cpus), &cpus) == -1) {
+            return "cpu_affinity";
+        }
+        if (policy_set && sched_setscheduler(0, policy, &sched_priority) == -1) {
+            return "sched_policy";
+        }
+        if (nice_set && setpriority(PRIO_PROCESS, 0, nice) == -1) {
+            return "nice";
+        }
+        // NOLINTNEXTLINE(hicpp-vararg)
+        if (ioprio_set && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio) == -1) {
+            return "ioprio";
+        }
+        for (const auto& limit : rlimits) {
+            if (setrlimit(static_cast<__rlimit_resource_t>(limit.first), &limit.second) == -1) {
+                return "rlimits";
+            }
+        }
+        // The kernel ignores the last bit of maxnode
+        // NOLINTNEXTLINE(hicpp-vararg)
+        if (memory_node != -1 &&
+            syscall(SYS_set_mempolicy, SCINIT_MPOL_BIND, static_cast<const unsigned long*>(node_mask),
+                    MAX_NUMA_NODES + 1) == -1) {
+            return "numa";
+        }
+        if (!oom_score_adj.empty()) {
+            int fd = open("/proc/self/oom_score_adj", O_WRONLY | O_CLOEXEC);
+            auto length = static_cast<ssize_t>(oom_score_adj.size());
+            bool ok = fd != -1 && write(fd, oom_score_adj.c_str(), oom_score_adj.size()) == length;
+            if (fd != -1) {
+                close(fd);
+            }
+            if (!ok) {
+                return "oom_score_adj";
+            }
+        }
+        return nullptr;
+    }
+}  // namespace scinit
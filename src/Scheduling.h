@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_SCHEDULING_H
+#define CINIT_SCHEDULING_H
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Size of the node mask passed to set_mempolicy, the kernel's default MAX_NUMNODES is 1024 at most
+#define MAX_NUMA_NODES 1024
+
+namespace scinit {
+    /*
+     * Scheduling and resource settings of a program that are applied in the child between fork and exec: CPU
+     * affinity, NUMA memory binding, scheduling policy, nice value, IO priority, rlimits and the OOM score
+     * adjustment.
+     *
+     * The setters parse the config values and throw a ConfigParseException on invalid input, everything is
+     * converted to what the system calls take, so that apply() only has to make async-signal-safe calls.
+     */
+    class Scheduling {
+      public:
+        Scheduling() noexcept;
+
+        // A CPU list like "0-3,8" or a list of CPU numbers
+        void set_cpus(const std::string& list) noexcept(false);
+        void set_cpus(const std::vector<unsigned int>& cpus) noexcept(false);
+        bool has_cpus() const noexcept { return cpus_set; }
+        std::vector<unsigned int> get_cpus() const noexcept;
+
+        // -20 (highest priority) to 19
+        void set_nice(int nice) noexcept(false);
+        // other, batch, idle, fifo or rr, the latter two with a priority between 1 and 99
+        void set_policy(const std::string& policy, int priority) noexcept(false);
+        // "idle", "best-effort[:0-7]" or "realtime[:0-7]", the level defaults to 4
+        void set_ioprio(const std::string& ioprio) noexcept(false);
+        // Resource name as in prlimit(1) without the RLIMIT_ prefix (nofile, core, ...), values may be "unlimited"
+        void add_rlimit(const std::string& resource, const std::string& soft, const std::string& hard) noexcept(false);
+        // -1000 to 1000
+        void set_oom_score_adj(int adj) noexcept(false);
+        // Only allocate memory from this NUMA node (set_mempolicy with MPOL_BIND)
+        void set_memory_node(unsigned int node) noexcept(false);
+        int get_memory_node() const noexcept { return memory_node; }
+
+        bool empty() const noexcept;
+
+        // Apply everything to the calling process. Returns nullptr or the name of the setting that failed.
+        const char* apply() const noexcept;
+
+      private:
+        cpu_set_t cpus;
+        bool cpus_set = false, nice_set = false, policy_set = false, ioprio_set = false;
+        int nice = 0, policy = SCHED_OTHER, ioprio = 0;
+        struct sched_param sched_priority {};
+        std::vector<std::pair<int, struct rlimit>> rlimits;
+        // Written to /proc/self/oom_score_adj as is, empty if not set
+        std::string oom_score_adj;
+        int memory_node = -1;
+        unsigned long node_mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {};
+    };
+}  // namespace scinit
+
+#endif  // CINIT_SCHEDULING_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SystemResources.h"
+#include <sched.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include "log.h"
+
+namespace scinit {
+    namespace resources {
+        namespace {
+            // CPUs granted by a quota/period pair, 0 if unlimited or unreadable
+            unsigned int cpus_for_quota(long quota, long period) noexcept {
+                if (quota <= 0 || period <= 0) {
+                    return 0;
+                }
+                return static_cast<unsigned int>((quota + period - 1) / period);
+            }
+
+            unsigned int cgroup_v2_limit() noexcept {
+                auto cgroup = own_cgroup();
+                if (cgroup.empty()) {
+                    return 0;
+                }
+                // Quotas nest, the tightest one on the way up to the root wins
+                unsigned int limit = 0;
+                while (true) {
+                    std::ifstream cpu_max(cgroup + "/cpu.max");
+                    std::string quota;
+                    long period = 0;
+                    if (cpu_max >> quota >> period && quota != "max") {
+                        auto cpus = cpus_for_quota(std::stol(quota), period);
+                        if (cpus > 0 && (limit == 0 || cpus < limit)) {
+                            limit = cpus;
+                        }
+                    }
+                    if (cgroup == "/sys/fs/cgroup") {
+                        break;
+                    }
+                    cgroup = cgroup.substr(0, cgroup.rfind('/'));
+                }
+                return limit;
+            }
+
+            unsigned int cgroup_v1_limit() noexcept {
+                for (const std::string dir : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+                    std::ifstream quota_file(dir + "/cpu.cfs_quota_us"), period_file(dir + "/cpu.cfs_period_us");
+                    long quota = 0, period = 0;
+                    if (quota_file >> quota && period_file >> period) {
+                        return cpus_for_quota(quota, period);
+                    }
+                }
+                return 0;
+            }
+        }  // namespace
+
+        std::string own_cgroup() noexcept {
+            std::ifstream cgroup_file("/proc/self/cgroup");
+            std::string line;
+            while (std::getline(cgroup_file, line)) {
+                // The unified hierarchy is the one with id 0 and no controllers: "0::/path"
+                if (line.compare(0, 3, "0::") == 0) {
+                    auto path = line.substr(3);
+                    if (path == "/") {
+                        path.clear();
+                    }
+                    return "/sys/fs/cgroup" + path;
+                }
+            }
+            return "";
+        }
+
+        std::vector<unsigned int> allowed_cpus() noexcept {
+            std::vector<unsigned int> cpus;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+            return cpus;
+        }
+
+        bool parse_cpu_list(const std::string& list, std::vector<unsigned int>& cpus) noexcept {
+            std::vector<unsigned int> parsed;
+            size_t begin = 0;
+            while (begin < list.size()) {
+                auto end = std::min(list.find(',', begin), list.size());
+                auto range = list.substr(begin, end - begin);
+                range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+                auto dash = range.find('-');
+                auto first_str = range.substr(0, dash);
+                auto last_str = dash == std::string::npos ? first_str : range.substr(dash + 1);
+                for (const auto& number : {first_str, last_str}) {
+                    if (number.empty() || number.size() > 6 ||
+                        number.find_first_not_of("0123456789") != std::string::npos) {
+                        return false;
+                    }
+                }
+                auto first = static_cast<unsigned int>(std::stoul(first_str)),
+                     last = static_cast<unsigned int>(std::stoul(last_str));
+                if (last < first) {
+                    return false;
+                }
+                for (auto cpu = first; cpu <= last; cpu++) {
+                    parsed.push_back(cpu);
+                }
+                begin = end + 1;
+            }
+            cpus.swap(parsed);
+            return true;
+        }
+
+        std::vector<NumaNode> numa_nodes(const std::string& sysfs) noexcept {
+            std::vector<NumaNode> nodes;
+            std::vector<unsigned int> with_memory;
+            std::ifstream has_memory(sysfs + "/has_memory");
+            std::string line;
+            if (!std::getline(has_memory, line) || !parse_cpu_list(line, with_memory)) {
+                return nodes;
+            }
+            auto allowed = allowed_cpus();
+            for (auto id : with_memory) {
+                std::ifstream cpulist(sysfs + "/node" + std::to_string(id) + "/cpulist");
+                std::vector<unsigned int> cpus;
+                line.clear();
+                std::getline(cpulist, line);
+                if (!parse_cpu_list(line, cpus)) {
+                    continue;
+                }
+                NumaNode node{id, {}};
+                std::set_intersection(cpus.begin(), cpus.end(), allowed.begin(), allowed.end(),
+                                      std::back_inserter(node.cpus));
+                // Memory only nodes (CXL, ...) and nodes we may not run on
+                if (!node.cpus.empty()) {
+                    nodes.push_back(node);
+                }
+            }
+            return nodes;
+        }
+
+        unsigned int available_cpus() noexcept {
+            unsigned int cpus = 1;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                cpus = static_cast<unsigned int>(std::max(CPU_COUNT(&set), 1));
+            }
+            auto limit = cgroup_v2_limit();
+            if (limit == 0) {
+                limit = cgroup_v1_limit();
+            }
+            if (limit > 0) {
+                cpus = std::min(cpus, limit);
+            }
+            LOG->debug("{0} CPUs available", cpus);
+            return cpus;
+        }
+    }  // namespace resources
+}  // namespace scinit
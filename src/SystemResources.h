@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_SYSTEMRESOURCES_H
+#define CINIT_SYSTEMRESOURCES_H
+
+#include <string>
+#include <vector>
+
+namespace scinit {
+    namespace resources {
+        /*
+         * Number of CPUs this container may actually use: the size of our affinity mask, further limited by the
+         * CPU quota of our cgroup (v2 cpu.max or v1 cpu.cfs_quota_us), rounded up. Always at least 1.
+         */
+        unsigned int available_cpus() noexcept;
+
+        // CPUs in our affinity mask, in ascending order
+        std::vector<unsigned int> allowed_cpus() noexcept;
+
+        // Parse a kernel style CPU list like "0-3,8", returns false on invalid input
+        bool parse_cpu_list(const std::string& list, std::vector<unsigned int>& cpus) noexcept;
+
+        // A NUMA node with the CPUs of it that are in our affinity mask
+        struct NumaNode {
+            unsigned int id;
+            std::vector<unsigned int> cpus;
+        };
+
+        /*
+         * NUMA nodes from sysfs that have memory and CPUs we may use, ordered by id. Empty if the topology can't be
+         * read, a machine without NUMA has a single node.
+         */
+        std::vector<NumaNode> numa_nodes(const std::string& sysfs = "/sys/devices/system/node") noexcept;
+
+        // Path of our own cgroup v2 directory below /sys/fs/cgroup, empty if not on a unified hierarchy
+        std::string own_cgroup() noexcept;
+    }  // namespace resources
+}  // namespace scinit
+
+#endif  // CINIT_SYSTEMRESOURCES_H
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimerWheel.h"
+#include <utility>
+
+namespace scinit {
+    constexpr TimerWheel::TimerId TimerWheel::INVALID_TIMER;
+    constexpr unsigned int TimerWheel::SLOT_BITS;
+    constexpr unsigned int TimerWheel::SLOTS;
+    constexpr unsigned int TimerWheel::LEVELS;
+    constexpr uint32_t TimerWheel::NIL;
+
+    TimerWheel::TimerWheel(uint64_t now_ms, unsigned int tick_ms) : tick_ms(tick_ms == 0 ? 1 : tick_ms) {
+        current_tick = now_ms / this->tick_ms;
+        for (auto& level : levels) {
+            level.heads.fill(NIL);
+            level.occupied = 0;
+        }
+    }
+
+    TimerWheel::TimerId TimerWheel::schedule(uint64_t now_ms, uint64_t delay_ms, Callback callback) {
+        if (!callback) {
+            return INVALID_TIMER;
+        }
+        // Round up so that a timer never fires early
+        uint64_t expiry = (now_ms + delay_ms + tick_ms - 1) / tick_ms;
+        if (expiry <= current_tick) {
+            expiry = current_tick + 1;
+        }
+        // Everything beyond the range of the top level is clamped. One top level slot is left free so that a
+        // timer that wraps around on the top level never ends up in the slot that is currently being processed.
+        const uint64_t max_delta = uint64_t(SLOTS - 1) << (SLOT_BITS * (LEVELS - 1));
+        if (expiry - current_tick > max_delta) {
+            expiry = current_tick + max_delta;
+        }
+
+        uint32_t index;
+        if (!free_list.empty()) {
+            index = free_list.back();
+            free_list.pop_back();
+        } else {
+            index = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        auto& node = nodes[index];
+        node.callback = std::move(callback);
+        node.expiry = expiry;
+        node.armed = true;
+        link(index);
+        active++;
+        return (static_cast<uint64_t>(node.generation) << 32) | index;
+    }
+
+    bool TimerWheel::cancel(TimerId id) noexcept {
+        auto index = static_cast<uint32_t>(id & 0xffffffff);
+        auto generation = static_cast<uint32_t>(id >> 32);
+        if (index >= nodes.size() || !nodes[index].armed || nodes[index].generation != generation) {
+            return false;
+        }
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    unsigned int TimerWheel::advance(uint64_t now_ms) {
+        const uint64_t target = now_ms / tick_ms;
+        fired = 0;
+        while (current_tick < target) {
+            uint64_t deadline;
+            if (!next_deadline_tick(deadline) || deadline > target) {
+                // Nothing happens until 'target', skip the intermediate ticks
+                current_tick = target;
+                break;
+            }
+            // Nothing to do in between, jump directly to the tick before the next event
+            if (deadline - 1 > current_tick) {
+                current_tick = deadline - 1;
+            }
+            current_tick++;
+            for (unsigned int level = LEVELS - 1; level > 0; level--) {
+                if ((current_tick & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) == 0) {
+                    cascade(level);
+                }
+            }
+            expire_current();
+        }
+        return fired;
+    }
+
+    bool TimerWheel::next_deadline(uint64_t& deadline_ms) const noexcept {
+        uint64_t tick;
+        if (!next_deadline_tick(tick)) {
+            return false;
+        }
+        deadline_ms = tick * tick_ms;
+        return true;
+    }
+
+    bool TimerWheel::next_deadline_tick(uint64_t& tick) const noexcept {
+        if (active == 0) {
+            return false;
+        }
+        for (unsigned int level = 0; level < LEVELS; level++) {
+            const unsigned int shift = SLOT_BITS * level;
+            const auto position = static_cast<unsigned int>((current_tick >> shift) & (SLOTS - 1));
+            // Only slots after the current position can be occupied, see link()
+            uint64_t mask = levels[level].occupied;
+            mask &= position == SLOTS - 1 ? 0 : ~((uint64_t(2) << position) - 1);
+            if (mask != 0) {
+                auto slot = static_cast<uint64_t>(__builtin_ctzll(mask));
+                tick = ((current_tick >> (shift + SLOT_BITS)) << (shift + SLOT_BITS)) | (slot << shift);
+                return true;
+            }
+        }
+        // The top level may contain timers that wrapped around, they are due in the next round
+        const unsigned int shift = SLOT_BITS * (LEVELS - 1);
+        if (levels[LEVELS - 1].occupied != 0) {
+            auto slot = static_cast<uint64_t>(__builtin_ctzll(levels[LEVELS - 1].occupied));
+            tick = (((current_tick >> (shift + SLOT_BITS)) + 1) << (shift + SLOT_BITS)) | (slot << shift);
+            return true;
+        }
+        return false;
+    }
+
+    void TimerWheel::link(uint32_t index) {
+        auto& node = nodes[index];
+        // A timer goes to the level of the most significant digit in which its expiry differs from the current tick,
+        // that way it's guaranteed to be cascaded (or expired) exactly when that digit is reached.
+        const uint64_t diff = node.expiry > current_tick ? node.expiry ^ current_tick : 0;
+        unsigned int level = 0;
+        if (diff != 0) {
+            level = (63 - static_cast<unsigned int>(__builtin_clzll(diff))) / SLOT_BITS;
+        }
+        if (level >= LEVELS) {
+            // Wrapped around on the top level, see schedule()
+            level = LEVELS - 1;
+        }
+        auto slot = static_cast<unsigned int>(((diff != 0 ? node.expiry : current_tick) >> (SLOT_BITS * level)) &
+                                              (SLOTS - 1));
+        auto& wheel = levels[level];
+        node.slot = static_cast<uint16_t>(level * SLOTS + slot);
+        node.prev = NIL;
+        node.next = wheel.heads[slot];
+        if (node.next != NIL) {
+            nodes[node.next].prev = index;
+        }
+        wheel.heads[slot] = index;
+        wheel.occupied |= uint64_t(1) << slot;
+    }
+
+    void TimerWheel::unlink(uint32_t index) noexcept {
+        auto& node = nodes[index];
+        auto& wheel = levels[node.slot / SLOTS];
+        const unsigned int slot = node.slot % SLOTS;
+        if (node.prev != NIL) {
+            nodes[node.prev].next = node.next;
+        } else {
+            wheel.heads[slot] = node.next;
+        }
+        if (node.next != NIL) {
+            nodes[node.next].prev = node.prev;
+        }
+        if (wheel.heads[slot] == NIL) {
+            wheel.occupied &= ~(uint64_t(1) << slot);
+        }
+        node.prev = NIL;
+        node.next = NIL;
+    }
+
+    void TimerWheel::release(uint32_t index) noexcept {
+        auto& node = nodes[index];
+        node.armed = false;
+        node.callback = nullptr;
+        node.generation++;
+        if (node.generation == 0) {
+            node.generation = 1;
+        }
+        free_list.push_back(index);
+        active--;
+    }
+
+    void TimerWheel::cascade(unsigned int level) {
+        auto& wheel = levels[level];
+        const auto slot = static_cast<unsigned int>((current_tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        uint32_t index = wheel.heads[slot];
+        wheel.heads[slot] = NIL;
+        wheel.occupied &= ~(uint64_t(1) << slot);
+        while (index != NIL) {
+            uint32_t next = nodes[index].next;
+            link(index);
+            index = next;
+        }
+    }
+
+    void TimerWheel::expire_current() {
+        auto& wheel = levels[0];
+        const auto slot = static_cast<unsigned int>(current_tick & (SLOTS - 1));
+        // Callbacks may schedule or cancel timers, so always re-read the head
+        while (wheel.heads[slot] != NIL) {
+            uint32_t index = wheel.heads[slot];
+            unlink(index);
+            auto callback = std::move(nodes[index].callback);
+            release(index);
+            fired++;
+            callback();
+        }
+    }
+}  // namespace scinit
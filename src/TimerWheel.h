@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_TIMERWHEEL_H
+#define CINIT_TIMERWHEEL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace scinit {
+    /*
+     * Hierarchical timing wheel. Time is divided into ticks of a fixed length, which also means that all timers
+     * expiring within the same tick are coalesced into a single wakeup. There are LEVELS wheels with SLOTS slots
+     * each, a timer is placed on the lowest wheel that can represent its expiry and cascaded downwards as time
+     * advances. Timers live in a pooled node array with intrusive lists, so that scheduling and cancelling are O(1)
+     * and don't allocate once the pool has grown to its working size.
+     *
+     * The wheel itself knows nothing about clocks or file descriptors, callers pass in the current time in ms.
+     */
+    class TimerWheel {
+      public:
+        using TimerId = uint64_t;
+        using Callback = std::function<void()>;
+
+        // Returned by schedule() on failure, never a valid timer
+        static constexpr TimerId INVALID_TIMER = 0;
+
+        explicit TimerWheel(uint64_t now_ms, unsigned int tick_ms = 10);
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+        ~TimerWheel() = default;
+
+        // Schedule 'callback' to run 'delay_ms' after 'now_ms'. The expiry is rounded up to the next tick.
+        TimerId schedule(uint64_t now_ms, uint64_t delay_ms, Callback callback);
+
+        // Cancel a timer. Returns false if the timer already fired or has been cancelled before.
+        bool cancel(TimerId id) noexcept;
+
+        // Run all callbacks that expired up to and including 'now_ms'. Returns the number of callbacks executed.
+        unsigned int advance(uint64_t now_ms);
+
+        /*
+         * Time (in ms) at which advance() needs to be called next, either because a timer expires or because a
+         * higher wheel needs to be cascaded. Returns false if there are no timers at all.
+         */
+        bool next_deadline(uint64_t& deadline_ms) const noexcept;
+
+        std::size_t size() const noexcept { return active; }
+        unsigned int get_tick_ms() const noexcept { return tick_ms; }
+
+      private:
+        static constexpr unsigned int SLOT_BITS = 6;
+        static constexpr unsigned int SLOTS = 1u << SLOT_BITS;
+        static constexpr unsigned int LEVELS = 6;
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        struct Node {
+            Callback callback;
+            uint64_t expiry = 0;
+            uint32_t prev = NIL, next = NIL;
+            uint32_t generation = 1;
+            uint16_t slot = 0;
+            bool armed = false;
+        };
+
+        struct Level {
+            std::array<uint32_t, SLOTS> heads;
+            uint64_t occupied = 0;
+        };
+
+        bool next_deadline_tick(uint64_t& tick) const noexcept;
+        void link(uint32_t index);
+        void unlink(uint32_t index) noexcept;
+        void release(uint32_t index) noexcept;
+        void cascade(unsigned int level);
+        void expire_current();
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_list;
+        std::array<Level, LEVELS> levels;
+        uint64_t current_tick;
+        unsigned int tick_ms;
+        std::size_t active = 0;
+        unsigned int fired = 0;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_TIMERWHEEL_H
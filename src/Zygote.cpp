@@ -0,0 +1,271 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Zygote.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "ChildProcessException.h"
+#include "log.h"
+
+// Upper limits for a single spawn request
+#define ZYGOTE_MAX_MESSAGE (128 * 1024)
+#define ZYGOTE_MAX_FDS 64
+
+namespace scinit {
+    namespace {
+        struct RequestHeader {
+            uint32_t args, environment, listen_pid;
+        };
+
+        // Move 'fds' to stdout, stderr and 3... without clobbering one that hasn't been moved yet
+        bool install_fds(const int* fds, size_t count) noexcept {
+            const int first_fd = 3;
+            std::vector<int> moved(count, -1);
+            for (size_t i = 0; i < count; i++) {
+                // NOLINTNEXTLINE(hicpp-vararg,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                moved[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, first_fd + static_cast<int>(count));
+                if (moved[i] == -1) {
+                    return false;
+                }
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                close(fds[i]);
+            }
+            for (size_t i = 0; i < count; i++) {
+                int target = i == 0 ? STDOUT_FILENO : i == 1 ? STDERR_FILENO : first_fd + static_cast<int>(i) - 2;
+                // dup2 clears FD_CLOEXEC on the target, so these survive the exec
+                if (dup2(moved[i], target) == -1) {
+                    return false;
+                }
+                close(moved[i]);
+            }
+            return true;
+        }
+
+        // The zygote only needs stdin/stdout/stderr and its socket, everything else belongs to scinit
+        void close_inherited_fds(int keep) noexcept {
+            std::vector<int> fds;
+            if (DIR* dir = opendir("/proc/self/fd")) {
+                while (auto entry = readdir(dir)) {
+                    int fd = std::atoi(static_cast<const char*>(entry->d_name));
+                    if (fd > STDERR_FILENO && fd != keep && fd != dirfd(dir)) {
+                        fds.push_back(fd);
+                    }
+                }
+                closedir(dir);
+            }
+            for (auto fd : fds) {
+                close(fd);
+            }
+        }
+    }  // namespace
+
+    Zygote::Zygote(std::string name) noexcept : name(std::move(name)) {}
+
+    Zygote::~Zygote() {
+        if (sock != -1) {
+            close(sock);
+        }
+    }
+
+    void Zygote::start(const std::function<bool()>& prepare) noexcept(false) {
+        if (is_running()) {
+            return;
+        }
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, static_cast<int*>(sockets)) == -1) {
+            throw ChildProcessException("Couldn't create zygote socketpair!");
+        }
+        pid = fork();
+        if (pid == -1) {
+            close(sockets[0]);
+            close(sockets[1]);
+            throw ChildProcessException("Couldn't fork zygote!");
+        }
+        if (pid == 0) {
+            sock = sockets[1];
+            close_inherited_fds(sock);
+            // NOLINTNEXTLINE(hicpp-vararg)
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (!prepare()) {
+                _exit(-1);
+            }
+            serve();
+        }
+        close(sockets[1]);
+        sock = sockets[0];
+        // Don't let a stuck zygote block the event loop
+        struct timeval timeout {};
+        timeout.tv_sec = 5;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        LOG->info("Started zygote for {0} (PID {1})", name, pid);
+    }
+
+    void Zygote::stop() noexcept {
+        close(sock);
+        sock = -1;
+        pid = -1;
+    }
+
+    pid_t Zygote::spawn(const std::string& path, const std::list<std::string>& args,
+                        const std::list<std::string>& environment, const std::vector<int>& fds,
+                        bool listen_pid) noexcept(false) {
+        if (!is_running()) {
+            throw ChildProcessException("Zygote is not running!");
+        }
+        if (fds.size() > ZYGOTE_MAX_FDS) {
+            throw ChildProcessException("Too many file descriptors for zygote!");
+        }
+        RequestHeader header{static_cast<uint32_t>(args.size()), static_cast<uint32_t>(environment.size()),
+                             listen_pid ? 1u : 0u};
+        std::string request(reinterpret_cast<const char*>(&header), sizeof(header));  // NOLINT
+        request.append(path).push_back('\0');
+        for (const auto& arg : args) {
+            request.append(arg).push_back('\0');
+        }
+        for (const auto& var : environment) {
+            request.append(var).push_back('\0');
+        }
+        if (request.size() > ZYGOTE_MAX_MESSAGE) {
+            throw ChildProcessException("Spawn request too large for zygote!");
+        }
+
+        struct iovec iov {};
+        iov.iov_base = &request[0];
+        iov.iov_len = request.size();
+        union {
+            struct cmsghdr header;
+            char data[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)];
+        } control{};
+        struct msghdr msg {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (!fds.empty()) {
+            msg.msg_control = &control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+        }
+        if (sendmsg(sock, &msg, MSG_NOSIGNAL) == -1) {
+            stop();
+            throw ChildProcessException("Couldn't send spawn request to zygote!");
+        }
+        int32_t reply = 0;
+        auto size = recv(sock, &reply, sizeof(reply), 0);
+        if (size != sizeof(reply)) {
+            if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                // Still alive but stuck, it can't be reaped before it's gone
+                kill(pid, SIGKILL);
+            }
+            stop();
+            throw ChildProcessException("Zygote didn't answer spawn request!");
+        }
+        if (reply <= 0) {
+            throw ChildProcessException("Zygote couldn't fork!");
+        }
+        return static_cast<pid_t>(reply);
+    }
+
+    void Zygote::serve() noexcept {
+        std::vector<char> buf(ZYGOTE_MAX_MESSAGE + 1);
+        while (true) {
+            struct iovec iov {};
+            iov.iov_base = buf.data();
+            iov.iov_len = ZYGOTE_MAX_MESSAGE;
+            union {
+                struct cmsghdr header;
+                char data[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)];
+            } control{};
+            struct msghdr msg {};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = &control;
+            msg.msg_controllen = sizeof(control);
+            auto size = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+            if (size == -1 && errno == EINTR) {
+                continue;
+            }
+            if (size <= 0) {
+                // scinit is gone or doesn't need us anymore
+                _exit(0);
+            }
+
+            int fds[ZYGOTE_MAX_FDS];
+            size_t num_fds = 0;
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    std::memcpy(static_cast<int*>(fds), CMSG_DATA(cmsg), sizeof(int) * num_fds);
+                }
+            }
+
+            // Split the request into pointers for execvpe, the strings stay in 'buf'
+            RequestHeader header{};
+            std::memcpy(&header, buf.data(), sizeof(header));
+            buf[static_cast<size_t>(size)] = '\0';
+            std::vector<char*> argv, envp;
+            char* cursor = buf.data() + sizeof(header);
+            char* end = buf.data() + size;
+            char* path = cursor;
+            cursor += std::strlen(cursor) + 1;
+            argv.push_back(path);
+            for (uint32_t i = 0; i < header.args + header.environment && cursor < end; i++) {
+                (i < header.args ? argv : envp).push_back(cursor);
+                cursor += std::strlen(cursor) + 1;
+            }
+            argv.push_back(nullptr);
+            envp.push_back(nullptr);
+
+            auto child = static_cast<pid_t>(syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0));
+            if (child == 0) {
+                close(sock);
+                if (num_fds < 2 || !install_fds(static_cast<int*>(fds), num_fds)) {
+                    _exit(-1);
+                }
+                std::string listen_pid;
+                if (header.listen_pid != 0 && envp.size() > 1) {
+                    listen_pid = std::string(envp[envp.size() - 2]) + std::to_string(getpid());
+                    envp[envp.size() - 2] = &listen_pid[0];
+                }
+                // Don't hand down the signals scinit blocks for its signalfd
+                sigset_t empty;
+                sigemptyset(&empty);
+                sigprocmask(SIG_SETMASK, &empty, nullptr);
+                execvpe(path, argv.data(), envp.data());
+                LOG->critical("Could not exec child process: {0}", std::strerror(errno));
+                _exit(-1);
+            }
+            for (size_t i = 0; i < num_fds; i++) {
+                close(fds[i]);
+            }
+            int32_t reply = child == -1 ? -errno : child;
+            if (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) == -1) {
+                _exit(0);
+            }
+        }
+    }
+}  // namespace scinit
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CINIT_ZYGOTE_H
+#define CINIT_ZYGOTE_H
+
+#include <sys/types.h>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace scinit {
+    /*
+     * Pre-fork helper for one program definition. The zygote is forked from scinit once, drops privileges and then
+     * waits for spawn requests on a socketpair. For each request it clones itself with CLONE_PARENT, so the new
+     * process is a child of scinit (which reaps it and gets SIGCHLD as usual), and the clone execs the program.
+     * This takes the privilege drop and the fork of the large scinit process out of every start, which is what
+     * makes starting many instances of the same program cheap.
+     *
+     * Requests carry the path, argv and environment as NUL separated strings and the file descriptors for stdout,
+     * stderr and the listening sockets as SCM_RIGHTS. The reply is the PID of the new process.
+     */
+    class Zygote {
+      public:
+        explicit Zygote(std::string name) noexcept;
+        Zygote(const Zygote&) = delete;
+        Zygote& operator=(const Zygote&) = delete;
+        // Closing our end of the socketpair makes the zygote exit
+        ~Zygote();
+
+        /*
+         * Fork the zygote. 'prepare' runs in the zygote before it serves any request (this is where privileges
+         * are dropped), if it returns false the zygote exits.
+         */
+        void start(const std::function<bool()>& prepare) noexcept(false);
+        bool is_running() const noexcept { return sock != -1; }
+
+        /*
+         * Spawn 'path'. fds[0] and fds[1] become stdout and stderr, further fds are passed on starting at fd 3.
+         * If 'listen_pid' is set, the PID of the new process is appended to the last environment variable.
+         * Throws if the zygote is gone, it has to be started again in that case.
+         */
+        pid_t spawn(const std::string& path, const std::list<std::string>& args,
+                    const std::list<std::string>& environment, const std::vector<int>& fds,
+                    bool listen_pid) noexcept(false);
+
+      private:
+        [[noreturn]] void serve() noexcept;
+        void stop() noexcept;
+
+        std::string name;
+        int sock = -1;
+        pid_t pid = -1;
+    };
+}  // namespace scinit
+
+#endif  // CINIT_ZYGOTE_H
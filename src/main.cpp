@@ -17,24 +17,73 @@
 #include <sys/epoll.h>
 #include <sys/signalfd.h>
 #include <sys/wait.h>
+#include <unistd.h>
 #include <csignal>
+#include <iomanip>
 #include <iostream>
 #include <mutex>
 #include "ChildProcess.h"
 #include "ChildProcessException.h"
 #include "Config.h"
 #include "ProcessHandler.h"
+#include "RingFile.h"
 #include "log.h"
 
 #define MAX_EVENTS 10
 #define BUF_SIZE 4096
+#define TAIL_POLL_INTERVAL_US 200000
+
+// Print the records of a ring file, waiting for new ones if 'follow' is set
+int tail_ring_file(const std::string& path, bool follow) {
+    std::unique_ptr<scinit::RingFile::Reader> reader;
+    try {
+        reader = std::make_unique<scinit::RingFile::Reader>(path);
+    } catch (scinit::ChildProcessException& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    scinit::RingFile::Record record;
+    uint64_t skipped = 0;
+    while (true) {
+        while (reader->next(record)) {
+            char stamp[32];
+            struct tm local {};
+            auto seconds = static_cast<time_t>(record.time_ns / 1000000000);
+            localtime_r(&seconds, &local);
+            strftime(static_cast<char*>(stamp), sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+            std::cout << "[" << static_cast<char*>(stamp) << "." << std::setw(3) << std::setfill('0')
+                      << record.time_ns / 1000000 % 1000 << "] [" << record.program << "] "
+                      << (record.stream == scinit::RingFile::STDERR ? "[stderr] " : "") << record.message << "\n";
+        }
+        std::cout.flush();
+        if (reader->get_skipped() > skipped) {
+            std::cerr << "(" << reader->get_skipped() - skipped << " bytes overwritten before they were read)"
+                      << std::endl;
+            skipped = reader->get_skipped();
+        }
+        if (!follow) {
+            return 0;
+        }
+        usleep(TAIL_POLL_INTERVAL_US);
+    }
+}
 
 std::unique_ptr<scinit::Config<scinit::ChildProcess>> handle_commandline_invocation(
-  int argc, char** argv, const std::shared_ptr<scinit::ProcessHandlerInterface>& handler) noexcept(false) {
+  int argc, char** argv, const std::shared_ptr<scinit::ProcessHandler>& handler) noexcept(false) {
     po::options_description desc("Options");
     desc.add_options()("help", "print this message")("config", po::value<std::string>()->default_value("config.yml"),
                                                      "path to config file")(
-      "verbose", po::value<bool>()->default_value(false), "be verbose");
+      "verbose", po::value<bool>()->default_value(false), "be verbose")(
+      "max-parallel-starts", po::value<unsigned int>()->default_value(0),
+      "number of programs that may be starting at once, 0 for no limit")(
+      "prefetch", po::value<bool>()->default_value(false),
+      "read executables and libraries of waiting programs into the page cache")(
+      "sample-interval", po::value<unsigned int>()->default_value(10),
+      "seconds between CPU and memory samples of running programs, 0 to disable")(
+      "log-format", po::value<std::string>()->default_value("text"),
+      "'text' or 'json' (program output as one JSON object per line on stdout, scinit's own messages on stderr)")(
+      "tail", po::value<std::string>(), "print the records in a ring file and exit")(
+      "follow", po::value<bool>()->default_value(false), "with --tail, keep printing new records");
     po::variables_map options;
     po::store(po::parse_command_line(argc, argv, desc), options);
     po::notify(options);
@@ -43,8 +92,17 @@ std::unique_ptr<scinit::Config<scinit::ChildProcess>> handle_commandline_invocat
         std::cout << desc << std::endl;
         exit(0);
     }
+    if (options.count("tail")) {
+        exit(tail_ring_file(options["tail"].as<std::string>(), options["follow"].as<bool>()));
+    }
 
-    auto console = spdlog::stdout_color_st("scinit");
+    auto log_format = options["log-format"].as<std::string>();
+    if (log_format != "text" && log_format != "json") {
+        std::cerr << "Unknown log format '" << log_format << "', expected 'text' or 'json'" << std::endl;
+        return nullptr;
+    }
+    // Keep stdout free for the JSON lines
+    auto console = log_format == "json" ? spdlog::stderr_color_st("scinit") : spdlog::stdout_color_st("scinit");
     console->set_pattern("[%^%n%$] [%H:%M:%S.%e] [%l] %v");
     if (options["verbose"].as<bool>()) {
         console->set_level(spdlog::level::debug);
@@ -52,6 +110,13 @@ std::unique_ptr<scinit::Config<scinit::ChildProcess>> handle_commandline_invocat
         console->set_level(spdlog::level::info);
     }
 
+    handler->set_max_parallel_starts(options["max-parallel-starts"].as<unsigned int>());
+    handler->set_prefetch(options["prefetch"].as<bool>());
+    handler->set_sample_interval(options["sample-interval"].as<unsigned int>());
+    if (log_format == "json") {
+        handler->set_json_output(STDOUT_FILENO);
+    }
+
     auto config = options["config"].as<std::string>();
     // Check whether 'config' is a file or a directory
     fs::path config_path(config);
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * JSON log writer benchmark: formats lines the way --log-format=json does and writes them to /dev/null (or the file
+ * given as the third argument), reporting lines and bytes per second. Every third message needs escaping. The
+ * number of heap allocations during the run is counted to show that the writer doesn't allocate per line.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "../../src/JsonLogWriter.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+    std::atomic<unsigned long> allocations(0);
+}
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* memory = std::malloc(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, size_t /*size*/) noexcept { std::free(memory); }
+
+int main(int argc, char** argv) {
+    unsigned long lines = 5000000, batch = 16;
+    std::string output = "/dev/null";
+    if (argc > 1) {
+        lines = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        batch = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        output = argv[3];
+    }
+    int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Couldn't open " << output << std::endl;
+        return 1;
+    }
+    std::vector<std::string> messages = {
+      "GET /api/v1/users/1234 200 1.2ms",
+      "worker started, waiting for jobs on queue 'default'",
+      "{\"level\":\"warn\",\"msg\":\"slow query\",\"path\":\"C:\\\\data\"}\tretrying",
+    };
+    unsigned long bytes = 0;
+    for (unsigned long i = 0; i < lines; i++) {
+        bytes += messages[i % messages.size()].size();
+    }
+
+    auto writer = std::make_unique<scinit::JsonLogWriter>(fd);
+    scinit::JsonLogWriter::Record record;
+    record.program = "worker@3";
+    record.instance = 3;
+    record.pid = 4242;
+    auto allocations_before = allocations.load();
+    auto start = bench_clock::now();
+    for (unsigned long i = 0; i < lines; i++) {
+        const auto& message = messages[i % messages.size()];
+        // The event loop takes the time once per read
+        if (i % batch == 0) {
+            scinit::JsonLogWriter::stamp(record);
+        }
+        record.stream = i % 5 == 0 ? scinit::JsonLogWriter::STDERR : scinit::JsonLogWriter::STDOUT;
+        record.message = message.data();
+        record.length = message.size();
+        writer->write(record);
+        // ... and writes everything it read at once
+        if (i % batch == batch - 1) {
+            writer->flush();
+        }
+    }
+    writer->flush();
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    auto allocated = allocations.load() - allocations_before;
+    close(fd);
+
+    std::cout << "Lines:                 " << lines << " (flushed every " << batch << ")" << std::endl;
+    std::cout << "Elapsed:               " << elapsed.count() << " s" << std::endl;
+    std::cout << "Lines per second:      " << static_cast<double>(lines) / elapsed.count() << std::endl;
+    std::cout << "Message MB per second: " << static_cast<double>(bytes) / elapsed.count() / 1e6 << std::endl;
+    std::cout << "Allocations:           " << allocated << std::endl;
+    return 0;
+}
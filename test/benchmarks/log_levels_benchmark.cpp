@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Level detection benchmark: runs the detector over typical lines of each recognized format and over lines without
+ * any marker (which have to be scanned completely), reporting nanoseconds per line for each.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../../src/LogLevels.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+    // Only looks at the first byte, to tell the cost of the loop itself
+    bool first_byte(const char* line, size_t length, spdlog::level::level_enum& level) noexcept {
+        if (length > 0 && line[0] == '!') {
+            level = spdlog::level::err;
+            return true;
+        }
+        return false;
+    }
+
+    // Nanoseconds per line, 'found' counts the lines with a level so that the loop can't be optimized away
+    template <typename Detector>
+    double measure(const std::vector<std::string>& lines, unsigned long iterations, unsigned long& found,
+                   Detector detect) {
+        auto start = bench_clock::now();
+        for (unsigned long i = 0, next = 0; i < iterations; i++) {
+            const auto& line = lines[next];
+            next = next + 1 == lines.size() ? 0 : next + 1;
+            auto level = spdlog::level::info;
+            found += detect(line.data(), line.size(), level) ? 1 : 0;
+        }
+        std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned long iterations = 10000000;
+    if (argc > 1) {
+        iterations = std::stoul(argv[1]);
+    }
+    std::vector<std::string> json = {
+      R"({"level":"info","time":1527854400000,"pid":42,"msg":"request finished","status":200,"ms":12})",
+      R"({"time":"2018-06-01T12:00:00Z","severity":"ERROR","message":"couldn't connect to 10.0.0.7:5432"})",
+      R"({"level":30,"time":1527854400000,"msg":"pino style"})",
+    };
+    std::vector<std::string> prefixed = {
+      "E0601 12:00:00.123456  4242 server.cc:123] Couldn't bind to port 8080",
+      "ERROR:root:Traceback follows",
+      "2018-06-01 12:00:00,123 [WARN] pool: 12 idle, 4 active, 0 waiting",
+      "time=2018-06-01T12:00:00Z level=debug msg=\"tick\" worker=3",
+    };
+    std::vector<std::string> plain = {
+      "GET /api/v1/users/1234 200 1.2ms",
+      "worker started, waiting for jobs on queue 'default' with a concurrency of 8 and a prefetch of 16 messages",
+      "Error connecting to the database, retrying in 5 seconds",
+    };
+
+    unsigned long found = 0;
+    auto json_ns = measure(json, iterations, found, scinit::levels::detect);
+    auto prefixed_ns = measure(prefixed, iterations, found, scinit::levels::detect);
+    auto plain_ns = measure(plain, iterations, found, scinit::levels::detect);
+    auto overhead_ns = measure(plain, iterations, found, first_byte);
+
+    std::cout << "Lines per format:      " << iterations << " (" << found << " with a level)" << std::endl;
+    std::cout << "JSON ns per line:      " << json_ns << std::endl;
+    std::cout << "Prefixed ns per line:  " << prefixed_ns << std::endl;
+    std::cout << "No level ns per line:  " << plain_ns << std::endl;
+    std::cout << "Loop ns per line:      " << overhead_ns << " (included above)" << std::endl;
+    return 0;
+}
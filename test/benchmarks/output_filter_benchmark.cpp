@@ -0,0 +1,92 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Output filter benchmark: runs a typical rule set (prefix, substring and regex rules) over a mix of log lines and
+ * compares the time per line with formatting the same lines as JSON (to /dev/null), i.e. what a dropped line saves.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../src/JsonLogWriter.h"
+#include "../../src/OutputFilter.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    unsigned long lines = 2000000;
+    if (argc > 1) {
+        lines = std::stoul(argv[1]);
+    }
+    std::vector<std::string> messages = {
+      "GET /healthz 200 0.1ms",
+      "DEBUG pool: 12 idle, 4 active, 0 waiting",
+      "GET /api/v1/users/1234 200 1.2ms",
+      "worker started, waiting for jobs on queue 'default'",
+      "ERROR couldn't connect to 10.0.0.7:5432: connection refused",
+      "INFO request finished in 12ms, 4 queries, cache hit ratio 0.93",
+    };
+
+    scinit::OutputFilter filter;
+    filter.add_rule(scinit::OutputFilter::KEEP, scinit::OutputFilter::PREFIX, "ERROR");
+    filter.add_rule(scinit::OutputFilter::DROP, scinit::OutputFilter::PREFIX, "DEBUG");
+    filter.add_rule(scinit::OutputFilter::DROP, scinit::OutputFilter::SUBSTRING, "cache hit ratio");
+    filter.add_rule(scinit::OutputFilter::DROP, scinit::OutputFilter::REGEX, "^GET /health(z)? 200");
+
+    unsigned long kept = 0;
+    auto start = bench_clock::now();
+    for (unsigned long i = 0; i < lines; i++) {
+        const auto& message = messages[i % messages.size()];
+        kept += filter.keep(message.data(), message.size()) ? 1 : 0;
+    }
+    std::chrono::duration<double, std::nano> filter_elapsed = bench_clock::now() - start;
+
+    int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    auto writer = std::make_unique<scinit::JsonLogWriter>(fd);
+    scinit::JsonLogWriter::Record record;
+    record.program = "worker@3";
+    record.instance = 3;
+    record.pid = 4242;
+    start = bench_clock::now();
+    for (unsigned long i = 0; i < lines; i++) {
+        const auto& message = messages[i % messages.size()];
+        if (i % 16 == 0) {
+            scinit::JsonLogWriter::stamp(record);
+        }
+        record.message = message.data();
+        record.length = message.size();
+        writer->write(record);
+        if (i % 16 == 15) {
+            writer->flush();
+        }
+    }
+    writer->flush();
+    std::chrono::duration<double, std::nano> format_elapsed = bench_clock::now() - start;
+    writer.reset();
+    close(fd);
+
+    auto count = static_cast<double>(lines);
+    std::cout << "Lines:                 " << lines << " (" << kept << " kept)" << std::endl;
+    std::cout << "Filter ns per line:    " << filter_elapsed.count() / count << std::endl;
+    std::cout << "JSON ns per line:      " << format_elapsed.count() / count << std::endl;
+    std::cout << "Filter/JSON ratio:     " << filter_elapsed.count() / format_elapsed.count() << std::endl;
+    return 0;
+}
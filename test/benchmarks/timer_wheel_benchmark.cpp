@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Timer wheel benchmark: measures schedule/cancel throughput with a realistic mix of short (stop timeouts,
+ * backoff) and long (watchdog) timers, and the worst case time a single advance() takes, which is what the event
+ * loop pays per wakeup.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../../src/TimerWheel.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    unsigned long operations = 4000000, max_pending = 10000;
+    if (argc > 1) {
+        operations = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        max_pending = std::stoul(argv[2]);
+    }
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<uint64_t> delay(1, 60000);
+    std::vector<scinit::TimerWheel::TimerId> ids;
+    ids.reserve(max_pending);
+
+    uint64_t now = 0;
+    scinit::TimerWheel wheel(now, 10);
+    unsigned long fired = 0;
+    auto callback = [&fired]() { fired++; };
+
+    /*
+     * Insert and cancel (most supervisor timers are cancelled before they fire), keeping roughly 'max_pending'
+     * timers alive. Time advances by 1ms every 64 operations.
+     */
+    for (unsigned long i = 0; i < max_pending; i++) {
+        ids.push_back(wheel.schedule(now, delay(rng), callback));
+    }
+    std::vector<double> advance_us;
+    auto start = bench_clock::now();
+    for (unsigned long i = 0; i < operations; i++) {
+        if (i % 2 == 1 && !ids.empty()) {
+            auto victim = rng() % ids.size();
+            wheel.cancel(ids[victim]);
+            ids[victim] = ids.back();
+            ids.pop_back();
+        } else {
+            ids.push_back(wheel.schedule(now, delay(rng), callback));
+        }
+        if (i % 64 == 0) {
+            now++;
+            auto before = bench_clock::now();
+            wheel.advance(now);
+            std::chrono::duration<double, std::micro> took = bench_clock::now() - before;
+            advance_us.push_back(took.count());
+        }
+    }
+    std::chrono::duration<double> elapsed = bench_clock::now() - start;
+    std::sort(advance_us.begin(), advance_us.end());
+
+    std::cout << "Timer operations:      " << operations << std::endl;
+    std::cout << "Elapsed:               " << elapsed.count() << " s" << std::endl;
+    std::cout << "Operations per second: " << static_cast<double>(operations) / elapsed.count() << std::endl;
+    std::cout << "Pending timers:        ~" << max_pending << std::endl;
+    std::cout << "advance() p50:         " << advance_us[advance_us.size() / 2] << " us" << std::endl;
+    std::cout << "advance() p99:         " << advance_us[advance_us.size() * 99 / 100] << " us" << std::endl;
+    std::cout << "advance() max:         " << advance_us.back() << " us" << std::endl;
+    std::cout << "Timers fired:          " << fired << std::endl;
+    return 0;
+}
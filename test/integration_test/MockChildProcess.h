@@ -31,11 +31,12 @@ namespace scinit {
                                  const std::shared_ptr<ProcessHandlerInterface>& handler, std::list<std::string> before,
                                  std::list<std::string> after, bool want_tty, bool want_default_env,
                                  std::list<std::string> env_extra_whitelist,
-                                 std::list<std::pair<std::string, std::string>> env_extra_vars)
+                                 std::list<std::pair<std::string, std::string>> env_extra_vars,
+                                 ProgramOptions options = {})
                   : ChildProcess(std::move(name), std::move(path), std::move(args), std::move(type),
                                  std::move(capabilities), uid, gid, graph_id, std::move(handler), std::move(before),
                                  std::move(after), want_tty, want_default_env, std::move(env_extra_whitelist),
-                                 std::move(env_extra_vars)){};
+                                 std::move(env_extra_vars), std::move(options)){};
 
               protected:
                 bool handle_caps() override { return true; };
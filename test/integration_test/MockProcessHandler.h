@@ -43,6 +43,13 @@ namespace scinit {
                             case FDType::STDERR:
                                 stderr += str;
                                 break;
+                            case FDType::LISTEN:
+                                FAIL() << "Output on a listening socket";
+                            case FDType::MEMORY_EVENTS:
+                                FAIL() << "Output on a cgroup file";
+                            case FDType::PASSTHROUGH_STDOUT:
+                            case FDType::PASSTHROUGH_STDERR:
+                                FAIL() << "Passthrough output is not logged";
                         }
                     } else {
                         FAIL() << "Couldn't load object from list";
@@ -27,17 +27,31 @@ namespace scinit {
             class MockChildProcess : public ChildProcessInterface {
               public:
                 MOCK_CONST_METHOD0(get_name, std::string());
+                MOCK_CONST_METHOD0(get_group_name, std::string());
+                MOCK_CONST_METHOD0(get_path, std::string());
                 MOCK_CONST_METHOD0(get_id, unsigned int());
+                MOCK_CONST_METHOD0(get_type, ProcessType());
                 MOCK_CONST_METHOD0(can_start_now, bool());
+                MOCK_CONST_METHOD0(get_options, const ProgramOptions &());
+                MOCK_CONST_METHOD0(get_start_count, unsigned int());
+                MOCK_CONST_METHOD0(get_dependencies, std::list<unsigned int>());
                 MOCK_METHOD1(notify_of_state, void(std::map<unsigned int, std::weak_ptr<ChildProcessInterface>>));
                 MOCK_METHOD1(propagate_dependencies, void(std::list<std::weak_ptr<ChildProcessInterface>>));
                 MOCK_METHOD2(handle_process_event, void(ProcessHandlerInterface::ProcessEvent, int));
                 MOCK_METHOD2(should_wait_for, void(unsigned int, ProcessState));
+                MOCK_METHOD0(bind_sockets, void());
+                MOCK_METHOD1(stop, void(bool));
+                MOCK_METHOD1(set_parked, void(bool));
+                MOCK_CONST_METHOD0(is_parked, bool());
+                MOCK_METHOD1(set_paused, void(bool));
+                MOCK_CONST_METHOD0(is_paused, bool());
                 MOCK_CONST_METHOD0(get_state, ProcessState());
 
                 MOCK_METHOD1(do_fork, void(std::map<int, unsigned int> &));
                 MOCK_METHOD3(register_with_epoll, void(int, std::map<int, unsigned int> &,
                                                        std::map<int, ProcessHandlerInterface::FDType> &));
+                MOCK_METHOD3(wait_for_activation, void(int, std::map<int, unsigned int> &,
+                                                       std::map<int, ProcessHandlerInterface::FDType> &));
             };
         }
     }
@@ -31,13 +31,15 @@ namespace scinit {
                                  const std::shared_ptr<ProcessHandlerInterface>& handler, std::list<std::string> before,
                                  std::list<std::string> after, bool want_tty, bool want_default_env,
                                  std::list<std::string> env_extra_whitelist,
-                                 std::list<std::pair<std::string, std::string>> env_extra_vars)
+                                 std::list<std::pair<std::string, std::string>> env_extra_vars,
+                                 ProgramOptions options = {})
                   : ChildProcess(std::move(name), std::move(path), std::move(args), std::move(type),
                                  std::move(capabilities), uid, gid, graph_id, std::move(handler), std::move(before),
                                  std::move(after), want_tty, want_default_env, std::move(env_extra_whitelist),
-                                 std::move(env_extra_vars)){};
+                                 std::move(env_extra_vars), std::move(options)){};
 
                 MOCK_METHOD1(do_fork, void(std::map<int, unsigned int>&));
+                MOCK_METHOD1(stop, void(bool));
                 MOCK_METHOD3(register_with_epoll, void(int epoll_fd, std::map<int, unsigned int>& map,
                                                        std::map<int, ProcessHandlerInterface::FDType>&));
             };
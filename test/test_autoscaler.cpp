@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "../src/Autoscaler.h"
+
+namespace scinit {
+    class AutoscalerTests : public testing::Test {};
+
+    TEST_F(AutoscalerTests, ScalesUpAfterSustainedLoad) {
+        Autoscaler uut(1, 4, 1, 50, 10, 3, 0);
+        ASSERT_EQ(uut.update(0, 80), 1);
+        ASSERT_EQ(uut.update(1000, 80), 1);
+        ASSERT_EQ(uut.update(2000, 80), 2);
+        // A single dip resets the count
+        ASSERT_EQ(uut.update(3000, 80), 2);
+        ASSERT_EQ(uut.update(4000, 30), 2);
+        ASSERT_EQ(uut.update(5000, 80), 2);
+        ASSERT_EQ(uut.update(6000, 80), 2);
+        ASSERT_EQ(uut.update(7000, 80), 3);
+    }
+
+    TEST_F(AutoscalerTests, HysteresisBandKeepsInstanceCount) {
+        Autoscaler uut(1, 4, 2, 50, 10, 1, 0);
+        for (uint64_t now = 0; now < 100000; now += 1000) {
+            ASSERT_EQ(uut.update(now, 30), 2);
+        }
+        ASSERT_EQ(uut.update(100000, 5), 1);
+        ASSERT_EQ(uut.update(101000, 5), 1) << "Scaled below min_instances";
+    }
+
+    TEST_F(AutoscalerTests, CooldownLimitsChanges) {
+        Autoscaler uut(1, 8, 1, 50, 10, 1, 30000);
+        ASSERT_EQ(uut.update(0, 90), 2);
+        ASSERT_EQ(uut.update(1000, 90), 2);
+        ASSERT_EQ(uut.update(29999, 90), 2);
+        ASSERT_EQ(uut.update(30000, 90), 3);
+        // Pressure triggers skip the sustain count, but not the cooldown
+        ASSERT_EQ(uut.urgent(31000), 3);
+        ASSERT_EQ(uut.urgent(60000), 4);
+    }
+
+    TEST_F(AutoscalerTests, StaysWithinBounds) {
+        Autoscaler uut(2, 3, 10, 50, 10, 1, 0);
+        ASSERT_EQ(uut.get_instances(), 3);
+        ASSERT_EQ(uut.update(0, 100), 3);
+        ASSERT_EQ(uut.update(1, 0), 2);
+        ASSERT_EQ(uut.update(2, 0), 2);
+    }
+}  // namespace scinit
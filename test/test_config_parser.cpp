@@ -17,6 +17,8 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <boost/filesystem.hpp>
+#include <fstream>
+#include <regex>
 #include "../src/ChildProcess.h"
 #include "../src/Config.h"
 #include "../src/ProcessHandler.h"
@@ -232,4 +234,291 @@ namespace scinit {
             }
         }
     }
-}  // namespace scinit
\ No newline at end of file
+
+    TEST_F(ConfigParserTests, ConfigWithRequires) {
+        test_resource /= "config-with-requires.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 2);
+        for (auto &weak_proc : procs) {
+            if (const auto &proc_base = weak_proc.lock().get()) {
+                if (auto proc = dynamic_cast<ChildProcess *>(proc_base)) {
+                    if (proc->get_name() == "setup") {
+                        ASSERT_EQ(proc->type, ChildProcess::ProcessType::ONESHOT);
+                        ASSERT_THAT(proc->options.required, ::testing::IsEmpty());
+                        ASSERT_EQ(proc->options.start_timeout, 0);
+                    } else if (proc->get_name() == "server") {
+                        ASSERT_EQ(proc->type, ChildProcess::ProcessType::SIMPLE);
+                        ASSERT_THAT(proc->options.required, ::testing::ElementsAre("setup"));
+                        ASSERT_EQ(proc->options.start_timeout, 30);
+                    } else {
+                        FAIL() << "Found unexpected program element";
+                    }
+                }
+            } else {
+                FAIL() << "Couldn't lock weak_ref!";
+            }
+        }
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithSockets) {
+        test_resource /= "config-with-sockets.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 1);
+        auto proc = dynamic_cast<ChildProcess *>(procs.begin()->lock().get());
+        ASSERT_NE(proc, nullptr);
+        ASSERT_EQ(proc->options.sockets.size(), 2);
+        auto tcp = proc->options.sockets.front();
+        ASSERT_EQ(tcp->get_name(), "http");
+        ASSERT_EQ(tcp->get_type(), ListenSocket::SocketType::TCP);
+        ASSERT_EQ(tcp->describe(), "tcp:127.0.0.1:8080");
+        auto unix_socket = proc->options.sockets.back();
+        ASSERT_EQ(unix_socket->get_name(), "server");
+        ASSERT_EQ(unix_socket->get_type(), ListenSocket::SocketType::UNIX);
+        ASSERT_EQ(unix_socket->describe(), "unix:/tmp/scinit-test.sock");
+        // Sockets are bound by the process handler, not while parsing
+        ASSERT_EQ(tcp->get_fd(), -1);
+        ASSERT_EQ(unix_socket->get_fd(), -1);
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithOnDemandActivation) {
+        test_resource /= "config-with-on-demand.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 2);
+        auto server = dynamic_cast<ChildProcess *>(procs.front().lock().get());
+        ASSERT_NE(server, nullptr);
+        ASSERT_TRUE(server->options.on_demand);
+        ASSERT_EQ(server->options.idle_timeout, 30);
+        ASSERT_EQ(server->options.stop_timeout, 5);
+        // Not started before the first connection
+        ASSERT_FALSE(server->can_start_now());
+        // Without sockets there is nothing to wait on
+        auto no_sockets = dynamic_cast<ChildProcess *>(procs.back().lock().get());
+        ASSERT_NE(no_sockets, nullptr);
+        ASSERT_FALSE(no_sockets->options.on_demand);
+        ASSERT_EQ(no_sockets->options.stop_timeout, 10);
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithInstances) {
+        test_resource /= "config-with-instances.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 5);
+        std::map<std::string, std::shared_ptr<ChildProcessInterface>> by_name;
+        for (auto &weak_proc : procs) {
+            auto proc = weak_proc.lock();
+            ASSERT_NE(proc, nullptr);
+            by_name[proc->get_name()] = proc;
+        }
+        for (unsigned int i = 0; i < 3; i++) {
+            auto name = "worker@" + std::to_string(i);
+            ASSERT_EQ(by_name.count(name), 1) << "Missing instance " << name;
+            auto proc = dynamic_cast<ChildProcess *>(by_name[name].get());
+            ASSERT_EQ(proc->get_group_name(), "worker");
+            ASSERT_EQ(proc->options.instance, i);
+            ASSERT_THAT(proc->args, ::testing::ElementsAre("--port", "80" + std::to_string(i)));
+            // One zygote per program entry
+            ASSERT_NE(proc->options.zygote, nullptr);
+            ASSERT_EQ(proc->options.zygote, by_name["worker@0"]->get_options().zygote);
+        }
+        ASSERT_EQ(by_name["balancer"]->get_group_name(), "balancer");
+        ASSERT_EQ(by_name["balancer"]->get_options().zygote, nullptr);
+
+        // 'worker' addresses the whole group, 'worker@1' a single instance
+        for (auto &proc : procs) {
+            proc.lock()->propagate_dependencies(procs);
+        }
+        ASSERT_EQ(by_name["balancer"]->get_dependencies().size(), 3);
+        ASSERT_THAT(by_name["monitor"]->get_dependencies(),
+                    ::testing::ElementsAre(by_name["worker@1"]->get_id()));
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithResourceLimits) {
+        test_resource /= "config-with-resource-limits.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 2);
+        auto database = dynamic_cast<ChildProcess *>(procs.front().lock().get());
+        ASSERT_EQ(database->name, "database");
+        ASSERT_TRUE(database->options.has_resource_limits());
+        ASSERT_EQ(database->options.memory_max, "512M");
+        ASSERT_EQ(database->options.memory_high, "384M");
+        ASSERT_EQ(database->options.cpu_weight, 200);
+        ASSERT_DOUBLE_EQ(database->options.cpu_max, 1.5);
+        ASSERT_EQ(database->options.io_weight, 500);
+        ASSERT_EQ(database->options.pids_max, 64);
+        ASSERT_EQ(database->options.restart, ProgramOptions::ON_FAILURE);
+        ASSERT_EQ(database->options.max_rss_kib, 1024 * 1024);
+        ASSERT_EQ(database->options.max_rss_growth_kib_per_hour, 64 * 1024);
+
+        auto batch = dynamic_cast<ChildProcess *>(procs.back().lock().get());
+        ASSERT_FALSE(batch->options.has_resource_limits());
+        ASSERT_EQ(batch->options.restart, ProgramOptions::ALWAYS);
+        ASSERT_EQ(batch->options.max_rss_kib, 0);
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithLogFiles) {
+        test_resource /= "config-with-log-files.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto procs = uut.get_processes();
+        ASSERT_EQ(procs.size(), 4);
+        auto proc = procs.begin();
+        auto web = dynamic_cast<ChildProcess *>((proc++)->lock().get());
+        ASSERT_EQ(web->options.log_file.combined, "/var/log/web.log");
+        ASSERT_TRUE(web->options.log_file.stdout_path.empty());
+        ASSERT_EQ(web->options.log_file.rotate_bytes, 0);
+        ASSERT_EQ(web->options.log_file.retain, 5);
+        ASSERT_EQ(web->options.crash_log_lines, 50);
+        ASSERT_EQ(web->options.crash_log_bytes, 65536);
+        ASSERT_TRUE(web->options.filter);
+        ASSERT_TRUE(web->options.filter->keep("ERROR GET /health", 17));
+        ASSERT_FALSE(web->options.filter->keep("GET /health 200", 15));
+        ASSERT_EQ(web->options.sample_every, 0);
+        ASSERT_EQ(web->options.max_lines_per_second, 1000);
+
+        auto worker = dynamic_cast<ChildProcess *>((proc++)->lock().get());
+        ASSERT_TRUE(worker->options.log_file.combined.empty());
+        ASSERT_EQ(worker->options.log_file.stdout_path, "/var/log/worker.out");
+        ASSERT_EQ(worker->options.log_file.stderr_path, "/var/log/worker.err");
+        ASSERT_EQ(worker->options.log_file.rotate_bytes, 10 * 1024 * 1024);
+        ASSERT_EQ(worker->options.log_file.rotate_interval, 86400);
+        ASSERT_EQ(worker->options.log_file.retain, 3);
+        ASSERT_EQ(worker->options.crash_log_lines, 100);
+        ASSERT_EQ(worker->options.crash_log_bytes, 16 * 1024);
+        ASSERT_FALSE(worker->options.syslog.enabled());
+        ASSERT_FALSE(worker->options.filter);
+        ASSERT_TRUE(worker->options.multiline.enabled);
+        ASSERT_TRUE(worker->options.multiline.pattern);
+        ASSERT_TRUE(std::regex_search("Caused by: x", *worker->options.multiline.pattern));
+        ASSERT_FALSE(std::regex_search("Exception: x", *worker->options.multiline.pattern));
+        ASSERT_EQ(worker->options.multiline.timeout_ms, 250);
+        ASSERT_EQ(worker->options.multiline.max_bytes, 32 * 1024);
+        ASSERT_FALSE(web->options.multiline.enabled);
+
+        // stderr goes to syslog
+        auto vendor = dynamic_cast<ChildProcess *>((proc++)->lock().get());
+        ASSERT_EQ(vendor->options.log_file.stdout_path, "/var/log/vendor.out");
+        ASSERT_EQ(vendor->options.syslog.socket, "/dev/log");
+        ASSERT_EQ(vendor->options.syslog.facility, 19);
+        ASSERT_EQ(vendor->options.syslog.stdout_severity, 6);
+        ASSERT_EQ(vendor->options.syslog.stderr_severity, 3);
+        ASSERT_TRUE(vendor->options.detect_level);
+        ASSERT_EQ(vendor->options.min_level, spdlog::level::debug);
+        ASSERT_EQ(vendor->options.log_file.min_level, spdlog::level::info);
+        ASSERT_EQ(vendor->options.syslog.min_level, spdlog::level::warn);
+        ASSERT_FALSE(web->options.detect_level);
+        ASSERT_EQ(web->options.min_level, spdlog::level::trace);
+
+        auto daemon = dynamic_cast<ChildProcess *>((proc++)->lock().get());
+        ASSERT_TRUE(daemon->options.syslog.enabled());
+        ASSERT_EQ(daemon->options.syslog.facility, 3);
+        ASSERT_EQ(daemon->options.syslog.stderr_severity, 4);
+        ASSERT_FALSE(daemon->options.filter->keep("[DEBUG] tick", 12));
+        ASSERT_TRUE(daemon->options.filter->keep("[INFO] tick", 11));
+        ASSERT_TRUE(daemon->options.multiline.enabled);
+        ASSERT_FALSE(daemon->options.multiline.pattern);
+        ASSERT_EQ(daemon->options.multiline.timeout_ms, 100);
+        ASSERT_EQ(daemon->options.multiline.max_bytes, 65536);
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithScheduling) {
+        test_resource /= "config-with-scheduling.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        auto available = resources::allowed_cpus();
+        if (available.size() < 3) {
+            // Two exclusive CPUs and one for everything else
+            ASSERT_THROW(scinit::Config<ChildProcess>(test_resource.native(), handler), ConfigParseException);
+            return;
+        }
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        std::map<std::string, ChildProcess *> by_name;
+        for (auto &weak_proc : uut.get_processes()) {
+            auto proc = dynamic_cast<ChildProcess *>(weak_proc.lock().get());
+            by_name[proc->name] = proc;
+        }
+        ASSERT_EQ(by_name.size(), 4);
+
+        // Both instances share the two highest CPUs, 'batch' gets everything else
+        std::vector<unsigned int> exclusive(available.end() - 2, available.end()),
+          rest(available.begin(), available.end() - 2);
+        ASSERT_EQ(by_name["latency@0"]->options.scheduling, by_name["latency@1"]->options.scheduling);
+        ASSERT_EQ(by_name["latency@0"]->options.scheduling->get_cpus(), exclusive);
+        ASSERT_EQ(by_name["batch"]->options.scheduling->get_cpus(), rest);
+        ASSERT_THAT(by_name["pinned"]->options.scheduling->get_cpus(), ::testing::ElementsAre(0));
+        ASSERT_FALSE(by_name["batch"]->options.scheduling->empty());
+    }
+
+    TEST_F(ConfigParserTests, NumaTopologyIsReadFromSysfs) {
+        auto sysfs = fs::temp_directory_path() / fs::unique_path();
+        auto write = [](const fs::path &file, const std::string &content) {
+            fs::create_directories(file.parent_path());
+            std::ofstream(file.native()) << content << std::endl;
+        };
+        auto allowed = resources::allowed_cpus();
+        std::string cpulist;
+        for (auto cpu : allowed) {
+            cpulist += (cpulist.empty() ? "" : ",") + std::to_string(cpu);
+        }
+        // node1 only has CPUs we may not use, node2 has no memory
+        write(sysfs / "has_memory", "0-1");
+        write(sysfs / "node0" / "cpulist", cpulist);
+        write(sysfs / "node1" / "cpulist", "1000-1001");
+        write(sysfs / "node2" / "cpulist", cpulist);
+        auto nodes = resources::numa_nodes(sysfs.native());
+        fs::remove_all(sysfs);
+        ASSERT_EQ(nodes.size(), 1);
+        ASSERT_EQ(nodes[0].id, 0);
+        ASSERT_EQ(nodes[0].cpus, allowed);
+
+        std::vector<unsigned int> cpus;
+        ASSERT_TRUE(resources::parse_cpu_list("0-2,5", cpus));
+        ASSERT_THAT(cpus, ::testing::ElementsAre(0, 1, 2, 5));
+        ASSERT_FALSE(resources::parse_cpu_list("3-1", cpus));
+    }
+
+    TEST_F(ConfigParserTests, ConfigWithNumaSpread) {
+        test_resource /= "config-with-numa.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        scinit::Config<ChildProcess> uut(test_resource.native(), handler);
+        auto nodes = resources::numa_nodes();
+        unsigned int i = 0;
+        for (auto &weak_proc : uut.get_processes()) {
+            auto proc = dynamic_cast<ChildProcess *>(weak_proc.lock().get());
+            auto node = nodes.empty() ? 0 : nodes[i % nodes.size()].id;
+            ASSERT_EQ(proc->options.numa_node, node);
+            ASSERT_THAT(proc->args, ::testing::ElementsAre("--node", std::to_string(node)));
+            if (nodes.size() > 1) {
+                ASSERT_EQ(proc->options.scheduling->get_memory_node(), node);
+                ASSERT_EQ(proc->options.scheduling->get_cpus(), nodes[i % nodes.size()].cpus);
+            } else {
+                // Nothing to bind on a single node
+                ASSERT_EQ(proc->options.scheduling->get_memory_node(), -1);
+            }
+            i++;
+        }
+        ASSERT_EQ(i, 3);
+    }
+
+    TEST_F(ConfigParserTests, NumaSpreadNeedsInstances) {
+        test_resource /= "config-with-numa-single.yml";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        auto handler = std::make_shared<scinit::ProcessHandler>();
+        ASSERT_THROW(scinit::Config<ChildProcess>(test_resource.native(), handler), ConfigParseException);
+    }
+}  // namespace scinit
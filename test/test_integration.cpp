@@ -183,4 +183,37 @@ namespace scinit {
         ASSERT_EQ(handler->getStderr(), "");
         ASSERT_EQ(child_ptr->get_state(), ChildProcessInterface::ProcessState::DONE);
     }
+
+    TEST_F(IntegrationTests, TestSignalMask) {
+        auto test_program = fs::path(test_resource);
+        test_resource /= "test-sigmask.yml";
+        test_program = test_program.parent_path();
+        test_program = test_program.parent_path();
+        test_program /= "build";
+        test_program /= "test";
+        test_program /= "sigmaskdetect";
+        ASSERT_TRUE(fs::is_regular_file(test_resource)) << "Test resource missing";
+        ASSERT_TRUE(fs::is_regular_file(test_program)) << "Test resource missing";
+        auto handler = std::make_shared<MockProcessHandler>();
+        auto config = std::make_unique<scinit::Config<MockChildProcess>>(test_resource.native(), handler);
+        auto child_list = config->get_processes();
+        // Forked directly and spawned by a zygote
+        ASSERT_EQ(child_list.size(), 2);
+        for (const auto &child : child_list) {
+            dynamic_cast<MockChildProcess *>(child.lock().get())->path = test_program.native();
+        }
+
+        handler->register_processes(child_list);
+        handler->should_quit = true;
+        handler->enter_eventloop();
+        ASSERT_EQ(handler->getStderr(), "");
+        for (const auto &child : child_list) {
+            ASSERT_EQ(child.lock()->get_state(), ChildProcessInterface::ProcessState::DONE);
+        }
+        // scinit itself keeps them blocked for its signalfd
+        sigset_t blocked;
+        ASSERT_EQ(sigprocmask(SIG_BLOCK, nullptr, &blocked), 0);
+        ASSERT_TRUE(sigismember(&blocked, ProcessHandlerInterface::RELOAD_SIGNAL));
+        ASSERT_TRUE(sigismember(&blocked, ProcessHandlerInterface::USAGE_SIGNAL));
+        ASSERT_TRUE(sigismember(&blocked, ProcessHandlerInterface::DUMP_SIGNAL));
 }  // namespace scinit
\ No newline at end of file
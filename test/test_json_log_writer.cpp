@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include "../src/JsonLogWriter.h"
+
+namespace scinit {
+    class JsonLogWriterTests : public testing::Test {
+      protected:
+        FILE* file = nullptr;
+
+        void SetUp() override {
+            file = tmpfile();
+            ASSERT_NE(file, nullptr);
+        }
+
+        void TearDown() override { fclose(file); }
+
+        std::string contents() {
+            std::string data;
+            char buf[4096];
+            ssize_t count = 0;
+            off_t offset = 0;
+            while ((count = pread(fileno(file), static_cast<char*>(buf), sizeof(buf), offset)) > 0) {
+                data.append(static_cast<char*>(buf), static_cast<size_t>(count));
+                offset += count;
+            }
+            return data;
+        }
+
+        static std::string escape(const std::string& message) {
+            std::string out(message.size() * 6, '\0');
+            out.resize(JsonLogWriter::escape(message.data(), message.size(), &out[0]));
+            return out;
+        }
+    };
+
+    TEST_F(JsonLogWriterTests, EscapesControlCharactersQuotesAndBackslashes) {
+        ASSERT_EQ(escape("plain text"), "plain text");
+        ASSERT_EQ(escape("say \"hi\"\n"), "say \\\"hi\\\"\\n");
+        ASSERT_EQ(escape("C:\\path\ttab\r"), "C:\\\\path\\ttab\\r");
+        ASSERT_EQ(escape(std::string("\x01\x1f\b\f", 4)), "\\u0001\\u001f\\b\\f");
+        ASSERT_EQ(escape(std::string("nul\0byte", 8)), "nul\\u0000byte");
+        // UTF-8 is passed through
+        ASSERT_EQ(escape("gr\xc3\xbc\xc3\x9f"), "gr\xc3\xbc\xc3\x9f");
+    }
+
+    TEST_F(JsonLogWriterTests, FormatsAllFields) {
+        JsonLogWriter uut(fileno(file));
+        JsonLogWriter::Record record;
+        record.program = "worker@1";
+        record.instance = 1;
+        record.stream = JsonLogWriter::STDERR;
+        record.pid = 42;
+        std::string message = "disk \"full\"";
+        record.message = message.data();
+        record.length = message.size();
+        record.wall.tv_sec = 1527854400;
+        record.wall.tv_nsec = 42000000;
+        record.mono.tv_sec = 1234;
+        record.mono.tv_nsec = 5000;
+        record.level = "error";
+        uut.write(record);
+
+        // Single instance program whose process already exited
+        record.level = nullptr;
+        record.program = "web";
+        record.instance = -1;
+        record.stream = JsonLogWriter::STDOUT;
+        record.pid = 0;
+        record.length = 0;
+        record.wall.tv_sec++;
+        uut.write(record);
+        ASSERT_EQ(contents(), "");
+        uut.flush();
+        ASSERT_EQ(contents(),
+                  "{\"time\":\"2018-06-01T12:00:00.042Z\",\"mono\":1234.000005000,\"program\":\"worker@1\","
+                  "\"instance\":1,\"stream\":\"stderr\",\"level\":\"error\",\"pid\":42,"
+                  "\"message\":\"disk \\\"full\\\"\"}\n"
+                  "{\"time\":\"2018-06-01T12:00:01.042Z\",\"mono\":1234.000005000,\"program\":\"web\","
+                  "\"stream\":\"stdout\",\"message\":\"\"}\n");
+    }
+
+    TEST_F(JsonLogWriterTests, LongMessagesStayOneLine) {
+        std::string message(3 * JSON_LOG_BUFFER_SIZE, '\n');
+        {
+            JsonLogWriter uut(fileno(file));
+            JsonLogWriter::Record record;
+            JsonLogWriter::stamp(record);
+            record.message = message.data();
+            record.length = message.size();
+            uut.write(record);
+            uut.write(record);
+        }
+        auto data = contents();
+        ASSERT_EQ(std::count(data.begin(), data.end(), '\n'), 2);
+        ASSERT_EQ(data.back(), '\n');
+        auto first = data.substr(0, data.find('\n'));
+        ASSERT_EQ(first.size(), data.size() / 2 - 1);
+        ASSERT_EQ(first.substr(first.size() - 4), "\\n\"}");
+    }
+}  // namespace scinit
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <string>
+#include "../src/LogLevels.h"
+
+namespace scinit {
+    class LogLevelsTests : public testing::Test {
+      protected:
+        // The detected level, or 'off' if there was none
+        static levels::Level detect(const std::string& line) {
+            auto level = spdlog::level::off;
+            levels::detect(line.data(), line.size(), level);
+            return level;
+        }
+    };
+
+    TEST_F(LogLevelsTests, DetectsJsonLevels) {
+        ASSERT_EQ(detect(R"({"time":"12:00","level":"error","msg":"boom"})"), spdlog::level::err);
+        ASSERT_EQ(detect(R"({"severity": "WARNING", "message": "slow"})"), spdlog::level::warn);
+        ASSERT_EQ(detect(R"({"level":30,"msg":"pino"})"), spdlog::level::info);
+        ASSERT_EQ(detect(R"({"level":50})"), spdlog::level::err);
+        ASSERT_EQ(detect(R"({"level":300})"), spdlog::level::off);
+        ASSERT_EQ(detect(R"({"msg":"no level, [ERROR] in the message doesn't count"})"), spdlog::level::off);
+    }
+
+    TEST_F(LogLevelsTests, DetectsGlogPrefixes) {
+        ASSERT_EQ(detect("E0101 12:34:56.789012  1234 main.cc:12] boom"), spdlog::level::err);
+        ASSERT_EQ(detect("W1231 00:00:00.000000  1 x.cc:1] careful"), spdlog::level::warn);
+        ASSERT_EQ(detect("I0601 12:00:00.000000  1 x.cc:1] fine"), spdlog::level::info);
+        ASSERT_EQ(detect("F0601 12:00:00.000000  1 x.cc:1] dead"), spdlog::level::critical);
+        ASSERT_EQ(detect("X0601 not glog"), spdlog::level::off);
+        ASSERT_EQ(detect("E01 too short"), spdlog::level::off);
+    }
+
+    TEST_F(LogLevelsTests, DetectsWordsAndBrackets) {
+        ASSERT_EQ(detect("ERROR:root:Couldn't connect"), spdlog::level::err);
+        ASSERT_EQ(detect("  WARN something"), spdlog::level::warn);
+        ASSERT_EQ(detect("DEBUG"), spdlog::level::debug);
+        ASSERT_EQ(detect("2018-06-01 12:00:00,123 [ERROR] main: boom"), spdlog::level::err);
+        ASSERT_EQ(detect("[2018-06-01 12:00:00] [ warning ] x"), spdlog::level::warn);
+        ASSERT_EQ(detect("[main] [Fatal] out of memory"), spdlog::level::critical);
+        ASSERT_EQ(detect("time=12:00 level=debug msg=\"tick\""), spdlog::level::debug);
+        ASSERT_EQ(detect("level=\"info\" msg=x"), spdlog::level::info);
+
+        // Prose must not be mistaken for a level
+        ASSERT_EQ(detect("Error connecting to the database"), spdlog::level::off);
+        ASSERT_EQ(detect("INFORMATION: nothing"), spdlog::level::off);
+        ASSERT_EQ(detect("loglevel=debug"), spdlog::level::off);
+        ASSERT_EQ(detect("[worker] started"), spdlog::level::off);
+        ASSERT_EQ(detect(std::string(64, 'x') + " [ERROR] too far in"), spdlog::level::off);
+        ASSERT_EQ(detect(""), spdlog::level::off);
+    }
+
+    TEST_F(LogLevelsTests, ParsesNames) {
+        auto level = spdlog::level::off;
+        ASSERT_TRUE(levels::parse("Warning", 7, level));
+        ASSERT_EQ(level, spdlog::level::warn);
+        ASSERT_TRUE(levels::parse("err", 3, level));
+        ASSERT_EQ(level, spdlog::level::err);
+        ASSERT_FALSE(levels::parse("verbose", 7, level));
+        ASSERT_FALSE(levels::parse("criticals", 9, level));
+        ASSERT_STREQ(levels::name(spdlog::level::warn), "warning");
+        ASSERT_EQ(levels::syslog_severity(spdlog::level::err), 3);
+        ASSERT_EQ(levels::syslog_severity(spdlog::level::debug), 7);
+    }
+}  // namespace scinit
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "../src/ChildProcessException.h"
+#include "../src/LogSink.h"
+#include "../src/log.h"
+
+namespace fs = boost::filesystem;
+
+namespace scinit {
+    class LogSinkTests : public testing::Test {
+      protected:
+        fs::path dir;
+
+        void SetUp() override {
+            if (!spdlog::get("scinit")) {
+                auto console = spdlog::stdout_color_st("scinit");
+                console->set_pattern("[%^%n%$] [%H:%M:%S.%e] [%l] %v");
+                console->set_level(spdlog::level::critical);
+            }
+            dir = fs::temp_directory_path() / fs::unique_path();
+            fs::create_directory(dir);
+        }
+
+        void TearDown() override {
+            fs::remove_all(dir);
+            spdlog::drop_all();
+        }
+
+        std::string contents(const fs::path& file) {
+            std::ifstream in(file.native());
+            std::stringstream data;
+            data << in.rdbuf();
+            return data.str();
+        }
+
+        std::vector<fs::path> rotated_files() {
+            std::vector<fs::path> files;
+            for (const auto& entry : fs::directory_iterator(dir)) {
+                if (entry.path().filename() != "out.log") {
+                    files.push_back(entry.path());
+                }
+            }
+            return files;
+        }
+    };
+
+    TEST_F(LogSinkTests, LinesAreWrittenOnFlush) {
+        auto path = dir / "out.log";
+        std::ofstream(path.native()) << "existing\n";
+        FileLogSink uut(path.native(), FileLogSink::Rotation());
+        uut.write("first");
+        uut.write("second");
+        ASSERT_EQ(contents(path), "existing\n");
+        uut.flush();
+        ASSERT_EQ(contents(path), "existing\nfirst\nsecond\n");
+        ASSERT_EQ(uut.get_dropped(), 0);
+    }
+
+    TEST_F(LogSinkTests, RotatesBySize) {
+        auto path = dir / "out.log";
+        FileLogSink::Rotation rotation;
+        rotation.max_bytes = 100;
+        FileLogSink uut(path.native(), rotation);
+        std::string line(59, 'x');
+        uut.write(line);
+        uut.flush();
+        ASSERT_TRUE(rotated_files().empty());
+        // Would make the file larger than 100 bytes, so it is rotated first
+        uut.write(line);
+        uut.flush();
+        auto rotated = rotated_files();
+        ASSERT_EQ(rotated.size(), 1);
+        ASSERT_EQ(contents(rotated[0]), line + "\n");
+        ASSERT_EQ(contents(path), line + "\n");
+    }
+
+    TEST_F(LogSinkTests, RotatesByAge) {
+        auto path = dir / "out.log";
+        FileLogSink::Rotation rotation;
+        rotation.max_age_s = 3600;
+        FileLogSink uut(path.native(), rotation);
+        uut.write("old");
+        uut.tick(time(nullptr));
+        ASSERT_TRUE(rotated_files().empty());
+        uut.write("new");
+        uut.tick(time(nullptr) + 3600);
+        auto rotated = rotated_files();
+        ASSERT_EQ(rotated.size(), 1);
+        ASSERT_EQ(contents(rotated[0]), "old\nnew\n");
+        ASSERT_EQ(contents(path), "");
+    }
+
+    TEST_F(LogSinkTests, OldestRotatedFilesExpire) {
+        auto path = dir / "out.log";
+        for (auto stamp : {"20180102-000000", "20180101-000000", "20180103-000000", "20180103-000000-1"}) {
+            std::ofstream((dir / ("out.log." + std::string(stamp))).native()) << "x\n";
+        }
+        // Neither rotated files of this sink nor the file itself
+        std::ofstream((dir / "out.log.bak").native()) << "x\n";
+        std::ofstream((dir / "other.log.20180101-000000").native()) << "x\n";
+        std::ofstream(path.native()) << "x\n";
+
+        auto expired = FileLogSink::expired_files(path.native(), 2);
+        ASSERT_EQ(expired.size(), 2);
+        ASSERT_EQ(fs::path(expired[0]).filename(), "out.log.20180101-000000");
+        ASSERT_EQ(fs::path(expired[1]).filename(), "out.log.20180102-000000");
+        ASSERT_TRUE(FileLogSink::expired_files(path.native(), 4).empty());
+    }
+
+    TEST_F(LogSinkTests, UnwritableFileThrows) {
+        ASSERT_THROW(FileLogSink((dir / "missing" / "out.log").native(), FileLogSink::Rotation()),
+                     ChildProcessException);
+    }
+
+    // A syslog daemon stand-in, bound to a datagram socket in the test directory
+    class SyslogSinkTests : public LogSinkTests {
+      protected:
+        int daemon = -1;
+        std::string socket_path;
+
+        void SetUp() override {
+            LogSinkTests::SetUp();
+            socket_path = (dir / "log").native();
+            start_daemon();
+        }
+
+        void start_daemon() {
+            daemon = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            ASSERT_NE(daemon, -1);
+            struct sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(static_cast<char *>(addr.sun_path), socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            ASSERT_EQ(bind(daemon, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), 0);
+        }
+
+        void TearDown() override {
+            close(daemon);
+            LogSinkTests::TearDown();
+        }
+
+        std::vector<std::string> received() {
+            std::vector<std::string> messages;
+            char buf[16384];
+            ssize_t size = 0;
+            while ((size = recv(daemon, static_cast<char *>(buf), sizeof(buf), 0)) >= 0) {
+                messages.emplace_back(static_cast<char *>(buf), static_cast<size_t>(size));
+            }
+            return messages;
+        }
+    };
+
+    TEST_F(SyslogSinkTests, FormatsRfc5424Messages) {
+        struct timespec time {};
+        time.tv_sec = 1527854400;
+        time.tv_nsec = 42000999;
+        std::string message = "disk full";
+        ASSERT_EQ(SyslogSink::format(3 * 8 + 4, time, "host", "web", message.data(), message.size()),
+                  "<28>1 2018-06-01T12:00:00.042000Z host web - - - disk full");
+    }
+
+    TEST_F(SyslogSinkTests, SendsBatchesToTheDaemon) {
+        SyslogSink uut(socket_path, "worker@1 x", 1, 6);
+        uut.write("first");
+        uut.write("second");
+        ASSERT_TRUE(received().empty());
+        uut.tick(time(nullptr));
+        auto messages = received();
+        ASSERT_EQ(messages.size(), 2);
+        ASSERT_EQ(messages[0].substr(0, 6), "<14>1 ");
+        ASSERT_NE(messages[0].find(" worker@1_x - - - first"), std::string::npos);
+        ASSERT_NE(messages[1].find(" - - - second"), std::string::npos);
+
+        // Detected levels override the sink's severity, the facility stays
+        uut.write("boom", 3);
+        uut.flush();
+        messages = received();
+        ASSERT_EQ(messages.size(), 1);
+        ASSERT_EQ(messages[0].substr(0, 6), "<11>1 ");
+    }
+
+    TEST_F(SyslogSinkTests, DropsAndCountsWhileTheDaemonIsBehind) {
+        SyslogSink uut(socket_path, "web", 1, 6);
+        std::string line(1000, 'x');
+        const unsigned int count = 10000;
+        for (unsigned int i = 0; i < count; i++) {
+            uut.write(line);
+        }
+        ASSERT_GT(uut.get_dropped(), 0);
+        // Once the daemon catches up, everything that was queued arrives, followed by the note
+        std::vector<std::string> messages;
+        for (int i = 0; i < 1000 && (messages.empty() || messages.back().find("dropped") == std::string::npos); i++) {
+            uut.flush();
+            auto batch = received();
+            messages.insert(messages.end(), batch.begin(), batch.end());
+        }
+        ASSERT_EQ(messages.size() + uut.get_dropped(), count + 1);
+        ASSERT_NE(messages.back().find("scinit: " + std::to_string(uut.get_dropped()) + " line(s) dropped"),
+                  std::string::npos);
+    }
+
+    TEST_F(SyslogSinkTests, ReconnectsOnceTheDaemonIsBack) {
+        close(daemon);
+        fs::remove(socket_path);
+        SyslogSink uut(socket_path, "web", 1, 6);
+        uut.write("queued");
+        uut.flush();
+        start_daemon();
+        uut.tick(time(nullptr));
+        auto messages = received();
+        ASSERT_EQ(messages.size(), 1);
+        ASSERT_NE(messages[0].find("queued"), std::string::npos);
+    }
+}  // namespace scinit
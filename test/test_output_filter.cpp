@@ -0,0 +1,113 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <string>
+#include "../src/ConfigParseException.h"
+#include "../src/OutputFilter.h"
+
+namespace scinit {
+    class OutputFilterTests : public testing::Test {
+      protected:
+        static bool keep(const OutputFilter& filter, const std::string& line) {
+            return filter.keep(line.data(), line.size());
+        }
+    };
+
+    TEST_F(OutputFilterTests, FirstMatchingRuleDecides) {
+        OutputFilter uut;
+        uut.add_rule(OutputFilter::KEEP, OutputFilter::SUBSTRING, "ERROR");
+        uut.add_rule(OutputFilter::DROP, OutputFilter::PREFIX, "DEBUG");
+        uut.add_rule(OutputFilter::DROP, OutputFilter::REGEX, "^GET /health(z)? ");
+        ASSERT_TRUE(keep(uut, "DEBUG but ERROR"));
+        ASSERT_FALSE(keep(uut, "DEBUG connection pool stats"));
+        ASSERT_TRUE(keep(uut, "debug is case sensitive"));
+        ASSERT_FALSE(keep(uut, "GET /healthz 200"));
+        ASSERT_TRUE(keep(uut, "GET /api 200"));
+        ASSERT_TRUE(keep(uut, ""));
+
+        uut.set_default(OutputFilter::DROP);
+        ASSERT_FALSE(keep(uut, "GET /api 200"));
+        ASSERT_TRUE(keep(uut, "ERROR"));
+    }
+
+    TEST_F(OutputFilterTests, FindsSubstringsAnywhere) {
+        OutputFilter uut;
+        uut.add_rule(OutputFilter::DROP, OutputFilter::SUBSTRING, "abcab");
+        uut.add_rule(OutputFilter::DROP, OutputFilter::SUBSTRING, "#");
+        ASSERT_FALSE(keep(uut, "abcab"));
+        ASSERT_FALSE(keep(uut, "xxabcabxx"));
+        ASSERT_FALSE(keep(uut, "abcabcab"));
+        ASSERT_FALSE(keep(uut, "aabcaabcab"));
+        ASSERT_TRUE(keep(uut, "abcaXabca"));
+        ASSERT_TRUE(keep(uut, "abca"));
+        ASSERT_FALSE(keep(uut, "ends with #"));
+        // Lines aren't NUL terminated, matches must not go past their end
+        std::string line = "abcabc";
+        ASSERT_TRUE(uut.keep(line.data(), 4));
+    }
+
+    TEST_F(OutputFilterTests, RegexesAreOnlyAnchoredWhereTheySayTheyAre) {
+        OutputFilter uut;
+        uut.add_rule(OutputFilter::DROP, OutputFilter::REGEX, "^a+b");
+        uut.add_rule(OutputFilter::DROP, OutputFilter::REGEX, "^x|y$");
+        uut.add_rule(OutputFilter::DROP, OutputFilter::REGEX, "[0-9]{3}ms");
+        ASSERT_FALSE(keep(uut, "aab..."));
+        ASSERT_TRUE(keep(uut, "caab"));
+        ASSERT_FALSE(keep(uut, "x marks"));
+        ASSERT_FALSE(keep(uut, "the way"));
+        ASSERT_TRUE(keep(uut, "y not"));
+        ASSERT_FALSE(keep(uut, "took 250ms"));
+        ASSERT_TRUE(keep(uut, "took 25ms"));
+    }
+
+    TEST_F(OutputFilterTests, InvalidRegexThrows) {
+        OutputFilter uut;
+        ASSERT_THROW(uut.add_rule(OutputFilter::DROP, OutputFilter::REGEX, "(unbalanced"), ConfigParseException);
+    }
+
+    TEST_F(OutputFilterTests, SamplesOneInN) {
+        OutputSampler uut(3, 0);
+        std::string kept;
+        for (int i = 0; i < 9; i++) {
+            kept += uut.keep(1000) ? 'k' : '-';
+        }
+        ASSERT_EQ(kept, "k--k--k--");
+        ASSERT_EQ(uut.take_suppressed(), 6);
+        ASSERT_EQ(uut.take_suppressed(), 0);
+    }
+
+    TEST_F(OutputFilterTests, LimitsLinesPerSecond) {
+        OutputSampler uut(0, 10);
+        int kept = 0;
+        for (int i = 0; i < 100; i++) {
+            kept += uut.keep(1000) ? 1 : 0;
+        }
+        ASSERT_EQ(kept, 10);
+        // Half a second later, there is room for five more
+        for (int i = 0; i < 100; i++) {
+            kept += uut.keep(1500) ? 1 : 0;
+        }
+        ASSERT_EQ(kept, 15);
+        ASSERT_EQ(uut.take_suppressed(), 185);
+        // The burst is limited to one second's worth
+        for (int i = 0; i < 100; i++) {
+            kept += uut.keep(60000) ? 1 : 0;
+        }
+        ASSERT_EQ(kept, 25);
+    }
+}  // namespace scinit
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <string>
+#include "../src/OutputRing.h"
+
+namespace scinit {
+    class OutputRingTests : public testing::Test {
+      protected:
+        static void add(OutputRing& ring, const std::string& line, bool is_stderr = false) {
+            ring.add(line.data(), line.size(), is_stderr);
+        }
+    };
+
+    TEST_F(OutputRingTests, KeepsTheMostRecentLines) {
+        OutputRing uut(3, 1024);
+        ASSERT_EQ(uut.dump(), "");
+        for (auto line : {"one", "two", "three", "four"}) {
+            add(uut, line);
+        }
+        ASSERT_EQ(uut.get_lines(), 3);
+        ASSERT_EQ(uut.dump(), "two\nthree\nfour");
+        add(uut, "oops", true);
+        ASSERT_EQ(uut.dump(), "three\nfour\n[stderr] oops");
+    }
+
+    TEST_F(OutputRingTests, KeepsAtMostMaxBytes) {
+        OutputRing uut(100, 10);
+        add(uut, "aaaa");
+        add(uut, "bbbb");
+        ASSERT_EQ(uut.get_bytes(), 8);
+        // Doesn't fit, drops 'aaaa' and wraps around the end of the buffer
+        add(uut, "cccccc");
+        ASSERT_EQ(uut.get_lines(), 2);
+        ASSERT_EQ(uut.get_bytes(), 10);
+        ASSERT_EQ(uut.dump(), "bbbb\ncccccc");
+        add(uut, "");
+        add(uut, "dd");
+        ASSERT_EQ(uut.dump(), "cccccc\n\ndd");
+    }
+
+    TEST_F(OutputRingTests, LongLinesKeepTheirEnd) {
+        OutputRing uut(10, 8);
+        add(uut, "before");
+        add(uut, "0123456789abcdef");
+        ASSERT_EQ(uut.get_lines(), 1);
+        ASSERT_EQ(uut.dump(), "89abcdef");
+    }
+
+    TEST_F(OutputRingTests, ClearEmptiesTheRing) {
+        OutputRing uut(2, 16);
+        add(uut, "first");
+        add(uut, "second");
+        uut.clear();
+        ASSERT_EQ(uut.get_lines(), 0);
+        ASSERT_EQ(uut.get_bytes(), 0);
+        add(uut, "third");
+        ASSERT_EQ(uut.dump(), "third");
+    }
+}  // namespace scinit
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "../src/OutputTarget.h"
+
+namespace fs = boost::filesystem;
+
+namespace scinit {
+    class OutputTargetTests : public testing::Test {
+      protected:
+        fs::path file;
+        int child[2] = {-1, -1};
+
+        void SetUp() override {
+            file = fs::temp_directory_path() / fs::unique_path();
+            ASSERT_EQ(pipe(static_cast<int *>(child)), 0);
+        }
+
+        void TearDown() override {
+            close(child[0]);
+            close(child[1]);
+            fs::remove(file);
+        }
+
+        std::string file_contents() {
+            std::ifstream in(file.native());
+            std::stringstream contents;
+            contents << in.rdbuf();
+            return contents.str();
+        }
+
+        void child_writes(const std::string &data) {
+            ASSERT_EQ(write(child[1], data.data(), data.size()), static_cast<ssize_t>(data.size()));
+        }
+    };
+
+    TEST_F(OutputTargetTests, MovesPipeContentsToFile) {
+        std::ofstream(file.native()) << "existing\n";
+        auto target = OutputTarget::open_file(file.native());
+        child_writes("{\"msg\": \"first\"}\n");
+        child_writes("{\"msg\": \"second\"}\n");
+        ASSERT_EQ(target->forward(child[0]), 35);
+        // Nothing left, forwarding again must not block
+        ASSERT_EQ(target->forward(child[0]), 0);
+        ASSERT_EQ(file_contents(), "existing\n{\"msg\": \"first\"}\n{\"msg\": \"second\"}\n");
+    }
+
+    TEST_F(OutputTargetTests, TeeCopiesToMirror) {
+        int out[2];
+        ASSERT_EQ(pipe(static_cast<int *>(out)), 0);
+        OutputTarget mirror(out[1], true);
+        auto target = OutputTarget::open_file(file.native());
+
+        // More than PIPE_BUF, so it's forwarded in several chunks
+        std::string line(3 * PIPE_BUF, 'x');
+        line += "\n";
+        child_writes(line);
+        ASSERT_EQ(target->forward(child[0], &mirror), static_cast<ssize_t>(line.size()));
+        ASSERT_EQ(file_contents(), line);
+
+        std::string mirrored(line.size(), '\0');
+        ASSERT_EQ(read(out[0], &mirrored[0], mirrored.size()), static_cast<ssize_t>(line.size()));
+        ASSERT_EQ(mirrored, line);
+        close(out[0]);
+    }
+
+    TEST_F(OutputTargetTests, ChunksEndAtLineBoundaries) {
+        std::string first(PIPE_BUF - 100, 'a'), second(200, 'b');
+        auto data = first + "\n" + second + "\n";
+        ASSERT_EQ(OutputTarget::chunk_size(data.data(), data.size()), first.size() + 1);
+        // Everything fits into one atomic write
+        ASSERT_EQ(OutputTarget::chunk_size(data.data(), PIPE_BUF), static_cast<size_t>(PIPE_BUF));
+        // A line longer than PIPE_BUF isn't split
+        std::string line(PIPE_BUF + 100, 'c');
+        data = line + "\n" + second + "\n";
+        ASSERT_EQ(OutputTarget::chunk_size(data.data(), data.size()), line.size() + 1);
+        ASSERT_EQ(OutputTarget::chunk_size(line.data(), line.size()), line.size());
+    }
+
+    TEST_F(OutputTargetTests, LinesStraddlingPipeBufAreWrittenWhole) {
+        // In packet mode every write to the pipe is read back separately
+        int out[2];
+        ASSERT_EQ(pipe2(static_cast<int *>(out), O_DIRECT), 0);
+        OutputTarget target(out[1], true);
+        // Pipes move whole buffers when splicing, only separate writes show where the chunks end
+        target.can_splice = false;
+
+        std::string first(PIPE_BUF - 100, 'a'), second(200, 'b');
+        child_writes(first + "\n" + second + "\n");
+        ASSERT_EQ(target.forward(child[0]), static_cast<ssize_t>(first.size() + second.size() + 2));
+
+        std::string packet(PIPE_BUF, '\0');
+        ASSERT_EQ(read(out[0], &packet[0], packet.size()), static_cast<ssize_t>(first.size() + 1));
+        ASSERT_EQ(packet.substr(0, first.size() + 1), first + "\n");
+        ASSERT_EQ(read(out[0], &packet[0], packet.size()), static_cast<ssize_t>(second.size() + 1));
+        ASSERT_EQ(packet.substr(0, second.size() + 1), second + "\n");
+        close(out[0]);
+    }
+}  // namespace scinit
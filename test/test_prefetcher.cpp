@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "../src/ElfFile.h"
+#include "../src/Prefetcher.h"
+
+namespace scinit {
+    class PrefetcherTests : public testing::Test {};
+
+    TEST_F(PrefetcherTests, ReadsOwnDependencies) {
+        // The test binary itself is dynamically linked against (at least) libc
+        elf::Dependencies deps;
+        ASSERT_TRUE(elf::read_dependencies("/proc/self/exe", deps));
+        ASSERT_FALSE(deps.interpreter.empty());
+        ASSERT_TRUE(std::any_of(deps.needed.begin(), deps.needed.end(),
+                                [](const std::string& soname) { return soname.compare(0, 7, "libc.so") == 0; }));
+
+        auto files = elf::files_to_load("/proc/self/exe");
+        ASSERT_GE(files.size(), 3);
+        ASSERT_EQ(files.front(), "/proc/self/exe");
+        ASSERT_EQ(*std::next(files.begin()), deps.interpreter);
+    }
+
+    TEST_F(PrefetcherTests, ScriptsAreReadAsIs) {
+        char path[] = "/tmp/scinit-prefetch-XXXXXX";
+        int fd = mkstemp(static_cast<char*>(path));
+        ASSERT_NE(fd, -1);
+        ASSERT_EQ(write(fd, "#!/bin/sh\n", 10), 10);
+        close(fd);
+
+        elf::Dependencies deps;
+        ASSERT_FALSE(elf::read_dependencies(path, deps));
+        auto files = elf::files_to_load(path);
+        ASSERT_EQ(files.size(), 1);
+        ASSERT_EQ(files.front(), path);
+        ASSERT_EQ(Prefetcher::warm_up(path), 10);
+        unlink(static_cast<char*>(path));
+        ASSERT_EQ(Prefetcher::warm_up(path), 0);
+    }
+
+    TEST_F(PrefetcherTests, SharedFilesAreReadOnce) {
+        Prefetcher uut;
+        uut.start({{1, "/proc/self/exe"}, {2, "/proc/self/exe"}});
+        std::list<Prefetcher::Result> results;
+        while (results.size() < 2) {
+            struct pollfd wait = {uut.get_fd(), POLLIN, 0};
+            ASSERT_EQ(poll(&wait, 1, 10000), 1) << "Prefetching timed out";
+            results.splice(results.end(), uut.collect());
+        }
+        ASSERT_TRUE(uut.is_done());
+        ASSERT_EQ(results.front().id, 1);
+        ASSERT_GE(results.front().files, 3);
+        ASSERT_GT(results.front().bytes, 0);
+        ASSERT_EQ(results.back().id, 2);
+        ASSERT_EQ(results.back().files, 0);
+    }
+}  // namespace scinit
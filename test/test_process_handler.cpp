@@ -40,6 +40,8 @@ namespace scinit {
 
     TEST_F(ProcessHandlerTests, TestOneRunnableChild) {
         auto child_1 = std::make_shared<MockChildProcess>();
+        ProgramOptions options;
+        EXPECT_CALL(*child_1, get_options()).WillRepeatedly(::testing::ReturnRef(options));
         EXPECT_CALL(*child_1, can_start_now()).WillRepeatedly(Return(true));
         EXPECT_CALL(*child_1, do_fork(_)).Times(1);
         EXPECT_CALL(*child_1, register_with_epoll(_, _, _)).Times(1);
@@ -56,6 +58,8 @@ namespace scinit {
 
     TEST_F(ProcessHandlerTests, TestOneChildLifecycle) {
         auto child_1 = std::make_shared<MockChildProcess>();
+        ProgramOptions options;
+        EXPECT_CALL(*child_1, get_options()).WillRepeatedly(::testing::ReturnRef(options));
         EXPECT_CALL(*child_1, can_start_now()).WillRepeatedly(Return(true));
         EXPECT_CALL(*child_1, do_fork(_)).Times(1);
         EXPECT_CALL(*child_1, register_with_epoll(_, _, _)).Times(1);
@@ -83,4 +87,150 @@ namespace scinit {
         EXPECT_EQ(handler.number_of_running_procs, 0);
         delete mock_events;
     }
+
+    TEST_F(ProcessHandlerTests, MemoryRestartThresholds) {
+        ProgramOptions options;
+        ProcessSampler::Sample baseline, sample;
+        baseline.at_ms = 1000;
+        baseline.rss_kib = 100 * 1024;
+        sample.at_ms = baseline.at_ms + 30 * 60 * 1000;
+        sample.rss_kib = 150 * 1024;
+        ASSERT_EQ(ProcessHandler::memory_restart_reason(options, baseline, sample), "");
+
+        options.max_rss_kib = 120 * 1024;
+        ASSERT_NE(ProcessHandler::memory_restart_reason(options, baseline, sample), "");
+
+        // 50 MiB in half an hour
+        options.max_rss_kib = 0;
+        options.max_rss_growth_kib_per_hour = 100 * 1024;
+        ASSERT_EQ(ProcessHandler::memory_restart_reason(options, baseline, sample), "");
+        options.max_rss_growth_kib_per_hour = 99 * 1024;
+        ASSERT_NE(ProcessHandler::memory_restart_reason(options, baseline, sample), "");
+        // Growth right after the start is not judged
+        sample.at_ms = baseline.at_ms + 60 * 1000;
+        ASSERT_EQ(ProcessHandler::memory_restart_reason(options, baseline, sample), "");
+    }
+
+    TEST_F(ProcessHandlerTests, LeakingProcessIsRestartedOnce) {
+        auto child_1 = std::make_shared<MockChildProcess>();
+        ProgramOptions options;
+        options.max_rss_kib = 1024;
+        EXPECT_CALL(*child_1, get_options()).WillRepeatedly(::testing::ReturnRef(options));
+        EXPECT_CALL(*child_1, get_state()).WillRepeatedly(Return(ChildProcessInterface::RUNNING));
+        EXPECT_CALL(*child_1, get_name()).WillRepeatedly(Return("mockprog"));
+        EXPECT_CALL(*child_1, stop(true)).Times(1);
+
+        ProcessHandler handler;
+        handler.id_for_pid[42] = 0;
+        handler.obj_for_id[0] = child_1;
+        ProcessSampler::Sample sample;
+        sample.at_ms = 1000;
+        sample.rss_kib = 512;
+        handler.check_memory(42, sample);
+        sample.rss_kib = 2048;
+        handler.check_memory(42, sample);
+        // Already stopping, don't ask again
+        handler.check_memory(42, sample);
+
+        // The new process starts with a clean slate
+        handler.register_for_process_state(0, [](ProcessHandlerInterface::ProcessEvent, int) {});
+        handler.sigchld_received(42, 0);
+        ASSERT_EQ(handler.memory_restarts.count(42), 0);
+        ASSERT_EQ(handler.rss_baselines.count(42), 0);
+    }
+
+    TEST_F(ProcessHandlerTests, MemoryPressureShedsByPriority) {
+        ProgramOptions low, high, never;
+        low.sheddable = ProgramOptions::SHED_PAUSE;
+        high.sheddable = ProgramOptions::SHED_STOP;
+        high.priority = 5;
+        std::list<std::weak_ptr<ChildProcessInterface>> all_children;
+        std::vector<std::shared_ptr<MockChildProcess>> children;
+        for (auto options : {&high, &low, &never}) {
+            auto child = std::make_shared<MockChildProcess>();
+            EXPECT_CALL(*child, get_options()).WillRepeatedly(::testing::ReturnRef(*options));
+            EXPECT_CALL(*child, get_state()).WillRepeatedly(Return(ChildProcessInterface::RUNNING));
+            EXPECT_CALL(*child, get_name()).WillRepeatedly(Return("mockprog"));
+            EXPECT_CALL(*child, propagate_dependencies(_)).Times(1);
+            EXPECT_CALL(*child, bind_sockets()).Times(1);
+            children.push_back(child);
+            all_children.push_back(child);
+        }
+        auto high_child = children[0], low_child = children[1];
+
+        ProcessHandler handler;
+        handler.register_processes(all_children);
+        bool low_paused = false, high_parked = false;
+        EXPECT_CALL(*low_child, is_paused()).WillRepeatedly(::testing::ReturnPointee(&low_paused));
+        EXPECT_CALL(*high_child, is_parked()).WillRepeatedly(::testing::ReturnPointee(&high_parked));
+        EXPECT_CALL(*high_child, is_paused()).WillRepeatedly(Return(false));
+        EXPECT_CALL(*low_child, is_parked()).WillRepeatedly(Return(false));
+        {
+            ::testing::InSequence order;
+            EXPECT_CALL(*low_child, set_paused(true)).WillOnce(::testing::Assign(&low_paused, true));
+            EXPECT_CALL(*high_child, set_parked(true)).WillOnce(::testing::Assign(&high_parked, true));
+            EXPECT_CALL(*high_child, set_parked(false)).WillOnce(::testing::Assign(&high_parked, false));
+            EXPECT_CALL(*low_child, set_paused(false)).WillOnce(::testing::Assign(&low_paused, false));
+        }
+
+        // A short spike doesn't shed anything, sustained pressure sheds one program per decision
+        handler.shed_load(50, false);
+        handler.shed_load(0, false);
+        ASSERT_TRUE(handler.shed_programs.empty());
+        for (int i = 0; i < 3; i++) {
+            handler.shed_load(50, i == 0);
+        }
+        ASSERT_EQ(handler.shed_programs.size(), 1);
+        for (int i = 0; i < 3; i++) {
+            handler.shed_load(50, false);
+        }
+        ASSERT_EQ(handler.shed_programs.size(), 2);
+        // Only sheddable programs are candidates
+        for (int i = 0; i < 3; i++) {
+            handler.shed_load(50, false);
+        }
+        ASSERT_EQ(handler.shed_programs.size(), 2);
+
+        for (int i = 0; i < 20; i++) {
+            handler.shed_load(1, false);
+        }
+        ASSERT_TRUE(handler.shed_programs.empty());
+    }
+
+    TEST_F(ProcessHandlerTests, SheddingTheLastProgramKeepsRunning) {
+        ProgramOptions options;
+        options.sheddable = ProgramOptions::SHED_STOP;
+        auto child = std::make_shared<MockChildProcess>();
+        auto state = ChildProcessInterface::RUNNING;
+        bool parked = false;
+        EXPECT_CALL(*child, get_options()).WillRepeatedly(::testing::ReturnRef(options));
+        EXPECT_CALL(*child, get_state()).WillRepeatedly(::testing::ReturnPointee(&state));
+        EXPECT_CALL(*child, get_name()).WillRepeatedly(Return("mockprog"));
+        EXPECT_CALL(*child, is_paused()).WillRepeatedly(Return(false));
+        EXPECT_CALL(*child, is_parked()).WillRepeatedly(::testing::ReturnPointee(&parked));
+        EXPECT_CALL(*child, propagate_dependencies(_)).Times(1);
+        EXPECT_CALL(*child, bind_sockets()).Times(1);
+        {
+            ::testing::InSequence order;
+            EXPECT_CALL(*child, set_parked(true)).WillOnce(::testing::Assign(&parked, true));
+            EXPECT_CALL(*child, set_parked(false)).WillOnce(::testing::Assign(&parked, false));
+        }
+        std::list<std::weak_ptr<ChildProcessInterface>> all_children{child};
+
+        ProcessHandler handler;
+        handler.register_processes(all_children);
+        for (int i = 0; i < 3; i++) {
+            handler.shed_load(50, false);
+        }
+        ASSERT_EQ(handler.shed_programs.size(), 1);
+        // Nothing is running anymore, but the program is started again once the pressure is gone
+        state = ChildProcessInterface::DONE;
+        ASSERT_TRUE(handler.waiting_for_start());
+
+        for (int i = 0; i < 20; i++) {
+            handler.shed_load(1, false);
+        }
+        ASSERT_TRUE(handler.shed_programs.empty());
+        ASSERT_FALSE(handler.waiting_for_start());
+    }
 }  // namespace scinit
\ No newline at end of file
@@ -214,4 +214,280 @@ namespace scinit {
         EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::DONE);
         EXPECT_EQ(handler->number_of_running_procs, 0);
     }
-}  // namespace scinit
\ No newline at end of file
+
+    TEST_F(ProcessLifecycleTests, RequiredDependencyFailurePropagates) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, before, after, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        ProgramOptions server_options;
+        server_options.required.emplace_back("setup");
+        auto child_1 =
+          std::make_shared<MockChildProcess>("setup", "/bin/false", args, "ONESHOT", capabilities, 65534, 65534, 0,
+                                             handler, before, after, false, true, env_whitelist, env_extra_vars);
+        auto child_2 = std::make_shared<MockChildProcess>("server", "/bin/false", args, "SIMPLE", capabilities,
+                                                          65534, 65534, 1, handler, before, after, false, true,
+                                                          env_whitelist, env_extra_vars, server_options);
+        handler->obj_for_id[0] = child_1;
+        handler->obj_for_id[1] = child_2;
+        std::list<std::weak_ptr<ChildProcessInterface>> all_children;
+        all_children.emplace_back(child_1);
+        all_children.emplace_back(child_2);
+
+        child_1->propagate_dependencies(all_children);
+        child_2->propagate_dependencies(all_children);
+        EXPECT_EQ(child_1->state, ChildProcessInterface::ProcessState::READY);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::BLOCKED);
+        EXPECT_THAT(child_2->get_dependencies(), ::testing::ElementsAre(0));
+
+        // The required oneshot program crashes, the server must not wait for it forever
+        EXPECT_EQ(handler->exit_status(), 0);
+        child_1->state = ChildProcessInterface::ProcessState::RUNNING;
+        child_1->handle_process_event(ProcessHandlerInterface::ProcessEvent::EXIT, 1);
+        EXPECT_EQ(child_1->state, ChildProcessInterface::ProcessState::CRASHED);
+        EXPECT_EQ(handler->exit_status(), 1);
+        // Unless it was killed while scinit stopped everything
+        handler->exited_on_quit.insert(0);
+        EXPECT_EQ(handler->exit_status(), 0);
+        child_2->notify_of_state(handler->obj_for_id);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::FAILED);
+        EXPECT_FALSE(child_2->can_start_now());
+        EXPECT_EQ(handler->exit_status(), 1);
+    }
+
+    TEST_F(ProcessLifecycleTests, DependencyCycleIsDetected) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, child_1_before, child_1_after, child_2_before, child_2_after,
+          env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        child_1_after.emplace_back("mockprocB");
+        child_2_after.emplace_back("mockprocA");
+        auto child_1 = std::make_shared<MockChildProcess>("mockprocA", "/bin/false", args, "SIMPLE", capabilities,
+                                                          65534, 65534, 0, handler, child_1_before, child_1_after,
+                                                          false, true, env_whitelist, env_extra_vars);
+        auto child_2 = std::make_shared<MockChildProcess>("mockprocB", "/bin/false", args, "SIMPLE", capabilities,
+                                                          65534, 65534, 1, handler, child_2_before, child_2_after,
+                                                          false, true, env_whitelist, env_extra_vars);
+        handler->obj_for_id[0] = child_1;
+        handler->obj_for_id[1] = child_2;
+        std::list<std::weak_ptr<ChildProcessInterface>> all_children;
+        all_children.emplace_back(child_1);
+        all_children.emplace_back(child_2);
+
+        handler->register_processes(all_children);
+        EXPECT_EQ(child_1->state, ChildProcessInterface::ProcessState::BLOCKED);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::BLOCKED);
+        EXPECT_EQ(handler->exit_status(), 0);
+        handler->detect_deadlocks();
+        EXPECT_EQ(child_1->state, ChildProcessInterface::ProcessState::FAILED);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::FAILED);
+        // scinit exits with an error once nothing is left to run
+        EXPECT_EQ(handler->exit_status(), 1);
+    }
+
+    TEST_F(ProcessLifecycleTests, NotifyReadyGatesDependants) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, before, server_after, client_after, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        client_after.emplace_back("server");
+        ProgramOptions server_options;
+        server_options.notify_ready = true;
+        auto child_1 = std::make_shared<MockChildProcess>("server", "/bin/false", args, "SIMPLE", capabilities, 65534,
+                                                          65534, 0, handler, before, server_after, false, true,
+                                                          env_whitelist, env_extra_vars, server_options);
+        auto child_2 = std::make_shared<MockChildProcess>("client", "/bin/false", args, "SIMPLE", capabilities, 65534,
+                                                          65534, 1, handler, before, client_after, false, true,
+                                                          env_whitelist, env_extra_vars);
+        handler->obj_for_id[0] = child_1;
+        handler->obj_for_id[1] = child_2;
+        std::list<std::weak_ptr<ChildProcessInterface>> all_children;
+        all_children.emplace_back(child_1);
+        all_children.emplace_back(child_2);
+        child_1->propagate_dependencies(all_children);
+        child_2->propagate_dependencies(all_children);
+
+        // Forked, but not ready yet
+        child_1->state = ChildProcessInterface::ProcessState::STARTING;
+        child_2->notify_of_state(handler->obj_for_id);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::BLOCKED);
+
+        child_1->handle_process_event(ProcessHandlerInterface::ProcessEvent::NOTIFY_READY, 0);
+        EXPECT_EQ(child_1->state, ChildProcessInterface::ProcessState::RUNNING);
+        child_2->notify_of_state(handler->obj_for_id);
+        EXPECT_EQ(child_2->state, ChildProcessInterface::ProcessState::READY);
+    }
+
+    TEST_F(ProcessLifecycleTests, RollingRestartInBatches) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, before, after, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        std::vector<std::shared_ptr<MockChildProcess>> instances;
+        for (unsigned int i = 0; i < 3; i++) {
+            ProgramOptions options;
+            options.group = "worker";
+            options.instance = i;
+            options.restart_batch = 2;
+            instances.push_back(std::make_shared<MockChildProcess>(
+              "worker@" + std::to_string(i), "/bin/false", args, "SIMPLE", capabilities, 65534, 65534, i, handler,
+              before, after, false, true, env_whitelist, env_extra_vars, options));
+            instances.back()->state = ChildProcessInterface::ProcessState::RUNNING;
+            instances.back()->start_count = 1;
+            handler->all_objs.emplace_back(instances.back());
+        }
+
+        // The first batch is stopped right away, the last instance keeps running
+        EXPECT_CALL(*instances[0], stop(true)).Times(1);
+        EXPECT_CALL(*instances[1], stop(true)).Times(1);
+        EXPECT_CALL(*instances[2], stop(_)).Times(0);
+        handler->start_rolling_restart();
+        handler->continue_rolling_restarts();
+        ::testing::Mock::VerifyAndClearExpectations(instances[2].get());
+
+        // One instance of the first batch is back, which makes room for the next one
+        instances[0]->start_count++;
+        EXPECT_CALL(*instances[2], stop(true)).Times(1);
+        handler->continue_rolling_restarts();
+        EXPECT_EQ(handler->rolling_restarts.size(), 1);
+
+        instances[1]->start_count++;
+        instances[2]->start_count++;
+        handler->continue_rolling_restarts();
+        EXPECT_TRUE(handler->rolling_restarts.empty());
+    }
+
+    TEST_F(ProcessLifecycleTests, AutoscalingParksAndUnparksInstances) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, before, after, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        std::vector<std::shared_ptr<MockChildProcess>> instances;
+        for (unsigned int i = 0; i < 3; i++) {
+            ProgramOptions options;
+            options.group = "worker";
+            options.instance = i;
+            options.min_instances = 1;
+            options.max_instances = 3;
+            options.start_parked = i > 0;
+            options.scale_signal = ProgramOptions::METRIC;
+            options.scale_up_threshold = 10;
+            options.scale_down_threshold = 2;
+            options.scale_cooldown = 0;
+            instances.push_back(std::make_shared<MockChildProcess>(
+              "worker@" + std::to_string(i), "/bin/false", args, "SIMPLE", capabilities, 65534, 65534, i, handler,
+              before, after, false, true, env_whitelist, env_extra_vars, options));
+            instances.back()->state = ChildProcessInterface::ProcessState::READY;
+            handler->all_objs.emplace_back(instances.back());
+        }
+        instances[0]->state = ChildProcessInterface::ProcessState::RUNNING;
+        EXPECT_FALSE(instances[1]->can_start_now());
+        handler->setup_autoscaling();
+        ASSERT_EQ(handler->scaling_groups.size(), 1);
+
+        // Sustained load above the threshold starts the next parked instance
+        handler->reported_load[0] = 50;
+        for (int i = 0; i < 3; i++) {
+            handler->autoscale(false);
+        }
+        EXPECT_FALSE(instances[1]->is_parked());
+        EXPECT_TRUE(instances[1]->can_start_now());
+        EXPECT_TRUE(instances[2]->is_parked());
+
+        // Once idle again, the highest instance is parked (and stopped)
+        EXPECT_CALL(*instances[1], stop(false)).Times(1);
+        handler->reported_load[0] = 0;
+        for (int i = 0; i < 3; i++) {
+            handler->autoscale(false);
+        }
+        EXPECT_TRUE(instances[1]->is_parked());
+        EXPECT_FALSE(instances[0]->is_parked());
+    }
+
+    TEST_F(ProcessLifecycleTests, ParallelStartsPreferPriorityAndCriticalPath) {
+        auto handler = std::make_shared<ProcessHandler>();
+        handler->set_max_parallel_starts(2);
+
+        // 'leaf' and 'head' are both runnable, but 'middle' and 'tail' wait for 'head'. 'urgent' has a priority.
+        std::list<std::string> args, capabilities, before, none, after_head, after_middle, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        after_head.emplace_back("head");
+        after_middle.emplace_back("middle");
+        ProgramOptions urgent_options;
+        urgent_options.priority = 5;
+        auto make = [&](const std::string& name, unsigned int id, std::list<std::string>& after,
+                        ProgramOptions options) {
+            auto child = std::make_shared<MockChildProcess>(name, "/bin/false", args, "SIMPLE", capabilities, 65534,
+                                                            65534, id, handler, before, after, false, true,
+                                                            env_whitelist, env_extra_vars, options);
+            handler->obj_for_id[id] = child;
+            handler->all_objs.emplace_back(child);
+            return child;
+        };
+        auto leaf = make("leaf", 0, none, {});
+        auto head = make("head", 1, none, {});
+        auto middle = make("middle", 2, after_head, {});
+        auto tail = make("tail", 3, after_middle, {});
+        auto urgent = make("urgent", 4, none, urgent_options);
+        for (const auto& child : handler->all_objs) {
+            child.lock()->propagate_dependencies(handler->all_objs);
+        }
+        for (const auto& child : {leaf, head, urgent}) {
+            child->state = ChildProcessInterface::ProcessState::READY;
+        }
+
+        std::vector<std::shared_ptr<ChildProcessInterface>> runnable = {leaf, head, urgent};
+        handler->schedule_starts(runnable);
+        ASSERT_EQ(runnable.size(), 2);
+        EXPECT_EQ(runnable[0], urgent);
+        EXPECT_EQ(runnable[1], head);
+
+        // Programs that are forked, but not ready yet use up the budget
+        urgent->state = ChildProcessInterface::ProcessState::STARTING;
+        head->state = ChildProcessInterface::ProcessState::STARTING;
+        runnable = {leaf};
+        handler->schedule_starts(runnable);
+        EXPECT_TRUE(runnable.empty());
+
+        head->state = ChildProcessInterface::ProcessState::RUNNING;
+        runnable = {leaf};
+        handler->schedule_starts(runnable);
+        EXPECT_EQ(runnable.size(), 1);
+    }
+
+    TEST_F(ProcessLifecycleTests, CrashedProcessIsRestartedWithBackoff) {
+        auto handler = std::make_shared<ProcessHandler>();
+
+        std::list<std::string> args, capabilities, before, after, env_whitelist;
+        std::list<std::pair<std::string, std::string>> env_extra_vars;
+        ProgramOptions options;
+        options.restart = ProgramOptions::ON_FAILURE;
+        auto child = std::make_shared<MockChildProcess>("server", "/bin/false", args, "SIMPLE", capabilities, 65534,
+                                                        65534, 0, handler, before, after, false, true, env_whitelist,
+                                                        env_extra_vars, options);
+        handler->obj_for_id[0] = child;
+        handler->all_objs.emplace_back(child);
+
+        // Crashes right after the start wait longer each time
+        for (uint64_t delay_ms : {1000, 2000, 4000}) {
+            child->state = ChildProcessInterface::ProcessState::RUNNING;
+            child->started_at = std::chrono::steady_clock::now();
+            child->handle_process_event(ProcessHandlerInterface::ProcessEvent::EXIT, 1);
+            EXPECT_EQ(child->state, ChildProcessInterface::ProcessState::BACKOFF);
+            EXPECT_TRUE(handler->waiting_for_start());
+            auto now = ProcessHandler::monotonic_ms();
+            handler->timers.advance(now + delay_ms - 100);
+            EXPECT_EQ(child->state, ChildProcessInterface::ProcessState::BACKOFF);
+            handler->timers.advance(now + delay_ms + 100);
+            EXPECT_EQ(child->state, ChildProcessInterface::ProcessState::READY);
+        }
+
+        // Stopping it is not a failure
+        child->state = ChildProcessInterface::ProcessState::RUNNING;
+        child->stop_requested = true;
+        child->handle_process_event(ProcessHandlerInterface::ProcessEvent::EXIT, 15);
+        EXPECT_EQ(child->state, ChildProcessInterface::ProcessState::DONE);
+        EXPECT_FALSE(handler->waiting_for_start());
+    }
+}  // namespace scinit
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <vector>
+#include "../src/ChildProcessException.h"
+#include "../src/ProcessStats.h"
+
+namespace scinit {
+    class ProcessStatsTests : public testing::Test {};
+
+    TEST_F(ProcessStatsTests, ParsesProcFiles) {
+        double cpu_s = 0;
+        unsigned int threads = 0;
+        // A comm with spaces and parentheses must not confuse the field count
+        ASSERT_TRUE(ProcessSampler::parse_stat(
+          "42 (a) b (c)) S 1 42 42 0 -1 4194560 100 0 0 0 200 100 0 0 20 0 3 0 1234 10000 500", cpu_s, threads));
+        ASSERT_DOUBLE_EQ(cpu_s, 300.0 / static_cast<double>(sysconf(_SC_CLK_TCK)));
+        ASSERT_EQ(threads, 3);
+        ASSERT_FALSE(ProcessSampler::parse_stat("42 (truncated) S 1 42", cpu_s, threads));
+
+        unsigned long pages = 0;
+        ASSERT_TRUE(ProcessSampler::parse_statm("2500 812 300 10 0 400 0", pages));
+        ASSERT_EQ(pages, 812);
+        ASSERT_FALSE(ProcessSampler::parse_statm("", pages));
+    }
+
+    TEST_F(ProcessStatsTests, DecodesExitStatus) {
+        int status = 0;
+        auto pid = fork();
+        if (pid == 0) {
+            _exit(3);
+        }
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+        ASSERT_EQ(describe_exit_status(status), "exit code 3");
+
+        pid = fork();
+        if (pid == 0) {
+            pause();
+            _exit(0);
+        }
+        kill(pid, SIGKILL);
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+        ASSERT_EQ(describe_exit_status(status), "signal 9 (Killed)");
+    }
+
+    TEST_F(ProcessStatsTests, SamplesRunningChildAndAccountsExit) {
+        int to_parent[2], to_child[2];
+        ASSERT_EQ(pipe(static_cast<int*>(to_parent)), 0);
+        ASSERT_EQ(pipe(static_cast<int*>(to_child)), 0);
+        auto pid = fork();
+        if (pid == 0) {
+            // Touch some memory, then wait until the parent sampled us
+            std::vector<char> memory(32 * 1024 * 1024, 1);
+            char c = memory[memory.size() - 1];
+            if (write(to_parent[1], &c, 1) != 1 || read(to_child[0], &c, 1) != 1) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        char c;
+        ASSERT_EQ(read(to_parent[0], &c, 1), 1);
+        ProcessSampler sampler(pid);
+        ASSERT_TRUE(sampler.sample(1000));
+        ASSERT_GE(sampler.last().rss_kib, 32 * 1024);
+        ASSERT_EQ(sampler.last().threads, 1);
+        ASSERT_EQ(write(to_child[1], &c, 1), 1);
+
+        int status = 0;
+        struct rusage usage {};
+        ASSERT_EQ(wait4(pid, &status, 0, &usage), pid);
+        ASSERT_EQ(describe_exit_status(status), "exit code 0");
+        auto accounted = ResourceUsage::from_rusage(usage);
+        ASSERT_GE(accounted.max_rss_kib, 32 * 1024);
+        // The fds refer to the process that is gone now, not to whatever gets its pid next
+        ASSERT_FALSE(sampler.sample(2000));
+        ASSERT_THROW(ProcessSampler{pid}, ChildProcessException);
+        for (int fd : {to_parent[0], to_parent[1], to_child[0], to_child[1]}) {
+            close(fd);
+        }
+    }
+}  // namespace scinit
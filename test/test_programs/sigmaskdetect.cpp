@@ -0,0 +1,36 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Detect whether signals blocked by scinit leaked into the program
+int main(int, char**) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 7, "SigBlk:") == 0) {
+            if (line.find_first_not_of("0 \t", 7) != std::string::npos) {
+                std::cerr << "ERROR: Started with blocked signals: '" << line << "'" << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+    }
+    std::cerr << "ERROR: Couldn't find SigBlk in /proc/self/status" << std::endl;
+    return 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+#include "../src/RecordFramer.h"
+
+namespace scinit {
+    class RecordFramerTests : public testing::Test {
+      protected:
+        void add(RecordFramer& framer, const std::string& data) {
+            framer.add(data.data(), data.size(), [this](const std::string& record) { records.push_back(record); });
+        }
+        void flush(RecordFramer& framer) {
+            framer.flush([this](const std::string& record) { records.push_back(record); });
+        }
+
+        std::vector<std::string> records;
+    };
+
+    TEST_F(RecordFramerTests, JoinsIndentedLines) {
+        RecordFramer uut(nullptr, 65536);
+        add(uut, "starting\nException in thread \"main\" java.lang.IllegalStateException: boom\n"
+                 "\tat Main.run(Main.java:12)\n");
+        add(uut, "\tat Main.main(Main.java:5)\nstill running\n");
+        ASSERT_THAT(records, ::testing::ElementsAre("starting", "Exception in thread \"main\" "
+                                                                "java.lang.IllegalStateException: boom\n"
+                                                                "\tat Main.run(Main.java:12)\n"
+                                                                "\tat Main.main(Main.java:5)"));
+        ASSERT_FALSE(uut.empty());
+        flush(uut);
+        ASSERT_EQ(records.back(), "still running");
+        ASSERT_TRUE(uut.empty());
+    }
+
+    TEST_F(RecordFramerTests, KeepsIncompleteLines) {
+        RecordFramer uut(nullptr, 65536);
+        add(uut, "first li");
+        add(uut, "ne\n  second");
+        ASSERT_TRUE(records.empty());
+        add(uut, " line\n\n\nthird\n");
+        ASSERT_THAT(records, ::testing::ElementsAre("first line\n  second line"));
+        flush(uut);
+        ASSERT_THAT(records, ::testing::ElementsAre("first line\n  second line", "third"));
+    }
+
+    TEST_F(RecordFramerTests, UsesPattern) {
+        auto pattern = std::make_shared<const std::regex>("^(\\s|Caused by:)");
+        RecordFramer uut(pattern, 65536);
+        add(uut, "Traceback:\n  File \"x.py\"\nCaused by: y\n  File \"y.py\"\nValueError: z\n");
+        flush(uut);
+        ASSERT_THAT(records, ::testing::ElementsAre("Traceback:\n  File \"x.py\"\nCaused by: y\n  File \"y.py\"",
+                                                    "ValueError: z"));
+    }
+
+    TEST_F(RecordFramerTests, LimitsRecordSize) {
+        RecordFramer uut(nullptr, 16);
+        add(uut, "0123456789\n 1234\n 5678\n");
+        flush(uut);
+        ASSERT_THAT(records, ::testing::ElementsAre("0123456789\n 1234", " 5678"));
+
+        // Lines longer than a record are split, even before their end arrived
+        records.clear();
+        add(uut, std::string(40, 'x'));
+        ASSERT_THAT(records, ::testing::ElementsAre(std::string(16, 'x')));
+        flush(uut);
+        ASSERT_THAT(records, ::testing::ElementsAre(std::string(16, 'x'), std::string(16, 'x'), std::string(8, 'x')));
+    }
+}  // namespace scinit
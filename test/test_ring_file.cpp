@@ -0,0 +1,150 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "../src/ChildProcessException.h"
+#include "../src/RingFile.h"
+
+namespace fs = boost::filesystem;
+
+namespace scinit {
+    class RingFileTests : public testing::Test {
+      protected:
+        fs::path file;
+
+        void SetUp() override { file = fs::temp_directory_path() / fs::unique_path(); }
+
+        void TearDown() override { fs::remove(file); }
+
+        static void append(RingFile& ring, const std::string& program, const std::string& message,
+                           RingFile::Stream stream = RingFile::STDOUT, uint64_t time_ns = 0) {
+            ring.append(program.data(), program.size(), stream, message.data(), message.size(), time_ns);
+        }
+
+        // Message of record 'i', long enough to wrap the ring a few times
+        static std::string message(unsigned int i) {
+            return std::to_string(i) + ":" + std::string(100 + i % 200, static_cast<char>('a' + i % 26));
+        }
+    };
+
+    TEST_F(RingFileTests, ReadsRecordsInOrder) {
+        RingFile uut(file.native(), RING_FILE_MIN_CAPACITY);
+        append(uut, "web", "started", RingFile::STDOUT, 1000);
+        append(uut, "worker@1", "disk full", RingFile::STDERR, 2000);
+        append(uut, "web", "", RingFile::STDOUT, 3000);
+
+        RingFile::Reader reader(file.native());
+        RingFile::Record record;
+        ASSERT_TRUE(reader.next(record));
+        ASSERT_EQ(record.program, "web");
+        ASSERT_EQ(record.message, "started");
+        ASSERT_EQ(record.time_ns, 1000);
+        ASSERT_TRUE(reader.next(record));
+        ASSERT_EQ(record.program, "worker@1");
+        ASSERT_EQ(record.message, "disk full");
+        ASSERT_EQ(record.stream, RingFile::STDERR);
+        ASSERT_TRUE(reader.next(record));
+        ASSERT_EQ(record.message, "");
+        ASSERT_FALSE(reader.next(record));
+
+        // Readers follow the writer
+        append(uut, "web", "later");
+        ASSERT_TRUE(reader.next(record));
+        ASSERT_EQ(record.message, "later");
+        ASSERT_EQ(reader.get_skipped(), 0);
+    }
+
+    TEST_F(RingFileTests, OldestRecordsAreOverwritten) {
+        RingFile uut(file.native(), RING_FILE_MIN_CAPACITY);
+        const unsigned int count = 2000;
+        for (unsigned int i = 0; i < count; i++) {
+            append(uut, "web", message(i));
+        }
+        RingFile::Reader reader(file.native());
+        RingFile::Record record;
+        ASSERT_TRUE(reader.next(record));
+        auto first = std::stoul(record.message);
+        ASSERT_GT(first, 0);
+        ASSERT_EQ(record.message, message(first));
+        for (auto i = first + 1; i < count; i++) {
+            ASSERT_TRUE(reader.next(record));
+            ASSERT_EQ(record.message, message(i));
+        }
+        ASSERT_FALSE(reader.next(record));
+    }
+
+    TEST_F(RingFileTests, RecordsSurviveReopening) {
+        {
+            RingFile uut(file.native(), RING_FILE_MIN_CAPACITY);
+            append(uut, "web", "before the crash");
+        }
+        RingFile uut(file.native(), RING_FILE_MIN_CAPACITY);
+        append(uut, "web", "after the restart");
+        {
+            RingFile::Reader reader(file.native());
+            RingFile::Record record;
+            ASSERT_TRUE(reader.next(record));
+            ASSERT_EQ(record.message, "before the crash");
+            ASSERT_TRUE(reader.next(record));
+            ASSERT_EQ(record.message, "after the restart");
+        }
+
+        // A different size starts over
+        RingFile resized(file.native(), 2 * RING_FILE_MIN_CAPACITY);
+        RingFile::Reader reader(file.native());
+        RingFile::Record record;
+        ASSERT_FALSE(reader.next(record));
+    }
+
+    TEST_F(RingFileTests, ConcurrentReaderSeesOnlyCompleteRecords) {
+        RingFile uut(file.native(), RING_FILE_MIN_CAPACITY);
+        const unsigned int count = 200000;
+        RingFile::Reader reader(file.native());
+        std::thread writer([&]() {
+            for (unsigned int i = 0; i < count; i++) {
+                append(uut, "web", message(i));
+            }
+        });
+        RingFile::Record record;
+        unsigned long last = 0, read = 0;
+        bool intact = true, ordered = true;
+        while (last + 1 < count) {
+            if (!reader.next(record)) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto i = std::stoul(record.message);
+            intact = intact && record.message == message(static_cast<unsigned int>(i)) && record.program == "web";
+            ordered = ordered && (read == 0 || i > last);
+            last = i;
+            read++;
+        }
+        writer.join();
+        ASSERT_TRUE(intact);
+        ASSERT_TRUE(ordered);
+        ASSERT_GT(read, 0);
+    }
+
+    TEST_F(RingFileTests, OtherFilesAreRejected) {
+        std::ofstream(file.native()) << std::string(8192, 'x');
+        ASSERT_THROW(RingFile::Reader{file.native()}, ChildProcessException);
+    }
+}  // namespace scinit
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2018 The scinit authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <vector>
+#include "../src/TimerWheel.h"
+
+namespace scinit {
+    class TimerWheelTests : public testing::Test {};
+
+    TEST_F(TimerWheelTests, FiresInOrderAndNeverEarly) {
+        TimerWheel uut(1000, 10);
+        std::vector<int> order;
+        uut.schedule(1000, 300, [&order]() { order.push_back(3); });
+        uut.schedule(1000, 100, [&order]() { order.push_back(1); });
+        uut.schedule(1000, 200, [&order]() { order.push_back(2); });
+        ASSERT_EQ(uut.size(), 3);
+
+        ASSERT_EQ(uut.advance(1099), 0);
+        ASSERT_EQ(uut.advance(1100), 1);
+        ASSERT_EQ(uut.advance(1350), 2);
+        ASSERT_THAT(order, ::testing::ElementsAre(1, 2, 3));
+        ASSERT_EQ(uut.size(), 0);
+    }
+
+    TEST_F(TimerWheelTests, CancelledTimerDoesNotFire) {
+        TimerWheel uut(0, 10);
+        bool fired = false;
+        auto id = uut.schedule(0, 50, [&fired]() { fired = true; });
+        ASSERT_TRUE(uut.cancel(id));
+        ASSERT_FALSE(uut.cancel(id)) << "Timer could be cancelled twice";
+        uut.advance(1000);
+        ASSERT_FALSE(fired);
+
+        // A recycled node must not be cancellable through the old id
+        auto new_id = uut.schedule(1000, 50, [&fired]() { fired = true; });
+        ASSERT_NE(id, new_id);
+        ASSERT_FALSE(uut.cancel(id));
+        uut.advance(1050);
+        ASSERT_TRUE(fired);
+    }
+
+    TEST_F(TimerWheelTests, CloseExpiriesAreCoalesced) {
+        TimerWheel uut(0, 10);
+        int count = 0;
+        for (int i = 1; i <= 10; i++) {
+            uut.schedule(0, static_cast<uint64_t>(i), [&count]() { count++; });
+        }
+        uint64_t deadline = 0;
+        ASSERT_TRUE(uut.next_deadline(deadline));
+        ASSERT_EQ(deadline, 10);
+        ASSERT_EQ(uut.advance(10), 10);
+        ASSERT_EQ(count, 10);
+        ASSERT_FALSE(uut.next_deadline(deadline));
+    }
+
+    TEST_F(TimerWheelTests, LongTimersCascade) {
+        TimerWheel uut(12345, 10);
+        std::vector<uint64_t> delays = {5, 640, 641, 40960, 3600000, 86400000};
+        std::vector<uint64_t> fired_at;
+        uint64_t now = 12345;
+        for (auto delay : delays) {
+            uut.schedule(now, delay, [&fired_at, &now]() { fired_at.push_back(now); });
+        }
+        // Drive the wheel the same way the event loop does: sleep until the next deadline
+        uint64_t deadline = 0;
+        while (uut.next_deadline(deadline)) {
+            now = std::max(now, deadline);
+            uut.advance(now);
+        }
+        ASSERT_EQ(fired_at.size(), delays.size());
+        for (size_t i = 0; i < delays.size(); i++) {
+            ASSERT_GE(fired_at[i], 12345 + delays[i]);
+            ASSERT_LT(fired_at[i], 12345 + delays[i] + 10);
+        }
+    }
+
+    TEST_F(TimerWheelTests, CallbacksCanReschedule) {
+        TimerWheel uut(0, 1);
+        int count = 0;
+        uint64_t now = 0;
+        std::function<void()> callback = [&]() {
+            count++;
+            if (count < 5) {
+                uut.schedule(now, 0, callback);
+            }
+        };
+        uut.schedule(now, 0, callback);
+        for (now = 1; now <= 10; now++) {
+            uut.advance(now);
+        }
+        ASSERT_EQ(count, 5);
+        ASSERT_EQ(uut.size(), 0);
+    }
+}  // namespace scinit